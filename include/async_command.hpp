@@ -0,0 +1,211 @@
+/**
+ * @file async_command.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Completion of commands sent with DatcCtrl::commandAsync()
+ * @details An asynchronous command resolves twice: once when the modbus write is acknowledged
+ * and, if asked for, once more when the motion it started has finished. Completion is read
+ * from the polled status: the gripper open/close bit set or the finger at its target, and the
+ * finger position no longer moving for kMotionSettleCycles polls.
+ * The open/close bit may still be set from the previous motion when the command arrives, so it
+ * only counts once the motion was seen to start: the finger moved, or the bit was cleared and set
+ * again. A gripper that was already there never starts; it is done after kMotionStartWindow.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef ASYNC_COMMAND_HPP
+#define ASYNC_COMMAND_HPP
+
+#include <array>
+#include <chrono>
+#include <future>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string_view>
+
+using namespace std;
+
+enum class MotionResult : uint8_t {
+    DONE       = 0,
+    TIMEOUT    = 1, /**< Not finished within kMotionTimeout, e.g. the finger is blocked by an object */
+    FAULT      = 2, /**< The DATC reported a fault meanwhile */
+    FAILED     = 3, /**< The command itself was not acknowledged */
+    SUPERSEDED = 4, /**< A later motion command for the slave replaced it, before or after it was written */
+};
+
+constexpr array<string_view, 5> kMotionResultNames = {
+    "done",
+    "timeout",
+    "fault",
+    "failed",
+    "superseded",
+};
+
+constexpr string_view motionResultName(MotionResult result) {
+    return kMotionResultNames[(size_t) result];
+}
+
+enum class MotionKind : uint8_t {
+    GRIPPER_OPEN,
+    GRIPPER_CLOSE,
+    FINGER_POSITION,
+};
+
+const chrono::milliseconds kMotionTimeout {10000};
+const chrono::milliseconds kMotionStartWindow {500}; /**< Without motion by then, the gripper was already there */
+
+const uint32_t kMotionSettleCycles    = 3;  /**< Polls in a row without finger movement */
+const uint16_t kMotionSettleTolerance = 5;  /**< Finger position change still counted as standing (0.1 %) */
+const uint16_t kFingerPosTolerance    = 20; /**< Distance to the target counted as reached (0.1 %) */
+
+using AckCallback    = function<void(bool success)>;
+using MotionCallback = function<void(MotionResult result)>;
+
+struct CommandHandle {
+    shared_future<bool> ack;            /**< Result of the modbus write */
+    shared_future<MotionResult> motion; /**< Only valid if motion completion was asked for */
+};
+
+/**
+ * @brief Status fields the completion is decided on.
+ */
+struct MotionSample {
+    uint32_t seq = 0;
+    bool fault     = false;
+    bool grp_open  = false;
+    bool grp_close = false;
+    uint16_t finger_pos = 0;
+};
+
+class MotionWatch {
+    using Clock = chrono::steady_clock;
+
+public:
+    MotionWatch(uint16_t slave_addr, MotionKind kind, uint16_t target_pos, MotionCallback on_done)
+        : slave_addr_(slave_addr), kind_(kind), target_pos_(target_pos), on_done_(move(on_done)),
+          future_(promise_.get_future().share()) {}
+
+    /**
+     * @brief Starts watching once the command is acknowledged.
+     * @param seq Snapshot sequence of the slave before the write, this and older statuses are ignored
+     * @param start_pos Finger position in that snapshot
+     */
+    void start(uint32_t seq, Clock::time_point now, uint16_t start_pos) {
+        start_seq_  = seq;
+        start_pos_  = start_pos;
+        start_time_ = now;
+        deadline_   = now + kMotionTimeout;
+        started_    = true;
+    }
+
+    /**
+     * @return true once resolved
+     */
+    bool update(const MotionSample &sample, Clock::time_point now) {
+        if (!check(sample, now)) {
+            return false;
+        }
+
+        resolve(result_);
+        return true;
+    }
+
+    /**
+     * @brief Like update() but does not resolve, so the caller can resolve outside its locks.
+     * @return true once the result is decided, see getResult()
+     */
+    bool check(const MotionSample &sample, Clock::time_point now) {
+        if (!started_) {
+            return false;
+        }
+
+        if (now >= deadline_) {
+            result_ = MotionResult::TIMEOUT;
+            return true;
+        }
+
+        if (sample.seq == last_seq_ || (int32_t) (sample.seq - start_seq_) <= 0) {
+            return false;
+        }
+
+        last_seq_ = sample.seq;
+
+        if (sample.fault) {
+            result_ = MotionResult::FAULT;
+            return true;
+        }
+
+        if (has_last_pos_ && abs(sample.finger_pos - last_pos_) <= kMotionSettleTolerance) {
+            settled_cycles_++;
+        } else {
+            settled_cycles_ = 0;
+        }
+
+        last_pos_     = sample.finger_pos;
+        has_last_pos_ = true;
+
+        const bool reached = isReached(sample);
+
+        // A bit cleared after the write is set again by this motion, not left over from the last one
+        if (!reached || abs(sample.finger_pos - start_pos_) > kMotionSettleTolerance) {
+            motion_started_ = true;
+        }
+
+        const bool start_seen = motion_started_ || kind_ == MotionKind::FINGER_POSITION || now - start_time_ >= kMotionStartWindow;
+
+        if (reached && start_seen && settled_cycles_ >= kMotionSettleCycles) {
+            result_ = MotionResult::DONE;
+            return true;
+        }
+
+        return false;
+    }
+
+    void resolve(MotionResult result) {
+        promise_.set_value(result);
+
+        if (on_done_) {
+            on_done_(result);
+        }
+    }
+
+    uint16_t getSlaveAddr() const {return slave_addr_;}
+    MotionResult getResult() const {return result_;}
+    shared_future<MotionResult> getFuture() const {return future_;}
+
+private:
+    bool isReached(const MotionSample &sample) const {
+        switch (kind_) {
+            case MotionKind::GRIPPER_OPEN:    return sample.grp_open;
+            case MotionKind::GRIPPER_CLOSE:   return sample.grp_close;
+            case MotionKind::FINGER_POSITION: return abs(sample.finger_pos - target_pos_) <= kFingerPosTolerance;
+        }
+        return false;
+    }
+
+    const uint16_t slave_addr_;
+    const MotionKind kind_;
+    const uint16_t target_pos_;
+    MotionCallback on_done_;
+
+    promise<MotionResult> promise_;
+    shared_future<MotionResult> future_;
+
+    bool started_ = false;
+    MotionResult result_ = MotionResult::FAILED; /**< Set by check() */
+    uint32_t start_seq_ = 0;
+    uint32_t last_seq_  = 0;
+    uint16_t start_pos_ = 0;
+    Clock::time_point start_time_;
+    Clock::time_point deadline_;
+    bool motion_started_ = false;
+
+    uint16_t last_pos_  = 0;
+    bool has_last_pos_  = false;
+    uint32_t settled_cycles_ = 0;
+};
+
+#endif // ASYNC_COMMAND_HPP
@@ -0,0 +1,253 @@
+/**
+ * @file command_coalescer.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Command stage in front of ModbusComm that merges superseded setpoints
+ * @details Callers queue their command and the first one finding the port idle writes the
+ * whole queue, while the others wait for their own command. A setpoint (finger position,
+ * velocity, ...) queued while an older one of the same kind for the same slave is still
+ * waiting replaces its value instead of costing another modbus transaction (last writer wins);
+ * the caller whose value was replaced is told its setpoint was superseded.
+ * Discrete commands (enable, initialize, open, ...) are never merged and nothing is moved
+ * across them, so their order is kept.
+ * In deferred mode the callers leave the writing to the poll thread, which sends a queued
+ * command together with the status read of its slave (see flushFront()).
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef COMMAND_COALESCER_HPP
+#define COMMAND_COALESCER_HPP
+
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+using namespace std;
+
+struct CoalescerStats {
+    uint64_t submitted = 0; /**< Commands requested by the callers */
+    uint64_t written   = 0; /**< Modbus transactions actually made */
+    uint64_t coalesced = 0; /**< Setpoints merged into a pending one */
+    uint64_t combined  = 0; /**< Commands handed to the poll thread's status read (flushFront()) */
+};
+
+class CommandCoalescer {
+public:
+    static constexpr size_t kCapacity   = 32; /**< Commands waiting at once, further callers block */
+    static constexpr size_t kMaxRegNum  = 4;
+
+    struct Command {
+        uint16_t slave    = 0;
+        bool     setpoint = false; /**< Superseded by a later command with the same slave and code */
+        uint16_t reg_num  = 0;
+        array<uint16_t, kMaxRegNum> regs = {}; /**< regs[0] is the command code */
+    };
+
+    /**
+     * @param write bool write(const Command &), called without the lock held, one command at a time
+     * @return Result of the modbus write that carried the command (or the setpoint replacing it)
+     */
+    template<typename WriteFn>
+    bool submit(const Command &command, WriteFn &&write) {
+        bool superseded;
+        return submit(command, write, superseded);
+    }
+
+    /**
+     * @param superseded Set if a later setpoint replaced this one before it was written, so the
+     * value that reached the slave is not the caller's
+     */
+    template<typename WriteFn>
+    bool submit(const Command &command, WriteFn &&write, bool &superseded) {
+        unique_lock<mutex> lg(mutex_);
+
+        stats_.submitted++;
+
+        uint32_t version;
+        const size_t node = enqueue(command, lg, version);
+        const auto defer_deadline = chrono::steady_clock::now() + defer_timeout_;
+
+        while (!nodes_[node].done) {
+            if (flushing_) {
+                cond_.wait(lg);
+            } else if (deferred_ && chrono::steady_clock::now() < defer_deadline) {
+                // Falls back to writing it ourselves if the poll thread does not pick it up in time
+                cond_.wait_until(lg, defer_deadline);
+            } else {
+                flush(lg, write);
+            }
+        }
+
+        const bool result = nodes_[node].result;
+        superseded = (nodes_[node].version != version);
+
+        if (--nodes_[node].users == 0) {
+            cond_.notify_all();
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Leaves the queued commands to the poll thread (flushFront() and flushAll()).
+     * @param timeout After this long a caller writes its command itself
+     */
+    void setDeferred(bool deferred, chrono::milliseconds timeout = chrono::milliseconds(100)) {
+        lock_guard<mutex> lg(mutex_);
+
+        deferred_ = deferred;
+        defer_timeout_ = timeout;
+        cond_.notify_all();
+    }
+
+    /**
+     * @brief Hands the oldest queued command to fn if it is addressed to slave_addr.
+     * @param fn bool fn(const Command &), called without the lock held
+     * @return false if no command was handed over
+     */
+    template<typename Fn>
+    bool flushFront(uint16_t slave_addr, Fn &&fn) {
+        unique_lock<mutex> lg(mutex_);
+
+        if (flushing_ || queue_size_ == 0 || nodes_[queue_[queue_head_]].command.slave != slave_addr) {
+            return false;
+        }
+
+        flushing_ = true;
+
+        const size_t index = queue_[queue_head_];
+        queue_head_ = (queue_head_ + 1) % kCapacity;
+        queue_size_--;
+
+        const Command command = nodes_[index].command;
+
+        lg.unlock();
+        const bool result = fn(command);
+        lg.lock();
+
+        complete(index, result);
+        stats_.combined++;
+        flushing_ = false;
+        cond_.notify_all();
+
+        return true;
+    }
+
+    template<typename WriteFn>
+    void flushAll(WriteFn &&write) {
+        unique_lock<mutex> lg(mutex_);
+
+        if (!flushing_) {
+            flush(lg, write);
+        }
+    }
+
+    CoalescerStats getStats() {
+        lock_guard<mutex> lg(mutex_);
+        return stats_;
+    }
+
+private:
+    struct Node {
+        Command command;
+        size_t users = 0; /**< Callers waiting for this node, 0: free */
+        uint32_t version = 0; /**< Incremented by every setpoint merged into the node */
+        bool done    = false;
+        bool result  = false;
+    };
+
+    size_t enqueue(const Command &command, unique_lock<mutex> &lg, uint32_t &version) {
+        if (command.setpoint) {
+            // Newest first, up to the last discrete command
+            for (size_t i = queue_size_; i-- > 0;) {
+                Node &node = nodes_[queue_[(queue_head_ + i) % kCapacity]];
+
+                if (!node.command.setpoint) {
+                    break;
+                }
+
+                if (node.command.slave == command.slave && node.command.regs[0] == command.regs[0]) {
+                    node.command = command;
+                    node.users++;
+                    version = ++node.version;
+                    stats_.coalesced++;
+                    return queue_[(queue_head_ + i) % kCapacity];
+                }
+            }
+        }
+
+        size_t free_node = kCapacity;
+
+        cond_.wait(lg, [&] {
+            for (size_t i = 0; i < kCapacity; i++) {
+                if (nodes_[i].users == 0) {
+                    free_node = i;
+                    return true;
+                }
+            }
+            return false;
+        });
+
+        Node &node = nodes_[free_node];
+        node.command = command;
+        node.users   = 1;
+        node.version = version = 0;
+        node.done    = false;
+        node.result  = false;
+
+        queue_[(queue_head_ + queue_size_) % kCapacity] = free_node;
+        queue_size_++;
+
+        return free_node;
+    }
+
+    template<typename WriteFn>
+    void flush(unique_lock<mutex> &lg, WriteFn &write) {
+        flushing_ = true;
+
+        while (queue_size_ > 0) {
+            const size_t index = queue_[queue_head_];
+            queue_head_ = (queue_head_ + 1) % kCapacity;
+            queue_size_--;
+
+            // Taken out of the queue, so no later setpoint is merged into what is being written
+            const Command command = nodes_[index].command;
+
+            lg.unlock();
+            const bool result = write(command);
+            lg.lock();
+
+            complete(index, result);
+            cond_.notify_all();
+        }
+
+        flushing_ = false;
+        cond_.notify_all();
+    }
+
+    void complete(size_t index, bool result) {
+        nodes_[index].result = result;
+        nodes_[index].done   = true;
+        stats_.written++;
+    }
+
+    array<Node, kCapacity> nodes_;
+    array<size_t, kCapacity> queue_; /**< Node indices in submission order */
+    size_t queue_head_ = 0;
+    size_t queue_size_ = 0;
+    bool flushing_ = false;
+
+    bool deferred_ = false;
+    chrono::milliseconds defer_timeout_ {100};
+
+    CoalescerStats stats_;
+
+    mutex mutex_;
+    condition_variable cond_;
+};
+
+#endif // COMMAND_COALESCER_HPP
@@ -17,6 +17,7 @@
 #include "ui_advanced_control.h"
 #include "ui_impedance_control_form.h"
 #include "ui_dev_tab_form.h"
+#include "ui_telemetry_plot_form.h"
 
 class ModbusWidget : public QWidget {
     Q_OBJECT
@@ -84,4 +85,15 @@ public:
     Ui::DevTabForm ui_;
 };
 
+class TelemetryPlotWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    TelemetryPlotWidget(QWidget *parent = nullptr) : QWidget(parent) {
+        ui_.setupUi(this);
+    }
+
+    Ui::TelemetryPlotForm ui_;
+};
+
 #endif // CUSTOM_WIDGET_HPP
@@ -0,0 +1,50 @@
+/**
+ * @file datc_bus.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Additional serial port (RS485 bus) served by its own polling thread
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef DATC_BUS_HPP
+#define DATC_BUS_HPP
+
+#include "datc_ctrl.hpp"
+#include <thread>
+
+class DatcBus : public DatcCtrl {
+public:
+    /**
+     * @param port_name Port the bus is created for, known before open() so that it can be reserved
+     */
+    DatcBus(uint16_t bus_id, const string &port_name);
+    ~DatcBus();
+
+    bool open(uint16_t slave_address, int baudrate, const vector<uint16_t> &poll_slaves);
+    void close();
+
+    /**
+     * @param on_cycle Called on the bus thread after every poll round
+     */
+    void start(function<void()> on_cycle);
+
+    uint16_t getBusId() {return bus_id_;}
+    const string &getBusPort() const {return port_name_;}
+
+    /**
+     * @brief false until start(), e.g. while the port is still being opened
+     */
+    bool isRunning() {return running_;}
+
+private:
+    uint16_t bus_id_;
+    const string port_name_;
+
+    std::thread poll_thread_;
+    atomic<bool> flag_stop_ {false};
+    atomic<bool> running_ {false};
+};
+
+#endif // DATC_BUS_HPP
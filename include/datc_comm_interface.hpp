@@ -12,16 +12,25 @@
 #define DATC_COMM_INTERFACE_HPP
 
 #include "datc_ctrl.hpp"
+#include "datc_bus.hpp"
 #include <thread>
 #include <QThread>
+#include <QString>
+#include <QMetaType>
 #include <chrono>
 #include <boost/asio.hpp>
 #include "socket/tcp_manager.hpp"
+#include "status_encoder.hpp"
+#include "status_subscription.hpp"
+#include "monitor_status.hpp"
+#include "telemetry_ring.hpp"
 
 using namespace std;
 using namespace boost::asio;
 using namespace boost::asio::ip;
 
+Q_DECLARE_METATYPE(MonitorStatus)
+
 class DatcCommInterface : public QThread, public DatcCtrl {
     Q_OBJECT
 
@@ -32,24 +41,68 @@ public:
 Q_SIGNALS:
     void rosShutdown();
 
+    /**
+     * @brief Emitted from the async worker once a postAction() is done. Connect it queued.
+     */
+    void actionFinished(QString name, bool success);
+
+    /**
+     * @brief Emitted only when the monitored status of bus 0 changed (see monitor_status.hpp). Connect it queued.
+     */
+    void statusChanged(MonitorStatus status);
+
 public:
     bool init(const char *port_name, uint16_t slave_address, int baudrate);
-    void initTcp(const string addr, uint16_t socket_port);
+
+    /**
+     * @brief Runs a GUI action on the async worker of bus 0, so the caller never waits for the modbus lock.
+     * @param name Reported back with actionFinished()
+     */
+    void postAction(const QString &name, function<bool()> action);
+    bool initTcp(const string addr, uint16_t socket_port, size_t io_thread_num = 0);
     void releaseTcp();
 
+    // Additional serial ports, each polled by its own thread. Bus 0 is this interface.
+    bool openBus(const string &port_name, uint16_t slave_address, int baudrate, const vector<uint16_t> &poll_slaves);
+    void closeAllBuses();
+    vector<shared_ptr<DatcBus>> getBuses();
+
+    MonitorStatus getMonitorStatus();
+
+    /**
+     * @brief Every status read of the selected slave of bus 0, pushed by the poll thread.
+     */
+    const TelemetryRing &getTelemetry() const {return telemetry_;}
+
     bool isSocketConnected() {return is_socket_connected_;}
     bool getTcpSendStatus() {return flag_tcp_send_status_;}
     void setTcpSendStatus(bool flag) {flag_tcp_send_status_ = flag;}
 
 private:
     void run();
-    void sendStatus();
+    void sendStatus(DatcCtrl &bus, uint16_t bus_id, StatusEncoder &encoder);
     void recvCommand();
+    void dispatchCommand(DatcCtrl &bus, uint16_t bus_id, uint16_t target, const Json::Value &json);
+    void sendPollStats(DatcCtrl &bus, uint16_t bus_id, uint32_t client_id);
+    void sendTimingCalibration(const TimingCalibration &calibration, uint16_t bus_id, uint32_t client_id);
+    void sendCommandAsync(DatcCtrl &bus, uint16_t bus_id, uint16_t target, const Json::Value &id, uint32_t client_id,
+                          bool wait_done, DATC_COMMAND cmd, int value_1, uint16_t value_2);
+    void publishHealth(uint16_t bus_id, uint16_t slave_addr, SlaveHealth previous, SlaveHealth health);
+    void publishMonitorStatus();
+    void recordTelemetry();
+    void subscribe(uint32_t client_id, const Json::Value &json);
+    void sendQueueStats(uint32_t client_id);
+    shared_ptr<DatcBus> findBus(uint16_t bus_id);
+
+    atomic<bool> flag_program_stop_ {false};
 
-    bool flag_program_stop_ = false;
+    map<uint16_t, shared_ptr<DatcBus>> buses_;
+    atomic<bool> is_multi_bus_ {false};
+    mutex mutex_bus_;
 
     // TCP socket related variables
-    TcpServer *tcp_server_;
+    TcpServer *tcp_server_ = nullptr;
+    StatusEncoder status_encoder_;
     std::thread tcp_thread_;
 
     bool flag_tcp_stop_        = false;
@@ -57,6 +110,13 @@ private:
     bool flag_tcp_send_status_ = true;
 
     mutex mutex_tcp_;
+
+    // Keeps the last status emitted with statusChanged()
+    MonitorPublisher monitor_publisher_;
+    mutex mutex_monitor_;
+
+    TelemetryRing telemetry_;
+    uint32_t telemetry_seq_ = 0; /**< Last snapshot pushed, only touched by the poll thread */
 };
 
 #endif // DATC_COMM_INTERFACE_HPP
@@ -12,12 +12,28 @@
 #define DATC_CTRL_HPP
 
 #include "modbus_comm.hpp"
+#include "poll_stats.hpp"
+#include "seqlock.hpp"
+#include "command_coalescer.hpp"
+#include "rs485_timing.hpp"
+#include "slave_health.hpp"
+#include "async_command.hpp"
+#include "telemetry_recorder.hpp"
 #include <map>
+#include <list>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <string_view>
+#include <initializer_list>
 
 #define CMD_ADDR 0
 
-#define SEND_CMD_VECTOR(...) mbc_.sendData(CMD_ADDR, __VA_ARGS__)
-#define SEND_CMD(...) mbc_.sendData(CMD_ADDR, (uint16_t) __VA_ARGS__)
+#define SEND_CMD_REGS(target, ...) submitCommand(resolveSlave(target), __VA_ARGS__)
+#define SEND_CMD(target, ...) submitCommand(resolveSlave(target), {(uint16_t) __VA_ARGS__})
 
 using namespace std;
 
@@ -30,6 +46,39 @@ const uint16_t kTorqueRatioMax = 100;
 const uint16_t kSpeedRatioMin  = 0;
 const uint16_t kSpeedRatioMax  = 100;
 
+// Status block read every poll cycle
+const uint16_t kStatusRegAddr = 10;
+const uint16_t kStatusRegNum  = 8;
+
+using StatusRegisters = array<uint16_t, kStatusRegNum>;
+
+const uint16_t kPollFreq    = 50;  /**< Default poll rate (Hz) */
+const uint16_t kPollFreqMin = 10;
+const uint16_t kPollFreqMax = 500;
+
+// Characters on the wire for one 8 register read (request, response and the 3.5 char
+// silences) and bits per character (start, data, parity, stop). Bounds the poll rate.
+const uint16_t kCharsPerStatusRead = 36;
+const uint16_t kBitsPerChar        = 11;
+
+const int kPollRtPriority = 50; /**< SCHED_FIFO priority of the poll thread */
+
+// RS485 timing calibration. The timeouts are set to the measured p99 round trip times
+// kTimingMarginRatio plus kTimingMarginUs (USB serial adapters deliver in latency timer ticks).
+const size_t   kCalibrationSamples    = 200;    /**< Reads per slave to measure the round trip */
+const size_t   kCalibrationProbeReads = 20;     /**< Reads per slave that must all succeed with a candidate setting */
+const uint32_t kCalibrationTimeoutUs  = 500000; /**< Timeouts while measuring, so slow answers are not cut off */
+const size_t   kCalibrationMaxMisses  = 3;      /**< Consecutive failed reads after which a slave is left out */
+const uint16_t kMissingSlaveProbeAddr = 247;    /**< Highest modbus address, searched down for one that does not answer */
+const size_t   kMissingSlaveProbeTries = 3;
+const uint32_t kRtsDelayMinStep       = 25;     /**< Below this the RTS delay search tries 0 */
+const double   kTimingMarginRatio     = 1.5;
+const uint32_t kTimingMarginUs        = 2000;
+
+// Commands without an explicit target go to the slave selected by the user.
+// 0 is the modbus broadcast address, which this program never addresses.
+const uint16_t kSelectedSlave = 0;
+
 const uint16_t kVelMin =  100;
 const uint16_t kVelMax =  900;
 const uint16_t kCurMax = 1200;
@@ -55,8 +104,75 @@ enum class DATC_COMMAND {
     SET_MOTOR_SPEED         = 213,
 };
 
+/**
+ * @brief Human-readable state of the DATC. Resolved to text by datcStateName() only for display.
+ */
+enum class DatcState : uint8_t {
+    NONE                   = 0,
+    MOTOR_DISABLED         = 1,
+    MOTOR_ENABLE           = 2,
+    GRIPPER_INITIALIZE     = 3,
+    MOTOR_POSITION_CONTROL = 4,
+    MOTOR_VELOCITY_CONTROL = 5,
+    MOTOR_CURRENT_CONTROL  = 6,
+    GRIPPER_OPEN           = 7,
+    GRIPPER_CLOSE          = 8,
+    MOTOR_FAULT            = 9,
+};
+
+constexpr array<string_view, 10> kDatcStateNames = {
+    "---",
+    "Motor Disabled",
+    "Motor Enable",
+    "Gripper Initialize",
+    "Motor Position Control",
+    "Motor Velocity Control",
+    "Motor Current Control",
+    "Gripper Open",
+    "Gripper Close",
+    "Motor Fault",
+};
+
+constexpr string_view datcStateName(DatcState state) {
+    return kDatcStateNames[(size_t) state];
+}
+
+/**
+ * @brief Commands that only set a target value. A pending one is replaced by a newer one of
+ * the same kind instead of being written (see CommandCoalescer).
+ */
+constexpr bool isSetpointCommand(uint16_t cmd) {
+    switch ((DATC_COMMAND) cmd) {
+        case DATC_COMMAND::MOTOR_POSITION_CONTROL:
+        case DATC_COMMAND::MOTOR_VELOCITY_CONTROL:
+        case DATC_COMMAND::MOTOR_CURRENT_CONTROL:
+        case DATC_COMMAND::SET_FINGER_POSITION:
+        case DATC_COMMAND::SET_IMPEDANCE_PARAMS:
+        case DATC_COMMAND::SET_MOTOR_TORQUE:
+        case DATC_COMMAND::SET_MOTOR_SPEED:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Commands whose end a MotionWatch can tell from the status. A newer one supersedes the
+ * motion of the previous one on the same slave.
+ */
+constexpr bool isMotionCommand(uint16_t cmd) {
+    switch ((DATC_COMMAND) cmd) {
+        case DATC_COMMAND::GRIPPER_OPEN:
+        case DATC_COMMAND::GRIPPER_CLOSE:
+        case DATC_COMMAND::SET_FINGER_POSITION:
+            return true;
+        default:
+            return false;
+    }
+}
+
 struct DatcStatus {
-    string status_str;
+    DatcState state = DatcState::NONE;
 
     bool enable         = false;
     bool initialize     = false;
@@ -75,8 +191,51 @@ struct DatcStatus {
     uint16_t states     = 0;
 };
 
+/**
+ * @brief Meaning of one bit of the states register.
+ */
+struct StatusBitDesc {
+    bool DatcStatus::*flag; /**< nullptr: reserved bit */
+    DatcState state;
+};
+
+// Indexed by bit. When several bits are set, the highest one gives the state.
+constexpr array<StatusBitDesc, 16> kStatusBits = {{
+    {&DatcStatus::enable        , DatcState::MOTOR_ENABLE},
+    {&DatcStatus::initialize    , DatcState::GRIPPER_INITIALIZE},
+    {&DatcStatus::motor_pos_ctrl, DatcState::MOTOR_POSITION_CONTROL},
+    {&DatcStatus::motor_vel_ctrl, DatcState::MOTOR_VELOCITY_CONTROL},
+    {&DatcStatus::motor_cur_ctrl, DatcState::MOTOR_CURRENT_CONTROL},
+    {&DatcStatus::grp_open      , DatcState::GRIPPER_OPEN},
+    {&DatcStatus::grp_close     , DatcState::GRIPPER_CLOSE},
+    {nullptr                    , DatcState::NONE},
+    {nullptr                    , DatcState::NONE},
+    {&DatcStatus::fault         , DatcState::MOTOR_FAULT},
+}};
+
+constexpr uint16_t statusBitMask() {
+    uint16_t mask = 0;
+    for (size_t bit = 0; bit < kStatusBits.size(); bit++) {
+        mask |= (kStatusBits[bit].flag != nullptr) ? (1 << bit) : 0;
+    }
+    return mask;
+}
+
+constexpr uint16_t kStatusBitMask = statusBitMask(); /**< Bits with a meaning */
+
+/**
+ * @brief Status published once per successful read.
+ */
+struct DatcStatusSnapshot {
+    DatcStatus status;
+    uint32_t seq          = 0; /**< Incremented on every read of the slave, 0: never read */
+    uint64_t timestamp_us = 0; /**< steady_clock time of the read */
+};
+
 class DatcCtrl {
 public:
+    using HealthCallback = function<void(uint16_t slave_addr, SlaveHealth previous, SlaveHealth health)>;
+
     DatcCtrl();
     ~DatcCtrl();
 
@@ -84,34 +243,146 @@ public:
     bool modbusRelease();
     bool modbusSlaveChange(uint16_t slave_addr);
 
-    bool motorEnable();
-    bool motorStop();
-    bool motorDisable();
+    // "target" is the slave the command is sent to (kSelectedSlave: the selected slave)
+    bool motorEnable (uint16_t target = kSelectedSlave);
+    bool motorStop   (uint16_t target = kSelectedSlave);
+    bool motorDisable(uint16_t target = kSelectedSlave);
 
-    bool setModbusAddr(uint16_t slave_addr);
+    bool setModbusAddr(uint16_t slave_addr, uint16_t target = kSelectedSlave);
 
-    bool grpInitialize();
-    bool grpOpen();
-    bool grpClose();
+    bool grpInitialize(uint16_t target = kSelectedSlave);
+    bool grpOpen      (uint16_t target = kSelectedSlave);
+    bool grpClose     (uint16_t target = kSelectedSlave);
 
     // Datc control
-    bool setFingerPos(uint16_t finger_pos);
-    bool motorVelCtrl(int16_t vel);
-    bool motorCurCtrl(int16_t cur);
-    bool motorPosCtrl(int16_t pos_deg, uint16_t duration);
+    bool setFingerPos(uint16_t finger_pos, uint16_t target = kSelectedSlave);
+    bool motorVelCtrl(int16_t vel, uint16_t target = kSelectedSlave);
+    bool motorCurCtrl(int16_t cur, uint16_t target = kSelectedSlave);
+    bool motorPosCtrl(int16_t pos_deg, uint16_t duration, uint16_t target = kSelectedSlave);
+
+    bool vacuumGrpOn (uint16_t target = kSelectedSlave);
+    bool vacuumGrpOff(uint16_t target = kSelectedSlave);
+
+    bool setMotorTorque(uint16_t torque_ratio, uint16_t target = kSelectedSlave);
+    bool setMotorSpeed (uint16_t speed_ratio , uint16_t target = kSelectedSlave);
+
+    /**
+     * @brief Blocking command through the same validation as the methods above.
+     */
+    bool execute(DATC_COMMAND cmd, uint16_t value_1 = 0, uint16_t value_2 = 0, uint16_t target = kSelectedSlave);
 
-    bool vacuumGrpOn();
-    bool vacuumGrpOff();
+    /**
+     * @brief Queues the command to the async worker of this bus and returns at once.
+     * @details Commands are sent in submission order. The handle resolves on the modbus ack and,
+     * with wait_motion, once more when the motion of GRIPPER_OPEN, GRIPPER_CLOSE or
+     * SET_FINGER_POSITION finished (see async_command.hpp). wait_motion is ignored otherwise.
+     * @param on_ack Called on the worker thread
+     * @param on_motion Called on the polling thread, outside its locks, so it may send the next command
+     */
+    CommandHandle commandAsync(DATC_COMMAND cmd, uint16_t value_1 = 0, uint16_t value_2 = 0, uint16_t target = kSelectedSlave,
+                               bool wait_motion = false, AckCallback on_ack = nullptr, MotionCallback on_motion = nullptr);
 
-    bool setMotorTorque(uint16_t torque_ratio);
-    bool setMotorSpeed (uint16_t speed_ratio);
+    /**
+     * @brief Queues any other blocking call (port init, slave change, calibration, ...) to the
+     * async worker, in order with commandAsync(). Lets a GUI thread stay off the modbus lock.
+     * @param on_done Called on the worker thread with the result of job
+     */
+    shared_future<bool> post(function<bool()> job, AckCallback on_done = nullptr);
 
     bool readDatcData();
-    DatcStatus getDatcStatus() {return status_;}
+    bool readDatcData(uint16_t slave_addr, DatcStatus &status);
+    static void decodeStates(uint16_t states, DatcStatus &status);
+    DatcStatus getDatcStatus() {return status_.load().status;}
+    DatcStatus getDatcStatus(uint16_t slave_addr) {return getStatusSnapshot(slave_addr).status;}
+
+    /**
+     * @brief Consistent status of the selected slave, lock-free. Compare seq to detect new data.
+     */
+    DatcStatusSnapshot getStatusSnapshot() {return status_.load();}
+    DatcStatusSnapshot getStatusSnapshot(uint16_t slave_addr);
     bool getConnectionState() {return mbc_.getConnectionState();}
     bool getModbusRecvErr() {return flag_modbus_recv_err_;}
 
     uint16_t getSlaveAddr() {return mbc_.getSlaveAddr();}
+    string getPortName() {return mbc_.getPortName();}
+
+    // Multi-drop bus polling
+    void setPollSlaves(const vector<uint16_t> &slave_list);
+    vector<uint16_t> getPollSlaves();
+    bool pollBus();
+    double getPollRate(uint16_t slave_addr);
+    SlaveHealth getSlaveHealth(uint16_t slave_addr);
+
+    /**
+     * @brief Called on the polling thread whenever the health of a slave changes. Set before polling starts.
+     */
+    void setHealthCallback(HealthCallback on_health) {on_health_ = move(on_health);}
+
+    /**
+     * @brief Slaves read by the last pollBus(). Only valid on the polling thread.
+     */
+    const vector<uint16_t> &getPollRound() const {return poll_round_;}
+
+    /**
+     * @brief Slaves on the bus, including the down ones left out of the last round. Only valid on the polling thread.
+     */
+    size_t getPollSlaveNum() const {return poll_slave_num_;}
+
+    /**
+     * @brief Polls the bus on absolute deadlines until stop_flag is set.
+     * @param on_cycle Called after every poll round, e.g. to publish the statuses
+     */
+    void pollLoop(const atomic<bool> &stop_flag, const function<void()> &on_cycle);
+
+    /**
+     * @brief Sets the poll rate, clamped to kPollFreqMin ~ kPollFreqMax.
+     * @details The loop further limits it to what the baudrate allows for the polled slaves.
+     */
+    void setPollFreq(uint16_t freq);
+    uint16_t getPollFreq() {return poll_freq_;}
+    double getMaxPollFreq(size_t slave_num);
+
+    /**
+     * @brief Runs the poll thread with SCHED_FIFO and/or pinned to a CPU (Linux only).
+     * @param cpu_core -1 to let the scheduler choose
+     */
+    void setPollScheduling(bool realtime, int cpu_core = -1);
+    bool getPollRealtime() {return poll_realtime_;}
+    int getPollCpuCore() {return poll_cpu_core_;}
+
+    /**
+     * @brief Sends a pending command and the next status read of its slave in one transaction
+     * (modbus function 0x17, write and read registers).
+     * @details Commands wait for the poll thread, at most one poll period. A slave rejecting the
+     * function code is remembered and served with separate write and read from then on.
+     */
+    void setCombinedTransfer(bool enable);
+    bool getCombinedTransfer() {return combined_transfer_;}
+
+    /**
+     * @brief Measures the round trip of the polled slaves and sets the RTS delay, response and
+     * byte timeouts from it. The result is saved per port and baudrate (see rs485_timing.hpp).
+     * @details Polling of this bus pauses meanwhile, commands are still sent. Slaves that never
+     * answer are left out. The previous timing is restored if no slave answers or the calibrated
+     * one fails its verification reads. The cost of a missing slave is measured by reading an
+     * address nobody polls, before and after.
+     */
+    TimingCalibration calibrateTiming(size_t samples = kCalibrationSamples);
+    Rs485Timing getTiming() {return mbc_.getTiming();}
+
+    PollStatsSnapshot getPollStats() {return poll_stats_.snapshot();}
+    CoalescerStats getCommandStats() {return coalescer_.getStats();}
+    void resetPollStats() {poll_stats_.reset();}
+
+    /**
+     * @brief Records every successful status read and every command of the bus to segment files
+     * in directory (see telemetry_recorder.hpp). A running recording is replaced.
+     * @param bus_id Written to the file header and the file names
+     */
+    bool startRecording(uint16_t bus_id, const string &directory = kRecorderDirectory);
+    void stopRecording();
+    bool isRecording() {return atomic_load(&recorder_) != nullptr;}
+    RecorderStats getRecorderStats();
 
     // Impedance related functions
     bool impedanceOn();
@@ -122,13 +393,81 @@ public:
     bool customCmd(uint16_t cmd, uint16_t value_1 = 0, uint16_t value_2 = 0, uint16_t value_3 = 0);
 
 protected:
-    bool checkDurationRange(string error_prefix, uint16_t &duration);
-    bool command(DATC_COMMAND cmd, uint16_t value_1 = 0, uint16_t value_2 = 0);
+    struct SlavePollState {
+        DatcStatusSnapshot snapshot;
+        bool recv_err = false;
+        bool combined_unsupported = false; /**< Slave answered 0x17 with an illegal function exception */
+        SlaveHealthState health;
+
+        uint32_t poll_count = 0;
+        double poll_rate    = 0; /**< Successful reads per second */
+        chrono::steady_clock::time_point rate_window_start = chrono::steady_clock::now();
+    };
+
+    struct AsyncRequest {
+        DATC_COMMAND cmd;
+        uint16_t value_1 = 0;
+        uint16_t value_2 = 0;
+        uint16_t target  = kSelectedSlave;
+        function<bool()> job; /**< Runs instead of cmd if set (post()) */
+
+        promise<bool> ack;
+        AckCallback on_ack;
+        shared_ptr<MotionWatch> motion; /**< nullptr: motion not watched */
+    };
+
+    bool checkDurationRange(const char *error_prefix, uint16_t &duration);
+    bool command(DATC_COMMAND cmd, uint16_t value_1 = 0, uint16_t value_2 = 0, uint16_t target = kSelectedSlave);
+    bool submitCommand(uint16_t slave_addr, initializer_list<uint16_t> regs);
+    uint16_t resolveSlave(uint16_t target) {return (target == kSelectedSlave) ? mbc_.getSlaveAddr() : target;}
+    DatcStatusSnapshot updatePollState(uint16_t slave_addr, const DatcStatus &status, bool success);
+    void applyPollScheduling();
+    bool readStatusRegisters(uint16_t slave_addr, StatusRegisters &reg);
+    bool isCombinedSupported(uint16_t slave_addr);
+    bool writeCommand(const CommandCoalescer::Command &command);
+    void recordStatus(uint16_t slave_addr, const DatcStatusSnapshot &snapshot);
+    void recordCommand(const CommandCoalescer::Command &command, bool result);
+    void enqueueAsync(AsyncRequest &&request);
+    void stopAsync();
+    void asyncWorker();
+    void updateMotionWatches();
+    void cancelMotionWatches(uint16_t slave_addr);
+    size_t measureRoundTrips(const vector<uint16_t> &slaves, size_t count, map<uint16_t, vector<double>> &rtt_ms,
+                             bool stop_on_failure = false);
+    double measureMissingSlave(const vector<uint16_t> &slaves);
 
     ModbusComm mbc_;
-    DatcStatus status_;
+    Seqlock<DatcStatusSnapshot> status_; /**< Status of the selected slave, written by the poll thread only */
 
     bool flag_modbus_recv_err_ = false;
+
+    // Slaves polled in addition to the selected one. The selected slave is always polled.
+    vector<uint16_t> poll_slaves_;
+    vector<uint16_t> poll_round_; /**< Slaves read in the current pollBus() round */
+    size_t poll_slave_num_ = 0;
+    map<uint16_t, SlavePollState> slave_states_;
+    mutex mutex_slave_;
+
+    atomic<uint16_t> poll_freq_ {kPollFreq};
+    atomic<bool> poll_realtime_ {false};
+    atomic<int>  poll_cpu_core_ {-1};
+    atomic<bool> flag_sched_changed_ {false}; /**< Applied by the poll thread on its next cycle */
+    atomic<bool> combined_transfer_ {false};
+    PollStats poll_stats_;
+    mutex mutex_poll_; /**< Held by pollLoop() for a round, and by calibrateTiming() to pause it */
+    CommandCoalescer coalescer_;
+    HealthCallback on_health_;
+    shared_ptr<TelemetryRecorder> recorder_; /**< nullptr: not recording. Only with atomic_load()/atomic_exchange() */
+
+    // Async commands, started with the first one
+    deque<AsyncRequest> async_queue_;
+    std::thread async_thread_;
+    bool async_stop_ = false;
+    mutex mutex_async_;
+    condition_variable cond_async_;
+
+    list<shared_ptr<MotionWatch>> motion_watches_; /**< Checked by the polling thread after every round */
+    mutex mutex_motion_;
 };
 
 #endif // DATC_CTRL_HPP
@@ -12,9 +12,11 @@
 #define MAIN_WINDOW_HPP
 
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QLineEdit>
 #include <QList>
 #include <QMainWindow>
+#include <QRegularExpression>
 
 #include <iostream>
 #include <math.h>
@@ -36,13 +38,24 @@ using namespace std;
 
 namespace gripper_ui {
 
+const int kGuiRefreshPeriod   = 100;  // msec
+const int kStatsRefreshPeriod = 1000; // msec
+const double kGuiStallMs    = 250; /**< Refresh interval logged as a blocked event loop */
+
+const std::chrono::milliseconds kImpedanceSwitchDelay {100};
+
+const char kActionModbusInit[] = "Modbus init";
+
+const array<int, 4> kPlotWindowSeconds = {1, 10, 60, 300};
+
 enum class WidgetSeq {
     MODBUS_WIDGET         = 0,
     DATC_CTRL_WIDGET      = 1,
     ADVANCED_CTRL_WIDGET  = 2,
     IMPEDANCE_CTRL_WIDGET = 3,
     DEV_TAB_WIDGET        = 4,
-    TCP_WIDGET            = 5,
+    PLOT_WIDGET           = 5,
+    TCP_WIDGET            = 6, /**< Not added with ROS, so it stays last */
 };
 
 class MainWindow : public QMainWindow {
@@ -52,9 +65,24 @@ public:
     MainWindow(int argc, char** argv, bool &success, QWidget *parent = 0);
     ~MainWindow();
 
+Q_SIGNALS:
+    void timingCalibrated(QString text);
+
 public Q_SLOTS:
     void timerCallback();
 
+    // Results of the actions posted to the bus worker, delivered queued on the GUI thread
+    void onActionFinished(QString name, bool success);
+    void showTimingCalibration(QString text);
+    void renderStatus(MonitorStatus status);
+    void refreshStats();
+
+    // Telemetry plot
+    void setPlotChannels();
+    void setPlotWindow(int index);
+    void setPlotPaused(bool paused);
+    void setRecording(bool record);
+
     // Enable & disable
     void datcEnable();
     void datcDisable();
@@ -85,6 +113,11 @@ public Q_SLOTS:
     void releaseModbus();
     void changeSlaveAddress();
     void setSlaveAddr();
+    void setPollSlaves();
+    void setPollFreq();
+    void setPollScheduling();
+    void setCombinedTransfer(bool enable);
+    void calibrateTiming();
 
     // Dev ui related
     void dev_setGainP();
@@ -98,6 +131,7 @@ public Q_SLOTS:
     // TCP comm. related functions
     void startTcpComm();
     void stopTcpComm();
+    void setTcpSendStatus(bool flag);
 #endif
 
     // Auto mapping function
@@ -106,6 +140,7 @@ public Q_SLOTS:
     void on_pushButton_select_adv_clicked();
     void on_pushButton_select_tcp_clicked();
     void on_pushButton_select_imped_ctrl_clicked();
+    void on_pushButton_select_plot_clicked();
     void on_pushButton_modbus_refresh_clicked();
 
     // Btn for dev tab
@@ -116,6 +151,8 @@ public Q_SLOTS:
     std::vector<std::string> getSerialPortLists();
 
 private:
+    void setButtonActive(QPushButton *btn, bool active);
+
     Ui::MainWindow *ui_;
 
     ModbusWidget        *modbus_widget_;
@@ -124,13 +161,28 @@ private:
     AdvancedCtrlWidget  *advanced_ctrl_widget_;
     ImpedanceCtrlWidget *impedance_ctrl_widget_;
     DevTabWidget        *dev_tab_widget_;
+    TelemetryPlotWidget *telemetry_plot_widget_;
 
     QString menu_btn_active_str_, menu_btn_inactive_str_;
     QString btn_active_str_, btn_inactive_str_;
 
     QTimer *timer_;
+    QTimer *stats_refresh_timer_;
     DatcCommInterface *datc_interface_;
 
+    // Last status rendered by renderStatus(), widgets are only updated where it differs
+    MonitorStatus rendered_status_;
+    bool has_rendered_ = false;
+    QString monitor_mode_text_;
+
+    // Frame time: interval between two refreshes, only touched on the GUI thread
+    QElapsedTimer frame_timer_;
+    SampleWindow frame_ms_;
+
+    // GUI thread time spent in the refresh slots since the last refreshStats()
+    QElapsedTimer busy_window_timer_;
+    qint64 gui_busy_ns_ = 0;
+
     bool dev_tab_accessibility_;
 };
 
@@ -19,8 +19,14 @@
 #endif
 
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <iostream>
+#include <condition_variable>
 #include <vector>
+#include <array>
+#include <string>
 
 #define DEBUG_MODE    false
 #define DATA_BIT      8
@@ -31,6 +37,30 @@ using namespace std;
 
 #define COUT(...) cout << __VA_ARGS__ << endl
 
+/**
+ * @brief Non-owning view of the registers to write (C++17 stand-in for std::span<const uint16_t>).
+ * @details Built from an array or a vector, so a write never copies or allocates.
+ */
+struct RegisterSpan {
+    RegisterSpan(const uint16_t *data, size_t size) : data(data), size(size) {}
+    RegisterSpan(const vector<uint16_t> &list) : data(list.data()), size(list.size()) {}
+
+    template<size_t N>
+    RegisterSpan(const array<uint16_t, N> &list) : data(list.data()), size(N) {}
+
+    const uint16_t *data;
+    size_t size;
+};
+
+/**
+ * @brief RS485 timing of a port, in microseconds.
+ */
+struct Rs485Timing {
+    uint32_t rts_delay_us        = 300;
+    uint32_t response_timeout_us = 500000; /**< Wait for the first byte of a response (libmodbus default) */
+    uint32_t byte_timeout_us     = 500000; /**< Gap allowed between two bytes of a response (libmodbus default) */
+};
+
 class ModbusComm {
 public:
     ModbusComm() {}
@@ -43,28 +73,33 @@ public:
 
         mb_ = modbus_new_rtu(port_name, baudrate, PARITY_MODE, DATA_BIT, STOP_BIT);
 
-        modbus_rtu_set_serial_mode(mb_, MODBUS_RTU_RS485);
-        modbus_rtu_set_rts_delay  (mb_, 300);
-        modbus_set_debug          (mb_, DEBUG_MODE);
-
         if (mb_ == NULL) {
             fprintf(stderr, "Unable to create the libmodbus context\n");
             return false;
         }
 
+        modbus_rtu_set_serial_mode(mb_, MODBUS_RTU_RS485);
+        modbus_set_debug          (mb_, DEBUG_MODE);
+        applyTiming(Rs485Timing());
+
         if (modbus_set_slave(mb_, slave_addr) == -1) {
             fprintf(stderr, "server_id= %d Invalid slave ID: %s\n", slave_addr, modbus_strerror(errno));
             modbus_free(mb_);
+            mb_ = NULL;
             return false;
         }
 
         if (modbus_connect(mb_) == -1) {
             fprintf(stderr, "Unable to connect %s\n", modbus_strerror(errno));
             modbus_free(mb_);
+            mb_ = NULL;
             return false;
         }
 
-        slave_num_ = slave_addr;
+        port_name_    = port_name;
+        baudrate_     = baudrate;
+        slave_num_    = slave_addr;
+        active_slave_ = slave_addr;
         connection_state_ = true;
         COUT("Modbus communication initiated");
 
@@ -77,8 +112,13 @@ public:
 
         unique_lock<mutex> lg(mutex_comm_);
 
+        if (mb_ == NULL) {
+            return;
+        }
+
         modbus_close(mb_);
         modbus_free (mb_);
+        mb_ = NULL;
         COUT("Modbus released");
     }
 
@@ -91,34 +131,43 @@ public:
             fprintf(stderr, "server_id= %d Invalid slave ID: %s\n", slave_addr, modbus_strerror(errno));
             modbus_close(mb_);
             modbus_free (mb_);
+            mb_ = NULL;
             connection_state_ = false;
             return false;
         }
 
-        usleep(10000);
         printf("Modbus slave address changed to %d\n", slave_addr);
+        active_slave_ = slave_addr;
         slave_num_ = slave_addr;
         connection_state_ = true;
 
         return true;
     }
 
-    bool sendData(int reg_addr, vector<uint16_t> data) {
+    bool sendData(int reg_addr, RegisterSpan data) {
+        return sendData(slave_num_, reg_addr, data);
+    }
+
+    bool sendData(uint16_t slave_addr, int reg_addr, RegisterSpan data) {
         if (!connection_state_) {
             COUT("Modbus communication is not enabled.");
             return false;
         }
 
-        unique_lock<mutex> lg(mutex_comm_);
+        unique_lock<mutex> lg = lockForWrite();
+
+        if (!selectSlave(slave_addr)) {
+            return false;
+        }
 
-        uint16_t register_number = data.size();
+        uint16_t register_number = data.size;
 
         if (register_number == 1) {
-            if (modbus_write_register(mb_, reg_addr, data[0]) == -1) {
+            if (modbus_write_register(mb_, reg_addr, data.data[0]) == -1) {
                 fprintf(stderr, "Failed to modbus write register %d : %s\n", reg_addr, modbus_strerror(errno));
                 return false;
             }
-        } else if (modbus_write_registers(mb_, reg_addr, register_number, &data[0]) == -1) {
+        } else if (modbus_write_registers(mb_, reg_addr, register_number, data.data) == -1) {
             fprintf(stderr, "Failed to modbus write register %d : %s\n", reg_addr, modbus_strerror(errno));
             return false;
         }
@@ -127,12 +176,20 @@ public:
     }
 
     bool sendData(int reg_addr, uint16_t data) {
+        return sendData(slave_num_, reg_addr, data);
+    }
+
+    bool sendData(uint16_t slave_addr, int reg_addr, uint16_t data) {
         if (!connection_state_) {
             COUT("Modbus communication is not enabled.");
             return false;
         }
 
-        unique_lock<mutex> lg(mutex_comm_);
+        unique_lock<mutex> lg = lockForWrite();
+
+        if (!selectSlave(slave_addr)) {
+            return false;
+        }
 
         if (modbus_write_register(mb_, reg_addr, data) == -1) {
             fprintf(stderr, "Failed to modbus write register %d : %s\n", reg_addr, modbus_strerror(errno));
@@ -143,6 +200,28 @@ public:
     }
 
     bool recvData(int reg_addr, int nb, vector<uint16_t> &data) {
+        return recvData(slave_num_, reg_addr, nb, data);
+    }
+
+    bool recvData(uint16_t slave_addr, int reg_addr, int nb, vector<uint16_t> &data) {
+        // Allocates only if the caller's vector has never held nb registers
+        data.resize(nb);
+        return recvData(slave_addr, reg_addr, nb, data.data());
+    }
+
+    /**
+     * @brief Reads a fixed-size register block, e.g. the status registers, without allocation.
+     */
+    template<size_t N>
+    bool recvData(uint16_t slave_addr, int reg_addr, array<uint16_t, N> &data) {
+        return recvData(slave_addr, reg_addr, (int) N, data.data());
+    }
+
+    /**
+     * @brief Status polling yields the port to command writes that are waiting for it.
+     * @param dest Must hold nb registers
+     */
+    bool recvData(uint16_t slave_addr, int reg_addr, int nb, uint16_t *dest) {
         if (!connection_state_) {
             COUT("Modbus communication is not enabled.");
             return false;
@@ -150,34 +229,149 @@ public:
 
         unique_lock<mutex> lg(mutex_comm_);
 
-        uint16_t data_temp[nb];
+        // Sleeps until the last waiting writer took and released the port
+        writes_done_.wait(lg, [this] {return pending_writes_.load() == 0;});
 
-        if (modbus_read_registers(mb_, reg_addr, nb, data_temp) == -1) {
-            mutex_comm_.unlock();
+        if (!selectSlave(slave_addr)) {
+            return false;
+        }
+
+        if (modbus_read_registers(mb_, reg_addr, nb, dest) == -1) {
             fprintf(stderr, "Failed to read input registers! : %s\n", modbus_strerror(errno));
             return false;
         }
 
-        data.clear();
+        return true;
+    }
+
+    /**
+     * @brief Writes data and reads nb registers in one transaction (function 0x17).
+     * @param unsupported Set if the slave rejected the function code, nothing was written then
+     */
+    bool sendRecvData(uint16_t slave_addr, int write_addr, RegisterSpan data, int read_addr, int nb, uint16_t *dest, bool &unsupported) {
+        unsupported = false;
+
+        if (!connection_state_) {
+            COUT("Modbus communication is not enabled.");
+            return false;
+        }
+
+        unique_lock<mutex> lg = lockForWrite();
+
+        if (!selectSlave(slave_addr)) {
+            return false;
+        }
+
+        if (modbus_write_and_read_registers(mb_, write_addr, data.size, data.data, read_addr, nb, dest) == -1) {
+            unsupported = (errno == EMBXILFUN);
 
-        for (auto i : data_temp) {
-            data.push_back(i);
+            if (!unsupported) {
+                fprintf(stderr, "Failed to write and read registers : %s\n", modbus_strerror(errno));
+            }
+            return false;
         }
 
         return true;
     }
 
+    /**
+     * @brief Timed status read for the timing calibration. Does not yield to pending writes.
+     * @param rtt_ms Round trip measured while holding the port, or the time the read took to fail
+     */
+    bool probeData(uint16_t slave_addr, int reg_addr, int nb, uint16_t *dest, double &rtt_ms) {
+        if (!connection_state_) {
+            return false;
+        }
+
+        unique_lock<mutex> lg(mutex_comm_);
+
+        if (!selectSlave(slave_addr)) {
+            return false;
+        }
+
+        auto time_request = chrono::steady_clock::now();
+        const bool success = (modbus_read_registers(mb_, reg_addr, nb, dest) != -1);
+
+        chrono::duration<double, milli> rtt = chrono::steady_clock::now() - time_request;
+        rtt_ms = rtt.count();
+
+        return success;
+    }
+
+    bool setTiming(const Rs485Timing &timing) {
+        unique_lock<mutex> lg(mutex_comm_);
+
+        if (mb_ == NULL) {
+            return false;
+        }
+
+        return applyTiming(timing);
+    }
+
+    Rs485Timing getTiming() {
+        unique_lock<mutex> lg(mutex_comm_);
+        return timing_;
+    }
+
     bool getConnectionState() {return connection_state_;}
 
     uint16_t getSlaveAddr() {return slave_num_;}
+    string getPortName() {return port_name_;}
+    int getBaudrate() {return baudrate_;}
 
 private:
+    // Counts the writers waiting for the port so that they take precedence over polling.
+    // The count drops under mutex_comm_, so a reader waiting on writes_done_ cannot miss it.
+    unique_lock<mutex> lockForWrite() {
+        pending_writes_++;
+        unique_lock<mutex> lg(mutex_comm_);
+
+        if (--pending_writes_ == 0) {
+            writes_done_.notify_all();
+        }
+        return lg;
+    }
+
+    // mutex_comm_ must be held. Only touches the context when the addressed slave changes.
+    bool selectSlave(uint16_t slave_addr) {
+        if (slave_addr == active_slave_) {
+            return true;
+        }
+
+        if (modbus_set_slave(mb_, slave_addr) == -1) {
+            fprintf(stderr, "server_id= %d Invalid slave ID: %s\n", slave_addr, modbus_strerror(errno));
+            return false;
+        }
+
+        active_slave_ = slave_addr;
+        return true;
+    }
+
+    // mutex_comm_ must be held
+    bool applyTiming(const Rs485Timing &timing) {
+        if (modbus_rtu_set_rts_delay(mb_, timing.rts_delay_us) == -1 ||
+            modbus_set_response_timeout(mb_, timing.response_timeout_us / 1000000, timing.response_timeout_us % 1000000) == -1 ||
+            modbus_set_byte_timeout(mb_, timing.byte_timeout_us / 1000000, timing.byte_timeout_us % 1000000) == -1) {
+            fprintf(stderr, "Failed to set the RS485 timing : %s\n", modbus_strerror(errno));
+            return false;
+        }
+
+        timing_ = timing;
+        return true;
+    }
+
     mutex mutex_comm_;
-    modbus_t *mb_;
+    modbus_t *mb_ = NULL;
+    Rs485Timing timing_;
 
     bool connection_state_ = false;
+    atomic<int> pending_writes_ {0};
+    condition_variable writes_done_; /**< Signalled when pending_writes_ drops to 0 */
 
-    uint16_t slave_num_ = 0;
+    string port_name_;
+    int baudrate_ = 0;
+    uint16_t slave_num_    = 0; /**< Slave selected by the user */
+    uint16_t active_slave_ = 0; /**< Slave the modbus context currently addresses */
 };
 
 #endif // MODBUS_COMM_HPP
@@ -0,0 +1,84 @@
+/**
+ * @file monitor_status.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief What the GUI shows of bus 0, published by DatcCommInterface::statusChanged()
+ * @details The interface passes every new status through a MonitorPublisher and only emits on a
+ * change. A changed state (connection, health, gripper state, ...) goes out at once, a changed
+ * measurement (finger position, motor current) at most every kMonitorMinInterval.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef MONITOR_STATUS_HPP
+#define MONITOR_STATUS_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "datc_ctrl.hpp"
+
+using namespace std;
+
+const std::chrono::milliseconds kMonitorMinInterval {50};
+
+struct MonitorStatus {
+    bool modbus_connected = false;
+    bool socket_connected = false;
+    bool recv_err = false;
+
+    uint16_t slave_addr = 0;
+    SlaveHealth health  = SlaveHealth::HEALTHY; /**< Of the selected slave */
+    DatcState state     = DatcState::NONE;
+
+    uint16_t finger_pos = 0;
+    int16_t  motor_cur  = 0;
+
+    bool isSameState(const MonitorStatus &other) const {
+        return modbus_connected == other.modbus_connected && socket_connected == other.socket_connected &&
+               recv_err == other.recv_err && slave_addr == other.slave_addr &&
+               health == other.health && state == other.state;
+    }
+
+    bool operator==(const MonitorStatus &other) const {
+        return isSameState(other) && finger_pos == other.finger_pos && motor_cur == other.motor_cur;
+    }
+
+    bool operator!=(const MonitorStatus &other) const {return !(*this == other);}
+};
+
+/**
+ * @brief Decides which statuses are emitted, against the last one emitted. Not thread-safe.
+ */
+class MonitorPublisher {
+    using Clock = std::chrono::steady_clock;
+
+public:
+    /**
+     * @return true if status is to be emitted, it then becomes the last one
+     */
+    bool update(const MonitorStatus &status, Clock::time_point now) {
+        if (status == last_) {
+            return false;
+        }
+
+        if (status.isSameState(last_) && now < last_time_ + kMonitorMinInterval) {
+            // Only the measurements moved, left to a later cycle
+            return false;
+        }
+
+        last_      = status;
+        last_time_ = now;
+
+        return true;
+    }
+
+    const MonitorStatus &getLast() const {return last_;}
+
+private:
+    MonitorStatus last_;
+    Clock::time_point last_time_;
+};
+
+#endif // MONITOR_STATUS_HPP
@@ -0,0 +1,149 @@
+/**
+ * @file poll_stats.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Timing statistics of the modbus poll loop
+ * @details The poll thread records the interval between cycle starts (jitter of the loop),
+ * the deadlines it missed and the round trip of every status read. Readers get a snapshot
+ * summarised over the last kSampleWindowSize samples. SampleWindow and summarizeSamples() are
+ * reused for other timings, e.g. the GUI frame time.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef POLL_STATS_HPP
+#define POLL_STATS_HPP
+
+#include <array>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+struct TimingSummary {
+    double min = 0;
+    double avg = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+struct PollStatsSnapshot {
+    uint64_t cycles   = 0;
+    uint64_t overruns = 0; /**< Cycles that ended after their deadline */
+    double   period_ms = 0;
+
+    TimingSummary cycle_ms; /**< Interval between the starts of two cycles */
+    TimingSummary rtt_ms;   /**< Modbus round trip of one status read */
+};
+
+const size_t kSampleWindowSize = 1024;
+
+// Fixed size ring of the latest samples, so recording never allocates
+struct SampleWindow {
+    array<double, kSampleWindowSize> samples;
+    size_t count = 0;
+    size_t next  = 0;
+
+    void add(double sample) {
+        samples[next] = sample;
+        next = (next + 1) % kSampleWindowSize;
+        count = min(count + 1, kSampleWindowSize);
+    }
+
+    vector<double> copy() const {
+        return vector<double>(samples.begin(), samples.begin() + count);
+    }
+};
+
+/**
+ * @param samples Reordered (partial sort for the p99)
+ */
+inline TimingSummary summarizeSamples(vector<double> &samples) {
+    TimingSummary summary;
+
+    if (samples.empty()) {
+        return summary;
+    }
+
+    double sum = 0;
+    for (auto sample : samples) {
+        sum += sample;
+    }
+
+    auto p99 = samples.begin() + (samples.size() - 1) * 99 / 100;
+    nth_element(samples.begin(), p99, samples.end());
+
+    summary.p99 = *p99;
+    summary.min = *min_element(samples.begin(), samples.end());
+    summary.max = *max_element(samples.begin(), samples.end());
+    summary.avg = sum / samples.size();
+
+    return summary;
+}
+
+class PollStats {
+public:
+    void addCycle(double cycle_ms, bool overrun) {
+        lock_guard<mutex> lg(mutex_);
+
+        cycle_.add(cycle_ms);
+        cycles_++;
+        overruns_ += overrun ? 1 : 0;
+    }
+
+    void addRoundTrip(double rtt_ms) {
+        lock_guard<mutex> lg(mutex_);
+        rtt_.add(rtt_ms);
+    }
+
+    void setPeriod(double period_ms) {
+        lock_guard<mutex> lg(mutex_);
+        period_ms_ = period_ms;
+    }
+
+    void reset() {
+        lock_guard<mutex> lg(mutex_);
+
+        cycle_ = SampleWindow();
+        rtt_   = SampleWindow();
+        cycles_   = 0;
+        overruns_ = 0;
+    }
+
+    PollStatsSnapshot snapshot() {
+        PollStatsSnapshot snapshot;
+        vector<double> cycle, rtt;
+
+        {
+            lock_guard<mutex> lg(mutex_);
+
+            snapshot.cycles    = cycles_;
+            snapshot.overruns  = overruns_;
+            snapshot.period_ms = period_ms_;
+
+            cycle = cycle_.copy();
+            rtt   = rtt_.copy();
+        }
+
+        // Sorting is left to the reader to keep the poll thread short
+        snapshot.cycle_ms = summarizeSamples(cycle);
+        snapshot.rtt_ms   = summarizeSamples(rtt);
+
+        return snapshot;
+    }
+
+private:
+    mutex mutex_;
+
+    SampleWindow cycle_;
+    SampleWindow rtt_;
+
+    uint64_t cycles_   = 0;
+    uint64_t overruns_ = 0;
+    double period_ms_  = 0;
+};
+
+#endif // POLL_STATS_HPP
@@ -0,0 +1,144 @@
+/**
+ * @file rs485_timing.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Calibrated RS485 timing, persisted per serial port and baudrate
+ * @details DatcCtrl::calibrateTiming() measures the round trip of every polled slave and
+ * derives the RTS delay and the libmodbus timeouts from it. The result is kept in
+ * kRs485TimingFile and applied again the next time the port is opened at that baudrate.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef RS485_TIMING_HPP
+#define RS485_TIMING_HPP
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(WIN64) || defined(_WIN64) || defined(__WIN64__)
+#include "../lib/json.h"
+#else
+#include <jsoncpp/json/json.h>
+#endif
+
+#include "modbus_comm.hpp"
+
+using namespace std;
+
+const char kRs485TimingFile[] = "rs485_timing.json";
+
+/**
+ * @brief Outcome of a calibration, with the poll round it costs before and after.
+ */
+struct TimingCalibration {
+    bool success = false;
+    int baudrate = 0;
+
+    Rs485Timing before;
+    Rs485Timing after;
+
+    map<uint16_t, double> slave_p99_ms; /**< Round trip per answering slave, with the calibrated RTS delay */
+
+    double round_before_ms = 0; /**< Mean time of one poll round (every slave read once) */
+    double round_after_ms  = 0;
+    double missing_slave_before_ms = 0; /**< Time a read of an address nobody polls took to fail, 0: every one tried answered */
+    double missing_slave_after_ms  = 0;
+};
+
+class Rs485TimingStore {
+public:
+    /**
+     * @return false if the port was never calibrated at this baudrate
+     */
+    static bool load(const string &port_name, int baudrate, Rs485Timing &timing) {
+        Json::Value root;
+
+        if (!read(root)) {
+            return false;
+        }
+
+        const Json::Value &entry = root[port_name][to_string(baudrate)];
+
+        if (!entry.isObject()) {
+            return false;
+        }
+
+        timing.rts_delay_us        = entry.get("rts_delay_us"       , timing.rts_delay_us).asUInt();
+        timing.response_timeout_us = entry.get("response_timeout_us", timing.response_timeout_us).asUInt();
+        timing.byte_timeout_us     = entry.get("byte_timeout_us"    , timing.byte_timeout_us).asUInt();
+
+        return true;
+    }
+
+    /**
+     * @brief Replaces the entry of the port at the calibrated baudrate, other entries are kept.
+     */
+    static bool save(const string &port_name, const TimingCalibration &calibration) {
+        Json::Value root;
+        read(root);
+
+        if (!root.isObject()) {
+            root = Json::Value(Json::objectValue);
+        }
+
+        Json::Value &entry = root[port_name][to_string(calibration.baudrate)];
+        entry = toJson(calibration);
+
+        ofstream file(kRs485TimingFile);
+
+        if (!file) {
+            printf("[RS485 Timing] Failed to write %s\n", kRs485TimingFile);
+            return false;
+        }
+
+        Json::StreamWriterBuilder builder;
+        file << Json::writeString(builder, root) << endl;
+
+        return true;
+    }
+
+    static Json::Value toJson(const TimingCalibration &calibration) {
+        Json::Value json;
+
+        json["rts_delay_us"]        = calibration.after.rts_delay_us;
+        json["response_timeout_us"] = calibration.after.response_timeout_us;
+        json["byte_timeout_us"]     = calibration.after.byte_timeout_us;
+
+        for (auto &slave : calibration.slave_p99_ms) {
+            json["rtt_p99_ms"][to_string(slave.first)] = slave.second;
+        }
+
+        json["round_ms"]["before"]         = calibration.round_before_ms;
+        json["round_ms"]["after"]          = calibration.round_after_ms;
+        json["missing_slave_ms"]["before"] = calibration.missing_slave_before_ms;
+        json["missing_slave_ms"]["after"]  = calibration.missing_slave_after_ms;
+
+        return json;
+    }
+
+private:
+    static bool read(Json::Value &root) {
+        ifstream file(kRs485TimingFile);
+
+        if (!file) {
+            return false;
+        }
+
+        Json::CharReaderBuilder builder;
+        string errors;
+
+        if (!Json::parseFromStream(builder, file, &root, &errors)) {
+            printf("[RS485 Timing] %s is not valid Json, ignored\n", kRs485TimingFile);
+            root = Json::Value();
+            return false;
+        }
+
+        return root.isObject();
+    }
+};
+
+#endif // RS485_TIMING_HPP
@@ -0,0 +1,86 @@
+/**
+ * @file seqlock.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Single-writer sequence lock for small trivially copyable values
+ * @details The writer never blocks and readers never lock or allocate: a reader copies the
+ * value and retries if the writer published in the meantime. The value is kept in atomic
+ * words, so a torn copy is detected instead of being a data race.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+using namespace std;
+
+template<typename T>
+class Seqlock {
+    static_assert(is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+    static constexpr size_t kWordNum = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    Seqlock() {
+        store(T());
+    }
+
+    /**
+     * @brief Publishes value. Only one thread may store.
+     */
+    void store(const T &value) {
+        uint64_t words[kWordNum] = {};
+        memcpy(words, &value, sizeof(T));
+
+        const uint32_t seq = seq_.load(memory_order_relaxed);
+
+        // Odd while the words are being written
+        seq_.store(seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        for (size_t i = 0; i < kWordNum; i++) {
+            words_[i].store(words[i], memory_order_relaxed);
+        }
+
+        seq_.store(seq + 2, memory_order_release);
+    }
+
+    T load() const {
+        uint64_t words[kWordNum];
+        uint32_t seq_begin, seq_end;
+
+        do {
+            seq_begin = seq_.load(memory_order_acquire);
+
+            if (seq_begin & 1) {
+                this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < kWordNum; i++) {
+                words[i] = words_[i].load(memory_order_relaxed);
+            }
+
+            atomic_thread_fence(memory_order_acquire);
+            seq_end = seq_.load(memory_order_relaxed);
+        } while ((seq_begin & 1) || seq_begin != seq_end);
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    atomic<uint32_t> seq_ {0};
+    atomic<uint64_t> words_[kWordNum];
+};
+
+#endif // SEQLOCK_HPP
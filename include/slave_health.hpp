@@ -0,0 +1,97 @@
+/**
+ * @file slave_health.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Per-slave health of a polled bus (healthy -> suspect -> down)
+ * @details A failed read makes a slave suspect and kDownAfterFailures failed reads in a row
+ * make it down. A down slave is no longer read every cycle but probed with an exponential
+ * backoff, so it neither costs its response timeout on every tick nor delays the commands
+ * and the other slaves of the bus. Any successful read makes it healthy again.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef SLAVE_HEALTH_HPP
+#define SLAVE_HEALTH_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <string_view>
+
+using namespace std;
+
+enum class SlaveHealth : uint8_t {
+    HEALTHY = 0,
+    SUSPECT = 1, /**< Last read failed, still polled every cycle */
+    DOWN    = 2, /**< Only probed, commands fail fast */
+};
+
+constexpr array<string_view, 3> kSlaveHealthNames = {
+    "healthy",
+    "suspect",
+    "down",
+};
+
+constexpr string_view slaveHealthName(SlaveHealth health) {
+    return kSlaveHealthNames[(size_t) health];
+}
+
+const uint32_t kDownAfterFailures = 3;
+
+const chrono::milliseconds kProbeBackoffMin {100};
+const chrono::milliseconds kProbeBackoffMax {5000};
+
+class SlaveHealthState {
+    using Clock = chrono::steady_clock;
+
+public:
+    /**
+     * @brief Whether the slave is read this cycle. A down slave only when its probe is due.
+     */
+    bool isPollDue(Clock::time_point now) const {
+        return health_ != SlaveHealth::DOWN || now >= next_probe_;
+    }
+
+    /**
+     * @brief Records the result of a read.
+     * @return true if the health changed
+     */
+    bool update(bool success, Clock::time_point now) {
+        const SlaveHealth previous = health_;
+
+        if (success) {
+            health_   = SlaveHealth::HEALTHY;
+            failures_ = 0;
+            backoff_  = kProbeBackoffMin;
+            return health_ != previous;
+        }
+
+        failures_++;
+
+        if (health_ == SlaveHealth::DOWN) {
+            // Failed probe
+            backoff_ = min(backoff_ * 2, chrono::duration_cast<Clock::duration>(kProbeBackoffMax));
+        } else {
+            health_ = (failures_ >= kDownAfterFailures) ? SlaveHealth::DOWN : SlaveHealth::SUSPECT;
+        }
+
+        next_probe_ = now + backoff_;
+
+        return health_ != previous;
+    }
+
+    SlaveHealth get() const {return health_;}
+    uint32_t getFailures() const {return failures_;}
+
+private:
+    SlaveHealth health_ = SlaveHealth::HEALTHY;
+    uint32_t failures_  = 0; /**< Failed reads in a row */
+
+    Clock::duration backoff_ = kProbeBackoffMin;
+    Clock::time_point next_probe_;
+};
+
+#endif // SLAVE_HEALTH_HPP
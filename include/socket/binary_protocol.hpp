@@ -0,0 +1,131 @@
+/**
+ * @file binary_protocol.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief  Compact binary framing used instead of Json once a client asks for it
+ * @details A client switches its connection with the Json message {"protocol":"binary"}.
+ * Every frame afterwards is a 4 byte header (sync 0xDA 0x7C, frame type, payload length)
+ * followed by a fixed-layout little-endian payload.
+ *
+ *  - STATUS       (server -> client, 28 bytes)
+ *      u32 seq, u64 timestamp_us, u16 states, i16 motor_pos, i16 motor_cur,
+ *      i16 motor_vel, u16 finger_pos, u16 voltage, u16 slave, u16 bus
+ *  - COMMAND      (client -> server, 6 or 10 bytes)
+ *      u16 command, i16 value_1, u16 value_2 (same meaning as the Json command)
+ *      [, u16 bus, u16 slave] to address another device than the selected one
+ *  - CHANGE_SLAVE (client -> server, 2 bytes)
+ *      u16 slave address
+ *  - HEALTH       (server -> client, 6 bytes)
+ *      u16 bus, u16 slave, u8 health, u8 previous health (0: healthy, 1: suspect, 2: down)
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef BINARY_PROTOCOL_HPP
+#define BINARY_PROTOCOL_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+namespace tcp_communication {
+namespace binary_protocol {
+
+const uint8_t kSync0 = 0xDA;
+const uint8_t kSync1 = 0x7C;
+
+const size_t kHeaderSize       = 4;
+const size_t kStatusSize       = 28;
+const size_t kCommandSize      = 6;
+const size_t kRoutedCommandSize = 10;
+const size_t kChangeSlaveSize  = 2;
+const size_t kHealthSize       = 6;
+
+enum class FrameType : uint8_t {
+    STATUS       = 1,
+    COMMAND      = 2,
+    CHANGE_SLAVE = 3,
+    HEALTH       = 4,
+};
+
+inline void putU16(char *p, uint16_t v) {
+    p[0] = (char) (v & 0xFF);
+    p[1] = (char) (v >> 8);
+}
+
+inline void putU32(char *p, uint32_t v) {
+    putU16(p    , (uint16_t) (v & 0xFFFF));
+    putU16(p + 2, (uint16_t) (v >> 16));
+}
+
+inline void putU64(char *p, uint64_t v) {
+    putU32(p    , (uint32_t) (v & 0xFFFFFFFF));
+    putU32(p + 4, (uint32_t) (v >> 32));
+}
+
+inline uint16_t getU16(const char *p) {
+    return (uint16_t) ((uint8_t) p[0] | ((uint8_t) p[1] << 8));
+}
+
+inline void putHeader(char *p, FrameType type, uint8_t payload_size) {
+    p[0] = (char) kSync0;
+    p[1] = (char) kSync1;
+    p[2] = (char) type;
+    p[3] = (char) payload_size;
+}
+
+/**
+ * @brief Splits the received byte stream into binary frames, resynchronising on the sync bytes.
+ */
+class BinaryFramer {
+public:
+    void append(const char *data, size_t size) {
+        if (consumed_ > 0) {
+            buffer_.erase(0, consumed_);
+            consumed_ = 0;
+        }
+
+        buffer_.append(data, size);
+    }
+
+    /**
+     * @param payload Points into the internal buffer, valid until the next append().
+     * @return false if more data is needed.
+     */
+    bool next(FrameType &type, const char *&payload, size_t &payload_size) {
+        while (buffer_.size() - consumed_ >= kHeaderSize) {
+            const char *p = buffer_.data() + consumed_;
+
+            if ((uint8_t) p[0] != kSync0 || (uint8_t) p[1] != kSync1) {
+                consumed_++;
+                continue;
+            }
+
+            payload_size = (uint8_t) p[3];
+
+            if (buffer_.size() - consumed_ < kHeaderSize + payload_size) {
+                return false;
+            }
+
+            type    = (FrameType) p[2];
+            payload = p + kHeaderSize;
+
+            consumed_ += kHeaderSize + payload_size;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    string buffer_;
+    size_t consumed_ = 0;
+};
+
+} // namespace binary_protocol
+} // namespace tcp_comm
+#endif
@@ -2,8 +2,9 @@
  * @file concurrent_queue.hpp
  * @author Inhwan Yoon (inhwan94@korea.ac.kr)
  * @brief  A class for temporarily storing data to be processed simultaneously
- * @details This class uses a queue, an STL container, to process communication data
- * accumulated in real time in the form of FIFO (First in, First Out).
+ * @details This class uses a bounded lock-free ring buffer to process communication data
+ * accumulated in real time in the form of FIFO (First in, First Out). The mutex and
+ * condition variable are only touched when a consumer is blocked in waitPop().
  * @version 1.0
  * @date 2022-12-29
  *
@@ -14,49 +15,120 @@
 #ifndef CONCURRENT_QUEUE_HPP
 #define CONCURRENT_QUEUE_HPP
 
-#include <queue>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "ring_buffer.hpp"
 
 using namespace std;
 
 namespace tcp_communication {
 
-template<typename Data>
+template<typename Data, QueueMode Mode = QueueMode::MPMC>
 class ConcurrentQueue {
 public:
-    ConcurrentQueue() {}
-    ConcurrentQueue(const ConcurrentQueue &&rhs) {}
+    static constexpr size_t kDefaultCapacity = 1024;
+
+    explicit ConcurrentQueue(size_t capacity = kDefaultCapacity) : ring_(capacity) {}
+
+    ConcurrentQueue(const ConcurrentQueue &) = delete;
+    ConcurrentQueue &operator=(const ConcurrentQueue &) = delete;
 
 public:
-    void push(Data const &data) {
-        queue_.push(data);
+    /**
+     * @return false if the queue is full and the data was not stored.
+     */
+    bool push(Data const &data) {
+        if (!ring_.tryPush(data)) {
+            return false;
+        }
+
+        notifyWaiters();
+        return true;
+    }
+
+    bool tryPush(Data &&data) {
+        if (!ring_.tryPush(move(data))) {
+            return false;
+        }
+
+        notifyWaiters();
+        return true;
     }
 
     bool empty() const {
-        return queue_.empty();
+        return ring_.empty();
+    }
+
+    size_t size() const {
+        return ring_.size();
     }
 
     bool tryPop(Data &value) {
-        if (queue_.empty()) {
-            return false;
+        return ring_.tryPop(value);
+    }
+
+    /**
+     * @brief Pops up to max_count elements into out.
+     * @return Number of elements popped.
+     */
+    template<typename OutputIt>
+    size_t tryPopBatch(OutputIt out, size_t max_count) {
+        size_t count = 0;
+        Data value;
+
+        while (count < max_count && ring_.tryPop(value)) {
+            *out++ = move(value);
+            count++;
         }
 
-        value = queue_.front();
-        queue_.pop();
-        return true;
+        return count;
     }
 
-    bool clear() {
-        std::queue<Data> empty_queue;
-        queue_ = empty_queue;
-        if (queue_.empty()) {
+    /**
+     * @brief Blocks until data is pushed or the timeout expires.
+     * @return false if the queue was still empty at the timeout.
+     */
+    template<typename Rep, typename Period>
+    bool waitPop(Data &value, const chrono::duration<Rep, Period> &timeout) {
+        if (ring_.tryPop(value)) {
             return true;
-        } else {
-            return false;
         }
+
+        waiters_.fetch_add(1);
+
+        unique_lock<mutex> lg(mutex_);
+        bool popped = cond_.wait_for(lg, timeout, [&] {return ring_.tryPop(value);});
+
+        waiters_.fetch_sub(1);
+        return popped;
+    }
+
+    bool clear() {
+        Data value;
+        while (ring_.tryPop(value)) {}
+
+        return ring_.empty();
     }
 
 private:
-    queue<Data> queue_;
+    void notifyWaiters() {
+        // Pairs with fetch_add in waitPop so that a waiter is either seen here
+        // or sees the pushed data in its predicate.
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if (waiters_.load(memory_order_relaxed) > 0) {
+            { lock_guard<mutex> lg(mutex_); }
+            cond_.notify_all();
+        }
+    }
+
+    RingBuffer<Data, Mode> ring_;
+
+    atomic<int> waiters_ {0};
+    mutex mutex_;
+    condition_variable cond_;
 };
 } // namespace tcp_comm
 #endif
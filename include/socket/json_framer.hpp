@@ -0,0 +1,126 @@
+/**
+ * @file json_framer.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief  Splits a TCP byte stream into complete top-level Json objects
+ * @details Bytes are scanned exactly once. Brace depth and string/escape state are kept
+ * across chunks, so nested objects and braces inside strings are framed correctly and an
+ * object split over several reads is completed by the following ones. Returned frames
+ * point into the internal buffer and stay valid until the next append().
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef JSON_FRAMER_HPP
+#define JSON_FRAMER_HPP
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+namespace tcp_communication {
+
+class JsonFramer {
+public:
+    static constexpr size_t kMaxFrameSize = 64 * 1024; /**< Larger objects are discarded */
+
+    explicit JsonFramer(size_t max_frame_size = kMaxFrameSize) : max_frame_size_(max_frame_size) {}
+
+public:
+    void append(const char *data, size_t size) {
+        // Only the unfinished tail is moved, so the cost per chunk is bounded by one frame
+        if (consumed_ > 0) {
+            buffer_.erase(0, consumed_);
+            cursor_ -= consumed_;
+            if (frame_start_ != string::npos) {
+                frame_start_ -= consumed_;
+            }
+            consumed_ = 0;
+        }
+
+        buffer_.append(data, size);
+    }
+
+    /**
+     * @brief Finds the next complete object in the buffered data.
+     * @param begin, end Set to the frame boundaries [begin, end) on success.
+     * @return false if more data is needed.
+     */
+    bool next(const char *&begin, const char *&end) {
+        const size_t size = buffer_.size();
+
+        while (cursor_ < size) {
+            const char c = buffer_[cursor_++];
+
+            if (depth_ == 0) {
+                // Anything between objects (whitespace, newlines, garbage) is skipped
+                if (c == '{') {
+                    frame_start_ = cursor_ - 1;
+                    depth_ = 1;
+                } else {
+                    consumed_ = cursor_;
+                }
+                continue;
+            }
+
+            if (in_string_) {
+                if (escape_) {
+                    escape_ = false;
+                } else if (c == '\\') {
+                    escape_ = true;
+                } else if (c == '"') {
+                    in_string_ = false;
+                }
+            } else if (c == '"') {
+                in_string_ = true;
+            } else if (c == '{') {
+                depth_++;
+            } else if (c == '}' && --depth_ == 0) {
+                begin = buffer_.data() + frame_start_;
+                end   = buffer_.data() + cursor_;
+
+                frame_start_ = string::npos;
+                consumed_    = cursor_;
+                return true;
+            }
+        }
+
+        if (depth_ > 0 && cursor_ - frame_start_ > max_frame_size_) {
+            reset();
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Bytes after the last returned frame, e.g. to hand over to another framer.
+     */
+    const char *remainingData() const {return buffer_.data() + consumed_;}
+    size_t remainingSize() const {return buffer_.size() - consumed_;}
+
+    void reset() {
+        consumed_    = buffer_.size();
+        cursor_      = buffer_.size();
+        frame_start_ = string::npos;
+        depth_       = 0;
+        in_string_   = false;
+        escape_      = false;
+    }
+
+private:
+    string buffer_;
+    size_t max_frame_size_;
+
+    size_t cursor_      = 0;            /**< Next byte to scan */
+    size_t consumed_    = 0;            /**< Bytes that are no longer needed */
+    size_t frame_start_ = string::npos; /**< Position of the '{' opening the current object */
+
+    int  depth_     = 0;
+    bool in_string_ = false;
+    bool escape_    = false;
+};
+} // namespace tcp_comm
+#endif
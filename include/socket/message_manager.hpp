@@ -12,8 +12,15 @@
 #ifndef MESSAGE_MANAGER_HPP
 #define MESSAGE_MANAGER_HPP
 
+#include <string>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include "concurrent_queue.hpp"
@@ -22,20 +29,104 @@ using namespace std;
 
 namespace tcp_communication {
 
+const size_t kWorkerQueueCapacity  = 1024;
+const size_t kClientQueueCapacity  = 256;
+const size_t kControlQueueCapacity = 64;
+
+/**
+ * @brief A client that drops data and has not taken anything from its queue for this long
+ * is disconnected.
+ */
+const chrono::milliseconds kSlowConsumerTimeout(5000);
+
+/**
+ * @brief Serialised bytes sent to clients. Immutable, so one message can be shared by every client queue.
+ */
+using OutboundMessage = shared_ptr<const string>;
+
+enum class WireFormat : uint8_t {
+    JSON   = 0,
+    BINARY = 1, /**< See binary_protocol.hpp */
+};
+
+const size_t kWireFormatNum = 2;
+
+/**
+ * @brief What a client asked to receive. Derived by the application and kept with the
+ * client queue, so it lives exactly as long as the connection. It may also keep what it
+ * needs to serialise data for its client across publishes, e.g. an encoder and its last frame.
+ */
+class Subscription {
+public:
+    virtual ~Subscription() {}
+};
+
+using SubscriptionPtr = shared_ptr<Subscription>;
+
+/**
+ * @brief How published data (status) is queued for a client that does not keep up.
+ * Replies to a client (pushToClientQueue) are never dropped in either policy.
+ */
+enum class QueuePolicy : uint8_t {
+    BOUNDED_FIFO = 0, /**< Every message in order, the oldest is dropped when the queue is full */
+    LATEST_ONLY  = 1, /**< Only the newest message is kept until the client takes it */
+};
+
+struct ClientQueueStats {
+    uint64_t dropped   = 0; /**< Dropped from a full FIFO */
+    uint64_t conflated = 0; /**< Replaced by a newer message before being sent */
+    size_t   queued    = 0;
+};
+
 template<typename Data>
 class MessageHandler {
+    struct ClientChannel {
+        explicit ClientChannel(size_t capacity) : queue(capacity), control_queue(kControlQueueCapacity) {}
+
+        ConcurrentQueue<OutboundMessage> queue;         /**< Published data, BOUNDED_FIFO */
+        ConcurrentQueue<OutboundMessage> control_queue; /**< Replies, sent before published data */
+        OutboundMessage latest;                         /**< Published data, LATEST_ONLY. Only accessed with atomic_* */
+
+        function<void()> on_push;     /**< Called after data is pushed to the queue */
+        function<void()> on_overflow; /**< Called once when the client is too slow to be served */
+
+        atomic<WireFormat>  format {WireFormat::JSON};
+        atomic<QueuePolicy> policy {QueuePolicy::BOUNDED_FIFO};
+        SubscriptionPtr subscription; /**< nullptr: everything published. Guarded by mutex_client_map_ */
+
+        atomic<uint64_t> dropped   {0};
+        atomic<uint64_t> conflated {0};
+        atomic<int64_t>  last_pop_ms {nowMs()};
+        atomic<bool>     overflowed {false};
+    };
+
+    using ClientChannelPtr = shared_ptr<ClientChannel>;
+
 public:
-    bool createClientQueue(uint32_t id) {
+    MessageHandler() : to_worker_queue_(kWorkerQueueCapacity) {}
+
+    /**
+     * @param on_overflow Called once from a publishing thread when the client is too slow, e.g. to disconnect it
+     */
+    bool createClientQueue(uint32_t id, function<void()> on_push = nullptr, function<void()> on_overflow = nullptr) {
+        unique_lock<shared_mutex> lg(mutex_client_map_);
+
         if (to_client_queue_map_.find(id) != to_client_queue_map_.end()) {
             return false;
         }
 
-        to_client_queue_map_.insert(make_pair(id, ConcurrentQueue<Data>()));
+        auto channel = make_shared<ClientChannel>(kClientQueueCapacity);
+        channel->on_push = move(on_push);
+        channel->on_overflow = move(on_overflow);
+
+        to_client_queue_map_.insert(make_pair(id, channel));
 
         return true;
     }
 
     bool deleteClientQueue(uint32_t id) {
+        unique_lock<shared_mutex> lg(mutex_client_map_);
+
         auto itr = to_client_queue_map_.find(id);
 
         if (itr == to_client_queue_map_.end()) {
@@ -47,10 +138,19 @@ public:
         return true;
     }
 
-    void pushToWorkerQueue(Data const &data) {
-        to_worker_queue_.push(data);
+    /**
+     * @return false if the worker queue is full. The data is dropped and counted, the caller tells its client.
+     */
+    bool pushToWorkerQueue(Data const &data) {
+        if (!to_worker_queue_.push(data)) {
+            worker_dropped_++;
+            return false;
+        }
+        return true;
     }
 
+    uint64_t getWorkerQueueDropped() const {return worker_dropped_;}
+
     bool tryPopFromWokerQueue(Data &data) {
         if (to_worker_queue_.empty()) {
             return false;
@@ -58,46 +158,228 @@ public:
         return to_worker_queue_.tryPop(data);
     }
 
-    void pushToAllClientQueue(Data const &data) {
-        auto ids = getAllClientId();
+    template<typename Rep, typename Period>
+    bool waitPopFromWorkerQueue(Data &data, const chrono::duration<Rep, Period> &timeout) {
+        return to_worker_queue_.waitPop(data, timeout);
+    }
+
+    void pushToAllClientQueue(OutboundMessage const &data) {
+        shared_lock<shared_mutex> lg(mutex_client_map_);
+
+        for (auto &client : to_client_queue_map_) {
+            pushToChannel(*client.second, data);
+        }
+    }
+
+    /**
+     * @brief Pushes the same content to every client in the format it negotiated.
+     * @param encode Called at most once per format: OutboundMessage encode(WireFormat)
+     */
+    template<typename EncodeFn>
+    void publishToAllClientQueue(EncodeFn &&encode) {
+        publishToClientQueue([] (Subscription *) {return true;},
+                             [&] (WireFormat format, Subscription *) {return encode(format);});
+    }
+
+    /**
+     * @brief Same as publishToAllClientQueue, restricted to the clients whose subscription accepts it.
+     * @param accept bool accept(Subscription *), called with nullptr for clients without subscription
+     * @param encode OutboundMessage encode(WireFormat, Subscription *). Clients without subscription
+     * share one message per format (called with nullptr). A subscribed client gets its own, which its
+     * subscription may keep from one publish to the next.
+     */
+    template<typename AcceptFn, typename EncodeFn>
+    void publishToClientQueue(AcceptFn &&accept, EncodeFn &&encode) {
+        array<OutboundMessage, kWireFormatNum> shared; // Indexed by WireFormat
+
+        shared_lock<shared_mutex> lg(mutex_client_map_);
+
+        for (auto &client : to_client_queue_map_) {
+            Subscription *subscription = client.second->subscription.get();
+
+            if (!accept(subscription)) {
+                continue;
+            }
+
+            const WireFormat format = client.second->format.load();
+
+            if (subscription) {
+                pushToChannel(*client.second, encode(format, subscription));
+                continue;
+            }
+
+            OutboundMessage &message = shared[(size_t) format];
+
+            if (!message) {
+                message = encode(format, nullptr);
+            }
+
+            pushToChannel(*client.second, message);
+        }
+    }
+
+    /**
+     * @brief Changes the format of a client with ack as the last message it gets in the old one.
+     * @details Published data still queued in the old format is discarded, the next publish
+     * replaces it. Publishers are held off meanwhile, so none queues old data after the ack.
+     */
+    bool switchClientFormat(uint32_t id, WireFormat format, OutboundMessage const &ack) {
+        ClientChannelPtr channel;
+        bool queued = false;
+
+        {
+            unique_lock<shared_mutex> lg(mutex_client_map_);
+
+            auto itr = to_client_queue_map_.find(id);
+
+            if (itr == to_client_queue_map_.end()) {
+                return false;
+            }
+
+            channel = itr->second;
+            channel->queue.clear();
+            atomic_store(&channel->latest, OutboundMessage());
+
+            queued = channel->control_queue.push(ack);
+            channel->format = format;
+        }
+
+        if (!queued) {
+            reportOverflow(*channel);
+            return false;
+        }
 
-        for (auto id : ids) {
-            pushToClientQueue(id, data);
+        if (channel->on_push) {
+            channel->on_push();
         }
+
+        return true;
     }
 
-    bool pushToClientQueue(uint32_t id, Data const &data) {
+    bool setClientSubscription(uint32_t id, SubscriptionPtr subscription) {
+        unique_lock<shared_mutex> lg(mutex_client_map_);
+
         auto itr = to_client_queue_map_.find(id);
 
         if (itr == to_client_queue_map_.end()) {
             return false;
         }
 
-        // original
-         itr->second.push(data);
+        itr->second->subscription = move(subscription);
+        return true;
+    }
+
+    bool setClientQueuePolicy(uint32_t id, QueuePolicy policy) {
+        auto channel = findClientChannel(id);
 
-        // modified
-//        if (itr->second.empty()) {
-//            itr->second.push(data);
-//        } else {
-//            itr->second.clear();
-//            itr->second.push(data);
-//        }
+        if (!channel) {
+            return false;
+        }
 
+        channel->policy = policy;
         return true;
     }
 
-    bool tryPopFromClientQueue(uint32_t id, Data &data) {
-        auto itr = to_client_queue_map_.find(id);
+    ClientQueueStats getClientQueueStats(uint32_t id) {
+        ClientQueueStats stats;
+        auto channel = findClientChannel(id);
+
+        if (channel) {
+            stats.dropped   = channel->dropped;
+            stats.conflated = channel->conflated;
+            stats.queued    = channel->queue.size() + channel->control_queue.size() + (atomic_load(&channel->latest) ? 1 : 0);
+        }
+
+        return stats;
+    }
+
+    /**
+     * @brief Reply to one client. Never dropped: a client that lets kControlQueueCapacity
+     * replies pile up is treated as a slow consumer instead.
+     */
+    bool pushToClientQueue(uint32_t id, OutboundMessage const &data) {
+        auto channel = findClientChannel(id);
+
+        if (!channel) {
+            return false;
+        }
+
+        if (!channel->control_queue.push(data)) {
+            reportOverflow(*channel);
+            return false;
+        }
+
+        if (channel->on_push) {
+            channel->on_push();
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Event pushed to every client in the format it negotiated, on the reply path, so it
+     * is never dropped or conflated like published data.
+     * @param encode Called at most once per format: OutboundMessage encode(WireFormat)
+     */
+    template<typename EncodeFn>
+    void notifyAllClientQueue(EncodeFn &&encode) {
+        array<OutboundMessage, kWireFormatNum> encoded; // Indexed by WireFormat
+
+        shared_lock<shared_mutex> lg(mutex_client_map_);
+
+        for (auto &client : to_client_queue_map_) {
+            // Read once, the client may switch format meanwhile
+            const WireFormat format = client.second->format.load();
+            OutboundMessage &message = encoded[(size_t) format];
+
+            if (!message) {
+                message = encode(format);
+            }
 
-        if (itr == to_client_queue_map_.end() || itr->second.empty()) {
+            if (!client.second->control_queue.push(message)) {
+                reportOverflow(*client.second);
+                continue;
+            }
+
+            if (client.second->on_push) {
+                client.second->on_push();
+            }
+        }
+    }
+
+    /**
+     * @brief Pops replies first, then published data.
+     */
+    bool tryPopFromClientQueue(uint32_t id, OutboundMessage &data) {
+        auto channel = findClientChannel(id);
+
+        if (!channel) {
             return false;
         }
 
-        return itr->second.tryPop(data);
+        if (channel->control_queue.tryPop(data) || channel->queue.tryPop(data)) {
+            channel->last_pop_ms = nowMs();
+            return true;
+        }
+
+        data = atomic_exchange(&channel->latest, OutboundMessage());
+
+        if (data) {
+            channel->last_pop_ms = nowMs();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool isClientQueueEmpty(uint32_t id) {
+        auto channel = findClientChannel(id);
+        return !channel || (channel->control_queue.empty() && channel->queue.empty() && !atomic_load(&channel->latest));
     }
 
     vector<uint32_t> getAllClientId() {
+        shared_lock<shared_mutex> lg(mutex_client_map_);
+
         vector<uint32_t> ids;
         for (auto itr = to_client_queue_map_.begin(); itr != to_client_queue_map_.end(); itr++) {
             ids.push_back(itr->first);
@@ -106,8 +388,56 @@ public:
     }
 
 private:
+    static int64_t nowMs() {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void pushToChannel(ClientChannel &channel, OutboundMessage const &data) {
+        bool lost = false;
+
+        if (channel.policy == QueuePolicy::LATEST_ONLY) {
+            if (atomic_exchange(&channel.latest, data)) {
+                channel.conflated++;
+                lost = true;
+            }
+        } else {
+            // Drop-oldest keeps the memory of a stalled client bounded and its data fresh
+            while (!channel.queue.push(data)) {
+                OutboundMessage oldest;
+                if (channel.queue.tryPop(oldest)) {
+                    channel.dropped++;
+                    lost = true;
+                }
+            }
+        }
+
+        if (lost && nowMs() - channel.last_pop_ms > kSlowConsumerTimeout.count()) {
+            reportOverflow(channel);
+        }
+
+        if (channel.on_push) {
+            channel.on_push();
+        }
+    }
+
+    void reportOverflow(ClientChannel &channel) {
+        if (!channel.overflowed.exchange(true) && channel.on_overflow) {
+            channel.on_overflow();
+        }
+    }
+
+    ClientChannelPtr findClientChannel(uint32_t id) {
+        shared_lock<shared_mutex> lg(mutex_client_map_);
+
+        auto itr = to_client_queue_map_.find(id);
+        return (itr == to_client_queue_map_.end()) ? nullptr : itr->second;
+    }
+
     ConcurrentQueue<Data> to_worker_queue_;
-    unordered_map<uint32_t, ConcurrentQueue<Data>> to_client_queue_map_;
+    atomic<uint64_t> worker_dropped_ {0}; /**< Messages of any client refused by the full worker queue */
+    unordered_map<uint32_t, ClientChannelPtr> to_client_queue_map_;
+
+    shared_mutex mutex_client_map_;
 };
 
 template<typename Data>
@@ -0,0 +1,160 @@
+/**
+ * @file ring_buffer.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief  Lock-free bounded ring buffer with preallocated slots
+ * @details Every slot is allocated once at construction and reused, so pushing and
+ * popping never touch the heap. The MPMC mode uses a per-slot sequence number so
+ * that any number of producers and consumers can work concurrently; the SPSC mode
+ * drops the sequence handshake and only synchronises the head and tail indices.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+namespace tcp_communication {
+
+enum class QueueMode {
+    SPSC, /**< Single producer, single consumer */
+    MPMC, /**< Multiple producers, multiple consumers */
+};
+
+template<typename Data, QueueMode Mode = QueueMode::MPMC>
+class RingBuffer {
+    static constexpr size_t kCacheLine = 64;
+
+    struct Slot {
+        atomic<size_t> seq;
+        Data data;
+    };
+
+public:
+    /**
+     * @param capacity Number of slots. Rounded up to the next power of two.
+     */
+    explicit RingBuffer(size_t capacity) {
+        capacity_ = 1;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+
+        mask_  = capacity_ - 1;
+        slots_ = unique_ptr<Slot[]>(new Slot[capacity_]);
+
+        for (size_t i = 0; i < capacity_; i++) {
+            slots_[i].seq.store(i, memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+public:
+    template<typename T>
+    bool tryPush(T &&data) {
+        if constexpr (Mode == QueueMode::SPSC) {
+            size_t tail = tail_.load(memory_order_relaxed);
+
+            if (tail - head_.load(memory_order_acquire) >= capacity_) {
+                return false;
+            }
+
+            slots_[tail & mask_].data = forward<T>(data);
+            tail_.store(tail + 1, memory_order_release);
+            return true;
+        } else {
+            size_t pos = tail_.load(memory_order_relaxed);
+            Slot *slot;
+
+            while (true) {
+                slot = &slots_[pos & mask_];
+                size_t seq   = slot->seq.load(memory_order_acquire);
+                intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+
+                if (dif == 0) {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (dif < 0) {
+                    return false; // full
+                } else {
+                    pos = tail_.load(memory_order_relaxed);
+                }
+            }
+
+            slot->data = forward<T>(data);
+            slot->seq.store(pos + 1, memory_order_release);
+            return true;
+        }
+    }
+
+    bool tryPop(Data &value) {
+        if constexpr (Mode == QueueMode::SPSC) {
+            size_t head = head_.load(memory_order_relaxed);
+
+            if (head == tail_.load(memory_order_acquire)) {
+                return false;
+            }
+
+            value = move(slots_[head & mask_].data);
+            head_.store(head + 1, memory_order_release);
+            return true;
+        } else {
+            size_t pos = head_.load(memory_order_relaxed);
+            Slot *slot;
+
+            while (true) {
+                slot = &slots_[pos & mask_];
+                size_t seq   = slot->seq.load(memory_order_acquire);
+                intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+
+                if (dif == 0) {
+                    if (head_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (dif < 0) {
+                    return false; // empty
+                } else {
+                    pos = head_.load(memory_order_relaxed);
+                }
+            }
+
+            value = move(slot->data);
+            slot->seq.store(pos + mask_ + 1, memory_order_release);
+            return true;
+        }
+    }
+
+    /**
+     * @brief Approximate while other threads are pushing or popping.
+     */
+    size_t size() const {
+        size_t tail = tail_.load(memory_order_acquire);
+        size_t head = head_.load(memory_order_acquire);
+        return (tail > head) ? tail - head : 0;
+    }
+
+    bool empty() const {return size() == 0;}
+    size_t capacity() const {return capacity_;}
+
+private:
+    unique_ptr<Slot[]> slots_;
+    size_t capacity_;
+    size_t mask_;
+
+    alignas(kCacheLine) atomic<size_t> head_ {0};
+    alignas(kCacheLine) atomic<size_t> tail_ {0};
+};
+} // namespace tcp_comm
+#endif
@@ -13,8 +13,14 @@
 #ifndef TCP_MANAGER_HPP
 #define TCP_MANAGER_HPP
 
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <boost/asio.hpp>
 #include "message_manager.hpp"
+#include "json_framer.hpp"
+#include "binary_protocol.hpp"
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(WIN64) || defined(_WIN64) || defined(__WIN64__)
 #include "../lib/json.h"
@@ -27,7 +33,7 @@ using namespace tcp_communication;
 
 namespace tcp_communication {
 
-class TcpSocket {
+class TcpSocket : public enable_shared_from_this<TcpSocket> {
     static constexpr int MAX_BUFFER = 1024; /**< Maximum size of buffer */
 public:
     TcpSocket(boost::asio::io_service &io_service);
@@ -39,31 +45,56 @@ public:
     void start();
     void close();
 
-    void writeHandler();
     void readHandler(const boost::system::error_code& err, size_t bytes_transferred);
+    void writeHandler(const boost::system::error_code& err, size_t bytes_transferred);
 
 private:
-    bool parseJsonFromBuffer(Json::Value &json);
+    void startRead();
+    void startWrite();
+    void writeNext();
+
+    void processJson(const char *data, size_t size);
+    void processBinary(const char *data, size_t size);
+    bool handleProtocolRequest(const Json::Value &json);
+
+    /**
+     * @brief Hands a message to the command worker, or answers an error if its queue is full.
+     */
+    void pushToWorker(const Json::Value &json);
 
 private:
     MessageHandler<Json::Value> &message_handler_;
     boost::asio::ip::tcp::socket socket_;
-    string recevied_;
+    boost::asio::io_service::strand strand_; /**< Serialises read, write and close of this socket */
+    uint32_t client_id_ = 0;
+
+    WireFormat format_ = WireFormat::JSON;
+    JsonFramer framer_;
+    binary_protocol::BinaryFramer binary_framer_;
+    unique_ptr<Json::CharReader> json_reader_; /**< Reused for every received frame */
     char buffer_[MAX_BUFFER];
+
+    OutboundMessage write_message_; /**< Kept alive until the pending async_write completes */
+    atomic<bool> writing_ {false};  /**< true while an async_write chain is draining the queue */
+    atomic<bool> closed_  {false};
 };
 
 class TcpServer {
 public:
-    TcpServer(const int port = 8421);
+    /**
+     * @param io_thread_num Number of threads running the io_service (0: one per core)
+     */
+    TcpServer(const int port = 8421, size_t io_thread_num = 0);
     ~TcpServer();
 
 public:
     void startAccept();
-    void acceptHandler(TcpSocket *socket, const boost::system::error_code& err);
+    void acceptHandler(shared_ptr<TcpSocket> socket, const boost::system::error_code& err);
 
 private:
     boost::asio::io_service io_service_;
     boost::asio::ip::tcp::acceptor acceptor_;
+    vector<std::thread> io_threads_;
 };
 } // namespace tcp_comm
 #endif
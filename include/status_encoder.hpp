@@ -0,0 +1,192 @@
+/**
+ * @file status_encoder.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Serialises DatcStatus for the TCP clients (Json or binary) without heap allocation
+ * @details The status is written once per cycle into a pooled, preallocated buffer by a
+ * fixed-schema writer, and the same immutable buffer is shared by every client queue.
+ * A buffer returns to the pool as soon as the last client finished writing it.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef STATUS_ENCODER_HPP
+#define STATUS_ENCODER_HPP
+
+#include <atomic>
+#include <limits>
+#include <charconv>
+#include <string>
+#include <vector>
+#include <memory>
+#include <string_view>
+
+#include "datc_ctrl.hpp"
+#include "socket/message_manager.hpp"
+#include "socket/binary_protocol.hpp"
+
+using namespace std;
+using namespace tcp_communication;
+
+/**
+ * @brief Status fields in the key order of the Json status message.
+ */
+enum class StatusField : uint8_t {
+    FINGER_POS = 0,
+    MOTOR_CUR  = 1,
+    MOTOR_POS  = 2,
+    MOTOR_VEL  = 3,
+    STATES     = 4,
+    VOLTAGE    = 5,
+};
+
+const size_t kStatusFieldNum = 6;
+
+const uint32_t kAllStatusFields = (1 << kStatusFieldNum) - 1;
+
+constexpr array<string_view, kStatusFieldNum> kStatusFieldNames = {
+    "finger_pos",
+    "motor_cur",
+    "motor_pos",
+    "motor_vel",
+    "states",
+    "voltage",
+};
+
+inline int32_t statusFieldValue(const DatcStatus &status, StatusField field) {
+    switch (field) {
+        case StatusField::FINGER_POS: return status.finger_pos;
+        case StatusField::MOTOR_CUR:  return status.motor_cur;
+        case StatusField::MOTOR_POS:  return status.motor_pos;
+        case StatusField::MOTOR_VEL:  return status.motor_vel;
+        case StatusField::STATES:     return status.states;
+        case StatusField::VOLTAGE:    return status.voltage;
+    }
+    return 0;
+}
+
+class StatusEncoder {
+    static constexpr size_t kPoolSize      = 16;
+    static constexpr size_t kFrameCapacity = 256;
+
+public:
+    StatusEncoder() {
+        pool_.reserve(kPoolSize);
+
+        for (size_t i = 0; i < kPoolSize; i++) {
+            pool_.push_back(make_shared<string>());
+            pool_.back()->reserve(kFrameCapacity);
+        }
+    }
+
+    /**
+     * @brief Same output as Json::FastWriter on the legacy six-key status object.
+     * @param with_address Adds the "bus" and "slave" keys when several devices are polled
+     * @param field_mask Bit (1 << StatusField) selects a field, the address keys are always sent
+     */
+    OutboundMessage encodeJson(const DatcStatus &status, bool with_address = false, uint16_t bus_id = 0, uint16_t slave_addr = 0,
+                               uint32_t field_mask = kAllStatusFields) {
+        auto frame = acquireFrame();
+        bool first = true;
+
+        auto appendFn = [&] (const char *key, int32_t value) {
+            if (!first) {
+                frame->push_back(',');
+            }
+            appendField(*frame, key, value);
+            first = false;
+        };
+
+        auto appendStatusFn = [&] (StatusField field, const char *key) {
+            if (field_mask & (1 << (int) field)) {
+                appendFn(key, statusFieldValue(status, field));
+            }
+        };
+
+        // Keys in the alphabetical order used by Json::Value
+        frame->push_back('{');
+        if (with_address) {
+            appendFn("\"bus\":", bus_id);
+        }
+        appendStatusFn(StatusField::FINGER_POS, "\"finger_pos\":");
+        appendStatusFn(StatusField::MOTOR_CUR , "\"motor_cur\":");
+        appendStatusFn(StatusField::MOTOR_POS , "\"motor_pos\":");
+        appendStatusFn(StatusField::MOTOR_VEL , "\"motor_vel\":");
+        if (with_address) {
+            appendFn("\"slave\":", slave_addr);
+        }
+        appendStatusFn(StatusField::STATES    , "\"states\":");
+        appendStatusFn(StatusField::VOLTAGE   , "\"voltage\":");
+        frame->append("}\n");
+
+        return frame;
+    }
+
+    /**
+     * @brief STATUS frame of the binary protocol (see binary_protocol.hpp).
+     */
+    OutboundMessage encodeBinary(const DatcStatus &status, uint16_t bus_id, uint16_t slave_addr, uint32_t seq, uint64_t timestamp_us) {
+        using namespace binary_protocol;
+
+        auto frame = acquireFrame();
+        frame->resize(kHeaderSize + kStatusSize);
+
+        char *p = &(*frame)[0];
+        putHeader(p, FrameType::STATUS, kStatusSize);
+        p += kHeaderSize;
+
+        putU32(p     , seq);
+        putU64(p +  4, timestamp_us);
+        putU16(p + 12, status.states);
+        putU16(p + 14, (uint16_t) status.motor_pos);
+        putU16(p + 16, (uint16_t) status.motor_cur);
+        putU16(p + 18, (uint16_t) status.motor_vel);
+        putU16(p + 20, status.finger_pos);
+        putU16(p + 22, status.voltage);
+        putU16(p + 24, slave_addr);
+        putU16(p + 26, bus_id);
+
+        return frame;
+    }
+
+protected:
+    /**
+     * @brief Returns a cleared buffer that no client queue references any more.
+     * @details A buffer is free again when use_count() drops back to 1. A frame kept in a shared_ptr,
+     * such as the last frame of a StatusSubscription, simply stays out of the pool until released.
+     * Never keep one in a weak_ptr: use_count() does not see it, and the buffer would be rewritten
+     * under it.
+     */
+    shared_ptr<string> acquireFrame() {
+        for (auto &frame : pool_) {
+            if (frame.use_count() == 1) {
+                // Orders our writes after the last client's release of the buffer
+                atomic_thread_fence(memory_order_acquire);
+                frame->clear();
+                return frame;
+            }
+        }
+
+        // Every pooled buffer is still queued to a slow client
+        auto frame = make_shared<string>();
+        frame->reserve(kFrameCapacity);
+        return frame;
+    }
+
+    template<typename T>
+    static void appendField(string &frame, const char *key, T value) {
+        static_assert(is_integral<T>::value && sizeof(T) <= sizeof(int64_t), "Status fields are integers");
+
+        // digits10 + 1 digits at most, and the sign
+        char num[numeric_limits<T>::digits10 + 3];
+        auto result = to_chars(num, num + sizeof(num), value);
+
+        frame.append(key);
+        frame.append(num, result.ptr);
+    }
+
+    vector<shared_ptr<string>> pool_;
+};
+
+#endif // STATUS_ENCODER_HPP
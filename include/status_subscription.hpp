@@ -0,0 +1,213 @@
+/**
+ * @file status_subscription.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Per-client policy deciding when a DATC status is worth sending
+ * @details A client sends {"subscribe": {...}} to replace the default (every status at the
+ * poll rate) by change-driven publishing: only statuses that moved past the per-field
+ * deadbands are sent, no faster than max_rate, and at least every heartbeat seconds.
+ * "fields" restricts the message to a subset of keys and "decimation" sends every Nth poll.
+ * Each subscription serialises with its own encoder, and resends the last Json frame of a device
+ * as long as its status does not change.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef STATUS_SUBSCRIPTION_HPP
+#define STATUS_SUBSCRIPTION_HPP
+
+#include <map>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(WIN64) || defined(_WIN64) || defined(__WIN64__)
+#include "../lib/json.h"
+#else
+#include <jsoncpp/json/json.h>
+#endif
+
+#include "datc_ctrl.hpp"
+#include "status_encoder.hpp"
+#include "socket/message_manager.hpp"
+
+using namespace std;
+using namespace tcp_communication;
+
+struct PublishPolicy {
+    bool on_change = false; /**< Only send statuses that differ from the last one sent */
+    double max_rate  = 0;   /**< Hz, 0: poll rate */
+    double heartbeat = 0;   /**< s, an unchanged status is resent after this long. 0: never */
+
+    /**
+     * @brief A change smaller or equal to the deadband is ignored. "states" has none, every bit counts.
+     */
+    array<int32_t, kStatusFieldNum> deadband = {};
+
+    uint32_t field_mask = kAllStatusFields; /**< Bit (1 << StatusField) per field sent */
+    uint32_t decimation = 1;                /**< Only every Nth status of a device is considered */
+};
+
+class StatusSubscription : public Subscription {
+    using Clock = chrono::steady_clock;
+
+    struct DeviceState {
+        DatcStatus last_sent;
+        Clock::time_point last_sent_time;
+        bool sent = false;
+
+        uint32_t tick = 0;
+
+        OutboundMessage frame; /**< Last Json message of the device, nullptr: none yet */
+        DatcStatus frame_status;
+        bool frame_with_address = false;
+    };
+
+public:
+    explicit StatusSubscription(const PublishPolicy &policy) : policy_(policy) {}
+
+    /**
+     * @brief Tells apart the devices published to the same client.
+     */
+    static uint32_t deviceKey(uint16_t bus_id, uint16_t slave_addr) {
+        return ((uint32_t) bus_id << 16) | slave_addr;
+    }
+
+    /**
+     * @brief Parses the body of a "subscribe" message. Unknown keys are ignored.
+     */
+    static PublishPolicy parsePolicy(const Json::Value &json) {
+        PublishPolicy policy;
+
+        policy.on_change = json.get("on_change", false).asBool();
+        policy.max_rate  = json.get("max_rate" , 0).asDouble();
+        policy.heartbeat = json.get("heartbeat", 0).asDouble();
+
+        const Json::Value &deadband = json["deadband"];
+
+        if (deadband.isObject()) {
+            for (size_t i = 0; i < kStatusFieldNum; i++) {
+                const string name(kStatusFieldNames[i]);
+
+                if (deadband.isMember(name)) {
+                    policy.deadband[i] = abs(deadband[name].asInt());
+                }
+            }
+        }
+
+        policy.deadband[(size_t) StatusField::STATES] = 0;
+
+        const Json::Value &fields = json["fields"];
+
+        if (fields.isArray()) {
+            policy.field_mask = 0;
+
+            for (auto &field : fields) {
+                for (size_t i = 0; i < kStatusFieldNum; i++) {
+                    if (field.isString() && field.asString() == kStatusFieldNames[i]) {
+                        policy.field_mask |= (1 << i);
+                    }
+                }
+            }
+        }
+
+        policy.decimation = max(json.get("decimation", 1).asUInt(), 1u);
+
+        return policy;
+    }
+
+    /**
+     * @brief Decides whether status of the device is sent now, and remembers it if so.
+     * @param device_key See deviceKey()
+     */
+    bool shouldPublish(uint32_t device_key, const DatcStatus &status, Clock::time_point now) {
+        lock_guard<mutex> lg(mutex_);
+
+        auto &device = devices_[device_key];
+
+        if (device.tick++ % policy_.decimation != 0) {
+            return false;
+        }
+
+        if (device.sent) {
+            const chrono::duration<double> elapsed = now - device.last_sent_time;
+
+            if (policy_.max_rate > 0 && elapsed.count() < 1 / policy_.max_rate) {
+                // Not lost: still differs from last_sent on the next tick
+                return false;
+            }
+
+            const bool heartbeat_due = policy_.heartbeat > 0 && elapsed.count() >= policy_.heartbeat;
+
+            if (policy_.on_change && !heartbeat_due && !isChanged(device.last_sent, status)) {
+                return false;
+            }
+        }
+
+        device.last_sent      = status;
+        device.last_sent_time = now;
+        device.sent           = true;
+
+        return true;
+    }
+
+    /**
+     * @brief Message for a status that shouldPublish() let through.
+     * @details Binary frames carry the sequence number of the read, so only a Json frame can be sent
+     * again: an idle gripper or a heartbeat resends it without serialising anything.
+     */
+    OutboundMessage encode(uint32_t device_key, WireFormat format, const DatcStatusSnapshot &snapshot, bool with_address) {
+        lock_guard<mutex> lg(mutex_);
+
+        const uint16_t bus_id     = (uint16_t) (device_key >> 16);
+        const uint16_t slave_addr = (uint16_t) (device_key & 0xFFFF);
+
+        if (format == WireFormat::BINARY) {
+            return encoder_.encodeBinary(snapshot.status, bus_id, slave_addr, snapshot.seq, snapshot.timestamp_us);
+        }
+
+        auto &device = devices_[device_key];
+
+        if (!device.frame || device.frame_with_address != with_address || isChanged(device.frame_status, snapshot.status, kNoDeadband)) {
+            device.frame              = encoder_.encodeJson(snapshot.status, with_address, bus_id, slave_addr, policy_.field_mask);
+            device.frame_status       = snapshot.status;
+            device.frame_with_address = with_address;
+        }
+
+        return device.frame;
+    }
+
+private:
+    static constexpr array<int32_t, kStatusFieldNum> kNoDeadband = {};
+
+    bool isChanged(const DatcStatus &last, const DatcStatus &status) const {
+        return isChanged(last, status, policy_.deadband);
+    }
+
+    bool isChanged(const DatcStatus &last, const DatcStatus &status, const array<int32_t, kStatusFieldNum> &deadband) const {
+        // Fields the client did not ask for never trigger a message
+        for (size_t i = 0; i < kStatusFieldNum; i++) {
+            if (!(policy_.field_mask & (1 << i))) {
+                continue;
+            }
+
+            const int32_t diff = statusFieldValue(status, (StatusField) i) - statusFieldValue(last, (StatusField) i);
+
+            if (abs(diff) > deadband[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const PublishPolicy policy_;
+
+    map<uint32_t, DeviceState> devices_;
+    StatusEncoder encoder_;
+    mutex mutex_; /**< Buses publish from their own threads */
+};
+
+#endif // STATUS_SUBSCRIPTION_HPP
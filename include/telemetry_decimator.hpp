@@ -0,0 +1,105 @@
+/**
+ * @file telemetry_decimator.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Min/max decimation of telemetry samples into pixel columns for the telemetry plot
+ * @details Every column keeps the min, max, first and last value of the samples falling into
+ * its time slice. Columns are a ring indexed by slice modulo the width, so a new slice scrolls
+ * the oldest one out and a sample costs the same whatever the window length.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef TELEMETRY_DECIMATOR_HPP
+#define TELEMETRY_DECIMATOR_HPP
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "telemetry_ring.hpp"
+
+using namespace std;
+
+class TelemetryDecimator {
+public:
+    struct Column {
+        bool valid = false;
+        array<int32_t, kTelemetryChannelNum> min   = {};
+        array<int32_t, kTelemetryChannelNum> max   = {};
+        array<int32_t, kTelemetryChannelNum> first = {}; /**< first and last join the neighbouring columns */
+        array<int32_t, kTelemetryChannelNum> last  = {};
+    };
+
+    /**
+     * @brief Drops every column and splits the window into width slices.
+     */
+    void reset(int width, uint64_t window_us) {
+        columns_.assign(max(width, 1), Column());
+        slice_us_     = max(window_us / columns_.size(), (uint64_t) 1);
+        latest_slice_ = -1;
+    }
+
+    void addSample(const TelemetrySample &sample) {
+        const int64_t width = (int64_t) columns_.size();
+        const int64_t slice = (int64_t) (sample.timestamp_us / slice_us_);
+
+        if (latest_slice_ >= 0 && slice <= latest_slice_ - width) {
+            // Older than the window
+            return;
+        }
+
+        if (slice > latest_slice_) {
+            // Columns scrolled in start empty
+            const int64_t first = (latest_slice_ < 0) ? slice : max(latest_slice_ + 1, slice - width + 1);
+
+            for (int64_t i = first; i <= slice; i++) {
+                columns_[i % width] = Column();
+            }
+
+            latest_slice_ = slice;
+        }
+
+        Column &column = columns_[slice % width];
+
+        if (!column.valid) {
+            column.valid = true;
+            column.min   = sample.values;
+            column.max   = sample.values;
+            column.first = sample.values;
+            column.last  = sample.values;
+            return;
+        }
+
+        for (size_t channel = 0; channel < kTelemetryChannelNum; channel++) {
+            column.min[channel] = min(column.min[channel], sample.values[channel]);
+            column.max[channel] = max(column.max[channel], sample.values[channel]);
+        }
+
+        column.last = sample.values;
+    }
+
+    /**
+     * @param x Pixel column, 0 is the oldest and getWidth() - 1 the latest slice
+     * @return nullptr if no sample fell into it
+     */
+    const Column *column(int x) const {
+        const int64_t width = (int64_t) columns_.size();
+        const int64_t slice = latest_slice_ - (width - 1 - x);
+
+        return (slice >= 0 && columns_[slice % width].valid) ? &columns_[slice % width] : nullptr;
+    }
+
+    bool isEmpty() const {return latest_slice_ < 0;}
+    int getWidth() const {return (int) columns_.size();}
+    uint64_t getSliceUs() const {return slice_us_;}
+
+private:
+    vector<Column> columns_ = vector<Column>(1); /**< One per pixel, indexed by time slice modulo the width */
+    int64_t latest_slice_ = -1;
+    uint64_t slice_us_    = 1;
+};
+
+#endif // TELEMETRY_DECIMATOR_HPP
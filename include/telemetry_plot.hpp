@@ -0,0 +1,70 @@
+/**
+ * @file telemetry_plot.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Live plot of the TelemetryRing, decimated to min/max per pixel column
+ * @details New samples are folded into the columns of a TelemetryDecimator as they arrive, so
+ * a refresh costs the new samples plus one vertical line per column and channel, whatever the
+ * window length. Every channel is scaled to its own visible range.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef TELEMETRY_PLOT_HPP
+#define TELEMETRY_PLOT_HPP
+
+#include <QTimer>
+#include <QWidget>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "telemetry_decimator.hpp"
+
+using namespace std;
+
+const int kPlotRefreshPeriod = 33; // msec
+
+const uint64_t kPlotWindowDefaultUs = 10000000;
+const uint64_t kPlotRebuildSamples  = 4096;   /**< Larger backlog: columns rebuilt from the window start */
+const uint64_t kPlotMaxGapUs        = 200000; /**< Columns without samples bridged up to this long */
+
+class TelemetryPlot : public QWidget {
+    Q_OBJECT
+
+public:
+    TelemetryPlot(QWidget *parent = nullptr);
+
+    void setRing(const TelemetryRing *ring);
+    void setWindow(uint64_t window_us);
+    void setChannelVisible(TelemetryChannel channel, bool visible);
+    void setPaused(bool paused);
+
+public Q_SLOTS:
+    void refresh();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    void rebuild();
+    void readNewSamples();
+    QRect plotArea() const;
+
+    const TelemetryRing *ring_ = nullptr;
+    uint64_t read_index_ = 0;
+    vector<TelemetrySample> new_samples_; /**< Reused, never more than kPlotRebuildSamples */
+
+    TelemetryDecimator decimator_;
+    uint64_t window_us_ = kPlotWindowDefaultUs;
+
+    array<bool, kTelemetryChannelNum> visible_ = {};
+    bool paused_ = false;
+
+    QTimer *timer_;
+};
+
+#endif // TELEMETRY_PLOT_HPP
@@ -0,0 +1,202 @@
+/**
+ * @file telemetry_recorder.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Binary log of every status read and every command of a bus, in memory-mapped segment files
+ * @details A segment is a file preallocated to kRecorderSegmentSize and mapped into memory: a
+ * RecorderFileHeader followed by fixed-size records in the order they were appended. Appending
+ * copies one record into the mapping under a short lock, it never touches the disk. A background
+ * thread flushes the written pages, opens the next segment ahead of time and closes the full ones,
+ * so rotation (by size or by age) is a pointer swap. If the next segment is not ready when the
+ * current one is full, records are dropped and counted instead of waiting.
+ * A closed segment is truncated to its records and its header holds the record count. A segment
+ * left open by a crash has record_count 0 and a zero-filled tail: read up to the first record of
+ * type 0. Record timestamps are steady_clock microseconds, the header pairs one with the wall clock.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef TELEMETRY_RECORDER_HPP
+#define TELEMETRY_RECORDER_HPP
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+using namespace std;
+
+const char kRecorderDirectory[] = "telemetry_log";
+const char kRecorderMagic[8]    = {'K', 'R', 'D', 'A', 'T', 'C', 'L', 'G'};
+
+const uint16_t kRecorderVersion     = 1;
+const size_t kRecorderMaxSlaves     = 16;
+const size_t kRecorderPortNameSize  = 32;
+const size_t kRecorderCommandRegNum = 4;
+
+const uint64_t kRecorderSegmentSize    = 64 << 20; /**< ~4.4 minutes at 500 Hz x 16 slaves */
+const uint64_t kRecorderSegmentMinSize = 1 << 20;
+const std::chrono::seconds kRecorderSegmentDuration {600};
+const std::chrono::milliseconds kRecorderFlushInterval {1000};
+
+enum class RecordType : uint8_t {
+    NONE    = 0, /**< Not written yet */
+    STATUS  = 1,
+    COMMAND = 2,
+};
+
+struct RecorderFileHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t record_size;
+    uint16_t bus_id;
+    uint32_t baudrate;
+    uint32_t segment_index;  /**< 0 for the first segment of a recording */
+    uint64_t unix_time_us;   /**< Wall clock at steady_time_us, to convert the record timestamps */
+    uint64_t steady_time_us;
+    uint64_t record_count;   /**< Written when the segment is closed */
+    uint16_t selected_slave;
+    uint16_t poll_slave_num;
+    char port_name[kRecorderPortNameSize];
+    uint16_t poll_slaves[kRecorderMaxSlaves]; /**< When the recording started */
+    uint8_t reserved[12];
+};
+
+struct StatusRecord {
+    uint64_t timestamp_us; /**< steady_clock time of the read */
+    RecordType type;
+    uint8_t reserved_1;
+    uint16_t slave_addr;
+    uint32_t seq;          /**< DatcStatusSnapshot::seq, gaps are failed reads */
+    uint16_t states;       /**< Raw status register */
+    int16_t motor_pos;
+    int16_t motor_vel;
+    int16_t motor_cur;
+    uint16_t finger_pos;
+    uint16_t voltage;
+    uint8_t reserved_2[4];
+};
+
+struct CommandRecord {
+    uint64_t timestamp_us; /**< steady_clock time the command completed */
+    RecordType type;
+    uint8_t result;        /**< 1: written, 0: failed */
+    uint16_t slave_addr;
+    uint16_t reg_num;
+    uint16_t reserved_1;
+    uint16_t regs[kRecorderCommandRegNum]; /**< regs[0] is the DATC_COMMAND, then its values */
+    uint8_t reserved_2[8];
+};
+
+const size_t kRecordSize = 32;
+
+static_assert(sizeof(RecorderFileHeader) == 128, "The file header is part of the log format");
+static_assert(sizeof(StatusRecord) == kRecordSize && sizeof(CommandRecord) == kRecordSize,
+              "Records are part of the log format");
+
+struct RecorderConfig {
+    string directory = kRecorderDirectory;
+    uint16_t bus_id  = 0;
+    string port_name;
+    uint32_t baudrate = 0;
+    uint16_t selected_slave = 0;
+    vector<uint16_t> poll_slaves;
+
+    uint64_t segment_size = kRecorderSegmentSize;
+    std::chrono::seconds segment_duration = kRecorderSegmentDuration;
+};
+
+struct RecorderStats {
+    uint64_t records  = 0;
+    uint64_t dropped  = 0; /**< The next segment was not ready, or could not be created */
+    uint32_t segments = 0;
+    string file_name;      /**< Segment currently written */
+};
+
+class TelemetryRecorder {
+public:
+    TelemetryRecorder() = default;
+    ~TelemetryRecorder();
+
+    TelemetryRecorder(const TelemetryRecorder &) = delete;
+    TelemetryRecorder &operator=(const TelemetryRecorder &) = delete;
+
+    /**
+     * @brief Creates the directory and the first segment, and starts the background thread.
+     */
+    bool start(const RecorderConfig &config);
+
+    /**
+     * @brief Closes the current segment and removes the one prepared ahead.
+     */
+    void stop();
+
+    /**
+     * @return false if the record was dropped
+     */
+    bool append(const StatusRecord &record) {return append(&record);}
+    bool append(const CommandRecord &record) {return append(&record);}
+
+    RecorderStats getStats();
+
+private:
+    struct MappedFile {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(WIN64) || defined(_WIN64) || defined(__WIN64__)
+        void *file    = nullptr;
+        void *mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+        uint8_t *base = nullptr;
+        uint64_t size = 0;
+    };
+
+    struct Segment {
+        MappedFile file;
+        string path;
+        uint64_t capacity = 0; /**< Records */
+        uint64_t count    = 0; /**< Records appended, guarded by mutex_ */
+        uint64_t flushed  = 0; /**< Bytes handed to the OS, background thread only */
+        std::chrono::steady_clock::time_point start_time;
+
+        RecorderFileHeader *header() {return (RecorderFileHeader *) file.base;}
+        uint8_t *records() {return file.base + sizeof(RecorderFileHeader);}
+    };
+
+    bool append(const void *record);
+    bool rotate();
+    unique_ptr<Segment> openSegment(uint32_t index);
+    void closeSegment(Segment &segment, bool remove_file = false);
+    void flushSegment(Segment &segment, uint64_t count);
+    void flushLoop();
+
+    static bool mapFile(const string &path, uint64_t size, MappedFile &file);
+    static void flushFile(MappedFile &file, uint64_t offset, uint64_t length, bool wait);
+    static void unmapFile(MappedFile &file, uint64_t truncate_size);
+
+    RecorderConfig config_;
+    string file_prefix_; /**< Directory, bus and start time, the segment index is appended */
+
+    unique_ptr<Segment> current_;
+    unique_ptr<Segment> next_;
+    vector<unique_ptr<Segment>> retired_; /**< Full or expired, closed by the background thread */
+    uint32_t next_index_ = 0;  /**< Background thread only once started */
+    bool need_next_ = false;   /**< next_ was taken, wakes the background thread */
+    bool stop_ = false;
+
+    uint64_t records_  = 0;
+    uint64_t dropped_  = 0;
+    uint32_t segments_ = 0;
+
+    mutex mutex_; /**< Never held across file I/O */
+    condition_variable cond_;
+    std::thread flush_thread_;
+};
+
+#endif // TELEMETRY_RECORDER_HPP
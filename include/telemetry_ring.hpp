@@ -0,0 +1,192 @@
+/**
+ * @file telemetry_ring.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Fixed-capacity, lock-free history of the polled status for the telemetry plot
+ * @details One writer (the poll thread) appends a sample per read and overwrites the oldest
+ * one when the ring is full, so memory stays at kTelemetryCapacity samples however long it
+ * runs. Readers never lock: they copy by index and drop what the writer overwrote meanwhile.
+ * Like Seqlock, samples are kept in atomic words, so a torn copy is detected instead of
+ * being a data race.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef TELEMETRY_RING_HPP
+#define TELEMETRY_RING_HPP
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+using namespace std;
+
+enum class TelemetryChannel : uint8_t {
+    MOTOR_POS  = 0,
+    MOTOR_VEL  = 1,
+    MOTOR_CUR  = 2,
+    FINGER_POS = 3,
+    VOLTAGE    = 4,
+};
+
+const size_t kTelemetryChannelNum = 5;
+
+constexpr array<string_view, kTelemetryChannelNum> kTelemetryChannelNames = {
+    "motor_pos",
+    "motor_vel",
+    "motor_cur",
+    "finger_pos",
+    "voltage",
+};
+
+const size_t kTelemetryCapacity = 1 << 18; /**< ~8.7 minutes at 500 Hz, 8 MB */
+
+struct TelemetrySample {
+    uint64_t timestamp_us = 0; /**< steady_clock time of the read */
+    array<int32_t, kTelemetryChannelNum> values = {}; /**< Indexed by TelemetryChannel */
+};
+
+class TelemetryRing {
+    static_assert((kTelemetryCapacity & (kTelemetryCapacity - 1)) == 0, "Capacity must be a power of two");
+
+    static constexpr size_t kWordNum = (sizeof(TelemetrySample) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    TelemetryRing() : words_(new atomic<uint64_t>[kTelemetryCapacity * kWordNum]) {}
+
+    /**
+     * @brief Appends a sample, overwriting the oldest one if full. Only one thread may push.
+     */
+    void push(const TelemetrySample &sample) {
+        uint64_t words[kWordNum] = {};
+        memcpy(words, &sample, sizeof(TelemetrySample));
+
+        const uint64_t index = head_.load(memory_order_relaxed);
+        atomic<uint64_t> *slot = &words_[(index & kMask) * kWordNum];
+
+        // Announced before the slot is touched, readers check writing_ after copying and drop that slot
+        writing_.store(index + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        for (size_t i = 0; i < kWordNum; i++) {
+            slot[i].store(words[i], memory_order_relaxed);
+        }
+
+        head_.store(index + 1, memory_order_release);
+    }
+
+    /**
+     * @return Index the next push() gets, samples [getHead() - kTelemetryCapacity, getHead()) are kept
+     */
+    uint64_t getHead() const {return head_.load(memory_order_acquire);}
+
+    /**
+     * @return Oldest index still readable
+     */
+    uint64_t getTail() const {
+        const uint64_t head = getHead();
+        return (head > kTelemetryCapacity - 1) ? head - (kTelemetryCapacity - 1) : 0;
+    }
+
+    /**
+     * @brief Copies the samples from index "from" up to the head.
+     * @param from Advanced past the copied samples. Moved to the oldest kept one if the writer overran it.
+     * @param max_num Most samples copied at once
+     * @return Number of samples appended to out
+     */
+    size_t read(uint64_t &from, vector<TelemetrySample> &out, size_t max_num = kTelemetryCapacity) const {
+        const uint64_t head = getHead();
+
+        if (from < getTail()) {
+            from = getTail();
+        }
+
+        const uint64_t end = min(head, from + max_num);
+        const size_t out_begin = out.size();
+
+        for (uint64_t index = from; index < end; index++) {
+            out.push_back(load(index));
+        }
+
+        // Everything the writer may have been rewriting while we copied is dropped
+        atomic_thread_fence(memory_order_acquire);
+        const uint64_t writing = writing_.load(memory_order_relaxed);
+        const uint64_t valid_from = (writing > kTelemetryCapacity) ? writing - kTelemetryCapacity : 0;
+
+        if (from < valid_from) {
+            const size_t torn = (size_t) min(valid_from - from, end - from);
+            out.erase(out.begin() + out_begin, out.begin() + out_begin + torn);
+        }
+
+        from = end;
+        return out.size() - out_begin;
+    }
+
+    /**
+     * @brief Copies one sample.
+     * @return false if it is not (or no longer) in the ring
+     */
+    bool at(uint64_t index, TelemetrySample &sample) const {
+        if (index < getTail() || index >= getHead()) {
+            return false;
+        }
+
+        sample = load(index);
+
+        atomic_thread_fence(memory_order_acquire);
+        const uint64_t writing = writing_.load(memory_order_relaxed);
+
+        return writing <= kTelemetryCapacity || index >= writing - kTelemetryCapacity;
+    }
+
+    /**
+     * @brief Oldest kept index whose timestamp is at or after timestamp_us (samples are in time order).
+     */
+    uint64_t findTime(uint64_t timestamp_us) const {
+        uint64_t low  = getTail();
+        uint64_t high = getHead();
+
+        while (low < high) {
+            const uint64_t mid = low + (high - low) / 2;
+            TelemetrySample sample;
+
+            if (!at(mid, sample)) {
+                // Overwritten meanwhile, it was older than anything asked for
+                low = mid + 1;
+            } else if (sample.timestamp_us < timestamp_us) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        return low;
+    }
+
+private:
+    static constexpr uint64_t kMask = kTelemetryCapacity - 1;
+
+    TelemetrySample load(uint64_t index) const {
+        const atomic<uint64_t> *slot = &words_[(index & kMask) * kWordNum];
+        uint64_t words[kWordNum];
+
+        for (size_t i = 0; i < kWordNum; i++) {
+            words[i] = slot[i].load(memory_order_relaxed);
+        }
+
+        TelemetrySample sample;
+        memcpy(&sample, words, sizeof(TelemetrySample));
+        return sample;
+    }
+
+    unique_ptr<atomic<uint64_t>[]> words_;
+    atomic<uint64_t> head_    {0}; /**< Samples published */
+    atomic<uint64_t> writing_ {0}; /**< Samples started, head_ + 1 while push() copies */
+};
+
+#endif // TELEMETRY_RING_HPP
@@ -0,0 +1,49 @@
+/**
+ * @file datc_bus.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "datc_bus.hpp"
+
+DatcBus::DatcBus(uint16_t bus_id, const string &port_name) : bus_id_(bus_id), port_name_(port_name) {
+}
+
+DatcBus::~DatcBus() {
+    close();
+}
+
+bool DatcBus::open(uint16_t slave_address, int baudrate, const vector<uint16_t> &poll_slaves) {
+    if (!modbusInit(port_name_.c_str(), slave_address, baudrate)) {
+        return false;
+    }
+
+    setPollSlaves(poll_slaves);
+    printf("Bus %d opened on %s\n", bus_id_, port_name_.c_str());
+
+    return true;
+}
+
+void DatcBus::start(function<void()> on_cycle) {
+    flag_stop_ = false;
+    poll_thread_ = std::thread([this, on_cycle] () {pollLoop(flag_stop_, on_cycle);});
+    running_ = true;
+}
+
+void DatcBus::close() {
+    running_   = false;
+    flag_stop_ = true;
+
+    if (poll_thread_.joinable()) {
+        poll_thread_.join();
+    }
+
+    if (getConnectionState()) {
+        motorDisable();
+        modbusRelease();
+    }
+}
@@ -10,17 +10,26 @@
  */
 #include "datc_comm_interface.hpp"
 
-const uint16_t kFreq = 50;
+// Upper bound on how long the command worker sleeps before re-checking flag_tcp_stop_
+const std::chrono::milliseconds kCmdWaitTimeout(100);
 
 DatcCommInterface::DatcCommInterface(int argc, char **argv) {
+    qRegisterMetaType<MonitorStatus>("MonitorStatus");
 
+    setHealthCallback([this] (uint16_t slave_addr, SlaveHealth previous, SlaveHealth health) {
+        publishHealth(0, slave_addr, previous, health);
+    });
 }
 
 DatcCommInterface::~DatcCommInterface() {
     flag_program_stop_ = true;
+
+    // Posted actions still refer to this object and emit its signals
+    stopAsync();
     usleep(1000);
 
     releaseTcp();
+    closeAllBuses();
     modbusRelease();
 }
 
@@ -34,15 +43,87 @@ bool DatcCommInterface::init(const char *port_name, uint16_t slave_address, int
     return true;
 }
 
-void DatcCommInterface::initTcp(const string addr, uint16_t socket_port) {
+void DatcCommInterface::postAction(const QString &name, function<bool()> action) {
+    post(move(action), [this, name] (bool success) {
+        // Port init and release change the status without a poll cycle to publish it
+        publishMonitorStatus();
+        Q_EMIT actionFinished(name, success);
+    });
+}
+
+MonitorStatus DatcCommInterface::getMonitorStatus() {
+    const DatcStatus datc_status = getDatcStatus();
+
+    MonitorStatus status;
+    status.modbus_connected = getConnectionState();
+    status.socket_connected = is_socket_connected_;
+    status.recv_err   = getModbusRecvErr();
+    status.slave_addr = getSlaveAddr();
+    status.health     = getSlaveHealth(status.slave_addr);
+    status.state      = datc_status.state;
+    status.finger_pos = datc_status.finger_pos;
+    status.motor_cur  = datc_status.motor_cur;
+
+    return status;
+}
+
+void DatcCommInterface::publishMonitorStatus() {
+    const MonitorStatus status = getMonitorStatus();
+    const auto now = std::chrono::steady_clock::now();
+
+    // Emitted under the lock, so statuses published from different threads arrive in order
+    lock_guard<mutex> lg(mutex_monitor_);
+
+    if (!monitor_publisher_.update(status, now)) {
+        return;
+    }
+
+    Q_EMIT statusChanged(status);
+}
+
+void DatcCommInterface::recordTelemetry() {
+    const DatcStatusSnapshot snapshot = getStatusSnapshot();
+
+    if (snapshot.seq == telemetry_seq_) {
+        return;
+    }
+
+    telemetry_seq_ = snapshot.seq;
+
+    TelemetrySample sample;
+    sample.timestamp_us = snapshot.timestamp_us;
+    sample.values[(size_t) TelemetryChannel::MOTOR_POS]  = snapshot.status.motor_pos;
+    sample.values[(size_t) TelemetryChannel::MOTOR_VEL]  = snapshot.status.motor_vel;
+    sample.values[(size_t) TelemetryChannel::MOTOR_CUR]  = snapshot.status.motor_cur;
+    sample.values[(size_t) TelemetryChannel::FINGER_POS] = snapshot.status.finger_pos;
+    sample.values[(size_t) TelemetryChannel::VOLTAGE]    = snapshot.status.voltage;
+
+    telemetry_.push(sample);
+}
+
+bool DatcCommInterface::initTcp(const string addr, uint16_t socket_port, size_t io_thread_num) {
     unique_lock<mutex> lg(mutex_tcp_);
 
-    flag_tcp_stop_ = false;
+    if (tcp_server_ != nullptr) {
+        COUT("[ERROR] TCP server is already running.");
+        return false;
+    }
 
-    tcp_server_ = new TcpServer(socket_port);
+    try {
+        tcp_server_ = new TcpServer(socket_port, io_thread_num);
+    } catch (const boost::system::system_error &e) {
+        COUT("[ERROR] Failed to open TCP port " + to_string(socket_port) + ": " + e.what());
+        return false;
+    }
+
+    flag_tcp_stop_ = false;
     tcp_thread_ = std::thread(bind(&DatcCommInterface::recvCommand, this));
 
     is_socket_connected_ = true;
+
+    publishMonitorStatus();
+
+    return true;
 }
 
 void DatcCommInterface::releaseTcp() {
@@ -58,29 +139,249 @@ void DatcCommInterface::releaseTcp() {
     }
 
     if (tcp_server_ != NULL) {
-        tcp_server_->~TcpServer();
+        delete tcp_server_;
+        tcp_server_ = nullptr;
     }
+
+    publishMonitorStatus();
 }
 
-void DatcCommInterface::sendStatus() {
-    DatcStatus status = getDatcStatus();
+bool DatcCommInterface::openBus(const string &port_name, uint16_t slave_address, int baudrate, const vector<uint16_t> &poll_slaves) {
+    unique_lock<mutex> lg(mutex_bus_);
 
-    Json::Value json;
+    // Also matches a bus that another call is still opening
+    for (auto &bus : buses_) {
+        if (bus.second->getBusPort() == port_name) {
+            COUT("[ERROR] " + port_name + " is already open.");
+            return false;
+        }
+    }
 
-    json["states"]     = status.states;
-    json["motor_pos"]  = status.motor_pos;
-    json["motor_vel"]  = status.motor_vel;
-    json["motor_cur"]  = status.motor_cur;
-    json["finger_pos"] = status.finger_pos;
-    json["voltage"]    = status.voltage;
+    // Smallest free id, bus 0 being this interface
+    uint16_t bus_id = 1;
+    while (buses_.find(bus_id) != buses_.end()) {
+        bus_id++;
+    }
 
-    unique_lock<mutex> lg(mutex_tcp_);
+    // The id and the port stay reserved while the port is opened. getBuses() and findBus()
+    // leave the bus out until it runs.
+    auto bus = make_shared<DatcBus>(bus_id, port_name);
+    buses_.insert(make_pair(bus_id, bus));
+
+    // Opening the port takes a while, getBuses() must not wait for it
+    lg.unlock();
+    const bool opened = bus->open(slave_address, baudrate, poll_slaves);
+    lg.lock();
+
+    // closeAllBuses() may have taken the reservation meanwhile
+    auto itr = buses_.find(bus_id);
+    const bool reserved = (itr != buses_.end() && itr->second == bus);
+
+    if (!opened || !reserved) {
+        if (reserved) {
+            buses_.erase(itr);
+        } else {
+            COUT("[ERROR] Bus " + to_string(bus_id) + " was closed while " + port_name + " was being opened.");
+        }
+
+        lg.unlock();
+        bus->close();
+        return false;
+    }
+
+    // Same poll rate, scheduling class and transfer mode as bus 0, but never pinned to its CPU
+    bus->setPollFreq(getPollFreq());
+    bus->setPollScheduling(getPollRealtime());
+    bus->setCombinedTransfer(getCombinedTransfer());
+
+    // Every bus publishes from its own thread with its own encoder
+    auto encoder = make_shared<StatusEncoder>();
+    DatcBus *bus_ptr = bus.get();
+
+    bus->setHealthCallback([this, bus_id] (uint16_t slave_addr, SlaveHealth previous, SlaveHealth health) {
+        publishHealth(bus_id, slave_addr, previous, health);
+    });
+
+    bus->start([this, bus_ptr, bus_id, encoder] () {
+        if (is_socket_connected_ && flag_tcp_send_status_) {
+            sendStatus(*bus_ptr, bus_id, *encoder);
+        }
+    });
+
+    is_multi_bus_ = true;
+
+    return true;
+}
+
+void DatcCommInterface::closeAllBuses() {
+    map<uint16_t, shared_ptr<DatcBus>> buses;
+
+    {
+        unique_lock<mutex> lg(mutex_bus_);
+        buses.swap(buses_);
+        is_multi_bus_ = false;
+    }
+
+    // Joins the bus threads outside the lock
+    for (auto &bus : buses) {
+        bus.second->close();
+    }
+}
+
+vector<shared_ptr<DatcBus>> DatcCommInterface::getBuses() {
+    unique_lock<mutex> lg(mutex_bus_);
+
+    vector<shared_ptr<DatcBus>> buses;
+    for (auto &bus : buses_) {
+        if (bus.second->isRunning()) {
+            buses.push_back(bus.second);
+        }
+    }
+    return buses;
+}
+
+shared_ptr<DatcBus> DatcCommInterface::findBus(uint16_t bus_id) {
+    unique_lock<mutex> lg(mutex_bus_);
+
+    auto itr = buses_.find(bus_id);
+    return (itr == buses_.end() || !itr->second->isRunning()) ? nullptr : itr->second;
+}
+
+void DatcCommInterface::sendStatus(DatcCtrl &bus, uint16_t bus_id, StatusEncoder &encoder) {
+    const auto now = std::chrono::steady_clock::now();
+    // A single device keeps the legacy six-key message, several devices are told apart by "bus" and "slave"
+    const bool with_address = is_multi_bus_ || (bus.getPollSlaveNum() > 1);
+
+    for (auto slave_addr : bus.getPollRound()) {
+        const DatcStatusSnapshot snapshot = bus.getStatusSnapshot(slave_addr);
+        const uint32_t device_key = StatusSubscription::deviceKey(bus_id, slave_addr);
+
+        // Clients that subscribed only get the statuses their publish policy lets through
+        auto acceptFn = [&] (Subscription *subscription) {
+            return !subscription || static_cast<StatusSubscription *>(subscription)->shouldPublish(device_key, snapshot.status, now);
+        };
+
+        // Serialised once per format for the clients without subscription, who share the buffer.
+        // A subscription serialises its own field subset and keeps it while the status is unchanged.
+        MessageManager<Json::Value>::getInstance().publishToClientQueue(acceptFn, [&] (WireFormat format, Subscription *subscription) {
+            if (subscription) {
+                return static_cast<StatusSubscription *>(subscription)->encode(device_key, format, snapshot, with_address);
+            }
+
+            return (format == WireFormat::BINARY) ? encoder.encodeBinary(snapshot.status, bus_id, slave_addr, snapshot.seq, snapshot.timestamp_us)
+                                                  : encoder.encodeJson(snapshot.status, with_address, bus_id, slave_addr);
+        });
+    }
+}
 
-    MessageManager<Json::Value>::getInstance().pushToAllClientQueue(json);
+void DatcCommInterface::sendCommandAsync(DatcCtrl &bus, uint16_t bus_id, uint16_t target, const Json::Value &id, uint32_t client_id,
+                                         bool wait_done, DATC_COMMAND cmd, int value_1, uint16_t value_2) {
+    auto replyFn = [client_id] (const Json::Value &json) {
+        Json::FastWriter writer;
+        MessageManager<Json::Value>::getInstance().pushToClientQueue(client_id, make_shared<const string>(writer.write(json)));
+    };
+
+    // The worker of the bus sends it, so the next message of the client is handled meanwhile
+    bus.commandAsync(cmd, (uint16_t) value_1, value_2, target, wait_done,
+        [replyFn, id, bus_id] (bool success) {
+            Json::Value json;
+            json["ack"]["id"]      = id;
+            json["ack"]["bus"]     = bus_id;
+            json["ack"]["success"] = success;
+            replyFn(json);
+        },
+        [replyFn, id, bus_id] (MotionResult result) {
+            Json::Value json;
+            json["done"]["id"]     = id;
+            json["done"]["bus"]    = bus_id;
+            json["done"]["result"] = string(motionResultName(result));
+            replyFn(json);
+        });
+}
+
+void DatcCommInterface::publishHealth(uint16_t bus_id, uint16_t slave_addr, SlaveHealth previous, SlaveHealth health) {
+    if (!is_socket_connected_) {
+        return;
+    }
+
+    MessageManager<Json::Value>::getInstance().notifyAllClientQueue([&] (WireFormat format) {
+        using namespace binary_protocol;
+
+        if (format == WireFormat::BINARY) {
+            auto frame = make_shared<string>(kHeaderSize + kHealthSize, '\0');
+            char *p = &(*frame)[0];
+
+            putHeader(p, FrameType::HEALTH, kHealthSize);
+            p += kHeaderSize;
+
+            putU16(p    , bus_id);
+            putU16(p + 2, slave_addr);
+            p[4] = (char) health;
+            p[5] = (char) previous;
+
+            return OutboundMessage(frame);
+        }
+
+        Json::Value json;
+        json["health"]["bus"]      = bus_id;
+        json["health"]["slave"]    = slave_addr;
+        json["health"]["state"]    = string(slaveHealthName(health));
+        json["health"]["previous"] = string(slaveHealthName(previous));
+
+        Json::FastWriter writer;
+        return OutboundMessage(make_shared<const string>(writer.write(json)));
+    });
 }
 
 void DatcCommInterface::recvCommand() {
-    auto checkValueFn = [] (const Json::Value json, string str) {
+    const string bus_str       = "bus";
+    const string slave_str     = "slave";
+    const string subscribe_str   = "subscribe";
+    const string queue_stats_str = "queue_stats";
+    const string client_id_str   = "client_id";
+
+    Json::Value json;
+
+    while (!flag_tcp_stop_) {
+        // Wakes as soon as TcpSocket::readHandler pushes a command
+        if (!MessageManager<Json::Value>::getInstance().waitPopFromWorkerQueue(json, kCmdWaitTimeout)) {
+            continue;
+        }
+
+        // A subscription belongs to the connection, not to a bus
+        if (json.isMember(subscribe_str)) {
+            if (json.isMember(client_id_str)) {
+                subscribe(json[client_id_str].asUInt(), json[subscribe_str]);
+            }
+            continue;
+        } else if (json.isMember(queue_stats_str)) {
+            if (json.isMember(client_id_str)) {
+                sendQueueStats(json[client_id_str].asUInt());
+            }
+            continue;
+        }
+
+        // Commands are routed by the optional "bus" and "slave" keys
+        const uint16_t bus_id = json.isMember(bus_str)   ? json[bus_str].asUInt()   : 0;
+        const uint16_t target = json.isMember(slave_str) ? json[slave_str].asUInt() : kSelectedSlave;
+
+        if (bus_id == 0) {
+            dispatchCommand(*this, bus_id, target, json);
+            continue;
+        }
+
+        auto bus = findBus(bus_id);
+
+        if (bus) {
+            dispatchCommand(*bus, bus_id, target, json);
+        } else {
+            COUT("[Error] Bus " + to_string(bus_id) + " is not open.");
+        }
+    }
+}
+
+void DatcCommInterface::dispatchCommand(DatcCtrl &bus, uint16_t bus_id, uint16_t target, const Json::Value &json) {
+    auto checkValueFn = [] (const Json::Value &json, const string &str) {
         if (json.isMember(str)) {
             return true;
         } else {
@@ -90,134 +391,232 @@ void DatcCommInterface::recvCommand() {
     };
 
     const string cmd_change_slave = "change_slave";
+    const string cmd_poll_freq    = "poll_freq";
+    const string cmd_poll_stats   = "poll_stats";
+    const string cmd_combined     = "combined_transfer";
+    const string cmd_calibrate    = "calibrate_timing";
+    const string cmd_record       = "record";
+    const string client_id_str    = "client_id";
     const string cmd_str          = "command";
     const string value_1_str      = "value_1";
     const string value_2_str      = "value_2";
+    const string id_str           = "id";
+    const string wait_done_str    = "wait_done";
+
+    if (json.isMember(cmd_change_slave)) {
+        bus.modbusSlaveChange(json[cmd_change_slave].asUInt());
+        return;
+    } else if (json.isMember(cmd_poll_freq)) {
+        bus.setPollFreq(json[cmd_poll_freq].asUInt());
+        return;
+    } else if (json.isMember(cmd_combined)) {
+        bus.setCombinedTransfer(json[cmd_combined].asBool());
+        return;
+    } else if (json.isMember(cmd_record)) {
+        if (json[cmd_record].asBool()) {
+            bus.startRecording(bus_id);
+        } else {
+            bus.stopRecording();
+        }
+        return;
+    } else if (json.isMember(cmd_calibrate)) {
+        const bool reply = json.isMember(client_id_str);
+        const uint32_t client_id = json.get(client_id_str, 0).asUInt();
 
-    Json::Value json;
+        // Takes seconds, so it runs on the worker of the bus like the GUI's, and the TCP worker goes on
+        bus.post([this, &bus, bus_id, reply, client_id] {
+            const TimingCalibration calibration = bus.calibrateTiming();
 
-    while (!flag_tcp_stop_) {
-        mutex_tcp_.lock();
+            if (reply) {
+                sendTimingCalibration(calibration, bus_id, client_id);
+            }
+            return calibration.success;
+        });
+        return;
+    } else if (json.isMember(cmd_poll_stats)) {
+        if (json.isMember(client_id_str)) {
+            sendPollStats(bus, bus_id, json[client_id_str].asUInt());
+        }
+        return;
+    } else if (!json.isMember(cmd_str)) {
+        return;
+    } else if (json.isMember(id_str) && json.isMember(client_id_str)) {
+        sendCommandAsync(bus, bus_id, target, json[id_str], json[client_id_str].asUInt(), json.get(wait_done_str, false).asBool(),
+                         (DATC_COMMAND) json[cmd_str].asUInt(), json.get(value_1_str, 0).asInt(), json.get(value_2_str, 0).asUInt());
+        return;
+    }
 
-        if (MessageManager<Json::Value>::getInstance().tryPopFromWokerQueue(json)) {
-            mutex_tcp_.unlock();
+    switch ((DATC_COMMAND) json[cmd_str].asUInt()) {
+        case DATC_COMMAND::MOTOR_ENABLE:
+            bus.motorEnable(target);
+            break;
+
+        case DATC_COMMAND::MOTOR_STOP:
+            bus.motorStop(target);
+            break;
+
+        case DATC_COMMAND::MOTOR_DISABLE:
+            bus.motorDisable(target);
+            break;
+
+        case DATC_COMMAND::MOTOR_POSITION_CONTROL:
+            if (!checkValueFn(json, value_1_str)) break;
+            if (!checkValueFn(json, value_2_str)) break;
+            bus.motorPosCtrl(json[value_1_str].asInt(), json[value_2_str].asUInt(), target);
+            break;
+
+        case DATC_COMMAND::MOTOR_VELOCITY_CONTROL:
+            if (!checkValueFn(json, value_1_str)) break;
+            bus.motorVelCtrl(json[value_1_str].asInt(), target);
+            break;
+
+        case DATC_COMMAND::MOTOR_CURRENT_CONTROL:
+            if (!checkValueFn(json, value_1_str)) break;
+            bus.motorCurCtrl(json[value_1_str].asInt(), target);
+            break;
+
+        case DATC_COMMAND::CHANGE_MODBUS_ADDRESS:
+            if (!checkValueFn(json, value_1_str)) break;
+            bus.setModbusAddr(json[value_1_str].asUInt(), target);
+            break;
+
+        case DATC_COMMAND::GRIPPER_INITIALIZE:
+            bus.grpInitialize(target);
+            break;
+
+        case DATC_COMMAND::GRIPPER_OPEN:
+            bus.grpOpen(target);
+            break;
+
+        case DATC_COMMAND::GRIPPER_CLOSE:
+            bus.grpClose(target);
+            break;
+
+        case DATC_COMMAND::SET_FINGER_POSITION:
+            if (!checkValueFn(json, value_1_str)) break;
+            bus.setFingerPos(json[value_1_str].asUInt(), target);
+            break;
+
+        case DATC_COMMAND::VACUUM_GRIPPER_ON:
+            bus.vacuumGrpOn(target);
+            break;
+
+        case DATC_COMMAND::VACUUM_GRIPPER_OFF:
+            bus.vacuumGrpOff(target);
+            break;
+
+        case DATC_COMMAND::SET_MOTOR_TORQUE:
+            if (!checkValueFn(json, value_1_str)) break;
+            bus.setMotorTorque(json[value_1_str].asUInt(), target);
+            break;
+
+        case DATC_COMMAND::SET_MOTOR_SPEED:
+            if (!checkValueFn(json, value_1_str)) break;
+            bus.setMotorSpeed(json[value_1_str].asUInt(), target);
+            break;
+
+        default:
+            COUT("Error: Undefined command.");
+    }
+}
 
-            if (json.isMember(cmd_change_slave)) {
-                modbusSlaveChange(json[cmd_change_slave].asUInt());
-                continue;
-            } else if (!json.isMember(cmd_str)) {
-                continue;
-            }
+void DatcCommInterface::subscribe(uint32_t client_id, const Json::Value &json) {
+    auto &message_manager = MessageManager<Json::Value>::getInstance();
 
-            switch ((DATC_COMMAND) json[cmd_str].asUInt()) {
-                case DATC_COMMAND::MOTOR_ENABLE:
-                    motorEnable();
-                    break;
-
-                case DATC_COMMAND::MOTOR_STOP:
-                    motorStop();
-                    break;
-
-                case DATC_COMMAND::MOTOR_DISABLE:
-                    motorDisable();
-                    break;
-
-                case DATC_COMMAND::MOTOR_POSITION_CONTROL:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    if (!checkValueFn(json, value_2_str)) break;
-                    motorPosCtrl(json[value_1_str].asInt(), json[value_2_str].asUInt());
-                    break;
-
-                case DATC_COMMAND::MOTOR_VELOCITY_CONTROL:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    motorVelCtrl(json[value_1_str].asInt());
-                    break;
-
-                case DATC_COMMAND::MOTOR_CURRENT_CONTROL:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    motorCurCtrl(json[value_1_str].asInt());
-                    break;
-
-                case DATC_COMMAND::CHANGE_MODBUS_ADDRESS:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    setModbusAddr(json[value_1_str].asUInt());
-                    break;
-
-                case DATC_COMMAND::GRIPPER_INITIALIZE:
-                    grpInitialize();
-                    break;
-
-                case DATC_COMMAND::GRIPPER_OPEN:
-                    grpOpen();
-                    break;
-
-                case DATC_COMMAND::GRIPPER_CLOSE:
-                    grpClose();
-                    break;
-
-                case DATC_COMMAND::SET_FINGER_POSITION:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    setFingerPos(json[value_1_str].asUInt());
-                    break;
-
-                case DATC_COMMAND::VACUUM_GRIPPER_ON:
-                    vacuumGrpOn();
-                    break;
-
-                case DATC_COMMAND::VACUUM_GRIPPER_OFF:
-                    vacuumGrpOff();
-                    break;
-
-                case DATC_COMMAND::SET_MOTOR_TORQUE:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    setMotorTorque(json[value_1_str].asUInt());
-                    break;
-
-                case DATC_COMMAND::SET_MOTOR_SPEED:
-                    if (!checkValueFn(json, value_1_str)) break;
-                    setMotorSpeed(json[value_1_str].asUInt());
-                    break;
-
-                default:
-                    COUT("Error: Undefined command.");
-            }
-        } else {
-            mutex_tcp_.unlock();
-        }
+    // An empty object goes back to every status at the poll rate
+    SubscriptionPtr subscription = nullptr;
 
-        usleep(10000);
+    if (json.isObject() && !json.empty()) {
+        subscription = make_shared<StatusSubscription>(StatusSubscription::parsePolicy(json));
     }
+
+    message_manager.setClientSubscription(client_id, subscription);
+
+    // "latest" keeps only the newest status for a client that falls behind
+    const bool latest_only = json.isObject() && json.get("queue", "fifo").asString() == "latest";
+    message_manager.setClientQueuePolicy(client_id, latest_only ? QueuePolicy::LATEST_ONLY : QueuePolicy::BOUNDED_FIFO);
 }
 
-// Main loop
-void DatcCommInterface::run() {
-    auto cycleFn([&] () {
-        if (mbc_.getConnectionState()) {
-            readDatcData();
+void DatcCommInterface::sendQueueStats(uint32_t client_id) {
+    const ClientQueueStats stats = MessageManager<Json::Value>::getInstance().getClientQueueStats(client_id);
 
-            if (is_socket_connected_ && flag_tcp_send_status_) {
-                sendStatus();
-            }
-        }
-    });
+    Json::Value json;
+    json["queue_stats"]["dropped"]   = (Json::UInt64) stats.dropped;
+    json["queue_stats"]["conflated"] = (Json::UInt64) stats.conflated;
+    json["queue_stats"]["queued"]    = (Json::UInt64) stats.queued;
 
-    const std::chrono::duration<double> period(1 / (double) kFreq);
+    // Of every client, each was answered with a "busy" error
+    json["queue_stats"]["worker_dropped"] = (Json::UInt64) MessageManager<Json::Value>::getInstance().getWorkerQueueDropped();
 
-    while(!flag_program_stop_) {
-        auto time_start = std::chrono::steady_clock::now();
+    Json::FastWriter writer;
+    MessageManager<Json::Value>::getInstance().pushToClientQueue(client_id, make_shared<const string>(writer.write(json)));
+}
 
-        cycleFn();
+void DatcCommInterface::sendPollStats(DatcCtrl &bus, uint16_t bus_id, uint32_t client_id) {
+    const PollStatsSnapshot stats = bus.getPollStats();
 
-        // Calculate the time elapsed and sleep for the remaining time
-        auto time_end = std::chrono::steady_clock::now();
-        auto time_elapsed = time_end - time_start;
+    auto summaryFn = [] (const TimingSummary &summary) {
+        Json::Value json;
+        json["min"] = summary.min;
+        json["avg"] = summary.avg;
+        json["p99"] = summary.p99;
+        json["max"] = summary.max;
+        return json;
+    };
 
-        if (time_elapsed < period) {
-            std::this_thread::sleep_for(period - time_elapsed);
-        }
+    Json::Value json;
+    json["poll_stats"]["bus"]       = bus_id;
+    json["poll_stats"]["poll_freq"] = bus.getPollFreq();
+    json["poll_stats"]["period_ms"] = stats.period_ms;
+    json["poll_stats"]["cycles"]    = (Json::UInt64) stats.cycles;
+    json["poll_stats"]["overruns"]  = (Json::UInt64) stats.overruns;
+    json["poll_stats"]["cycle_ms"]  = summaryFn(stats.cycle_ms);
+    json["poll_stats"]["rtt_ms"]    = summaryFn(stats.rtt_ms);
+
+    const CoalescerStats command_stats = bus.getCommandStats();
+    json["poll_stats"]["commands"]["submitted"] = (Json::UInt64) command_stats.submitted;
+    json["poll_stats"]["commands"]["written"]   = (Json::UInt64) command_stats.written;
+    json["poll_stats"]["commands"]["coalesced"] = (Json::UInt64) command_stats.coalesced;
+    json["poll_stats"]["commands"]["combined"]  = (Json::UInt64) command_stats.combined;
+
+    if (bus.isRecording()) {
+        const RecorderStats recorder_stats = bus.getRecorderStats();
+        json["poll_stats"]["record"]["file"]     = recorder_stats.file_name;
+        json["poll_stats"]["record"]["records"]  = (Json::UInt64) recorder_stats.records;
+        json["poll_stats"]["record"]["dropped"]  = (Json::UInt64) recorder_stats.dropped;
+        json["poll_stats"]["record"]["segments"] = recorder_stats.segments;
     }
 
+    Json::FastWriter writer;
+    auto message = make_shared<const string>(writer.write(json));
+
+    MessageManager<Json::Value>::getInstance().pushToClientQueue(client_id, message);
+}
+
+void DatcCommInterface::sendTimingCalibration(const TimingCalibration &calibration, uint16_t bus_id, uint32_t client_id) {
+    Json::Value json;
+    json["calibrate_timing"] = Rs485TimingStore::toJson(calibration);
+    json["calibrate_timing"]["bus"]      = bus_id;
+    json["calibrate_timing"]["baudrate"] = calibration.baudrate;
+    json["calibrate_timing"]["success"]  = calibration.success;
+
+    Json::FastWriter writer;
+    auto message = make_shared<const string>(writer.write(json));
+
+    MessageManager<Json::Value>::getInstance().pushToClientQueue(client_id, message);
+}
+
+// Main loop
+void DatcCommInterface::run() {
+    pollLoop(flag_program_stop_, [&] () {
+        if (is_socket_connected_ && flag_tcp_send_status_) {
+            sendStatus(*this, 0, status_encoder_);
+        }
+
+        recordTelemetry();
+        publishMonitorStatus();
+    });
+
     motorDisable();
     modbusRelease();
 }
-
@@ -9,15 +9,48 @@
  *
  */
 #include "datc_ctrl.hpp"
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Set by submitCommand() when a later setpoint replaced the command of this thread, read by
+ * the async worker after execute(), which reaches submitCommand() through the command methods.
+ */
+thread_local bool last_command_superseded = false;
+
+} // namespace
 
 DatcCtrl::DatcCtrl() {
 }
 
 DatcCtrl::~DatcCtrl() {
+    stopAsync();
+    stopRecording();
+
+    for (auto &watch : motion_watches_) {
+        watch->resolve(MotionResult::FAILED);
+    }
 }
 
 bool DatcCtrl::modbusInit(const char *port_name, uint16_t slave_address, int baudrate) {
-    return mbc_.modbusInit(port_name, slave_address, baudrate);
+    if (!mbc_.modbusInit(port_name, slave_address, baudrate)) {
+        return false;
+    }
+
+    Rs485Timing timing;
+
+    if (Rs485TimingStore::load(port_name, baudrate, timing) && mbc_.setTiming(timing)) {
+        printf("[RS485 Timing] Calibrated timing applied to %s: RTS delay %u us, response timeout %u us, byte timeout %u us\n",
+               port_name, timing.rts_delay_us, timing.response_timeout_us, timing.byte_timeout_us);
+    }
+
+    return true;
 }
 
 bool DatcCtrl::modbusRelease() {
@@ -29,167 +62,345 @@ bool DatcCtrl::modbusSlaveChange(uint16_t slave_addr) {
     return mbc_.slaveChange(slave_addr);
 }
 
-bool DatcCtrl::motorEnable() {
-    return command(DATC_COMMAND::MOTOR_ENABLE);
+bool DatcCtrl::motorEnable(uint16_t target) {
+    return command(DATC_COMMAND::MOTOR_ENABLE, 0, 0, target);
 }
 
-bool DatcCtrl::motorStop() {
-    return command(DATC_COMMAND::MOTOR_STOP);
+bool DatcCtrl::motorStop(uint16_t target) {
+    return command(DATC_COMMAND::MOTOR_STOP, 0, 0, target);
 }
 
-bool DatcCtrl::motorDisable() {
-    return command(DATC_COMMAND::MOTOR_DISABLE);
+bool DatcCtrl::motorDisable(uint16_t target) {
+    return command(DATC_COMMAND::MOTOR_DISABLE, 0, 0, target);
 }
 
-bool DatcCtrl::setModbusAddr(uint16_t slave_addr) {
+bool DatcCtrl::setModbusAddr(uint16_t slave_addr, uint16_t target) {
     // TODO: modbus addr 범위 지정 필요
     if (slave_addr < 1 || slave_addr >= 100) {
         COUT("\"setModbusAddr\" function error. Check the input slave address.");
         return false;
     }
 
-    return command(DATC_COMMAND::CHANGE_MODBUS_ADDRESS, slave_addr);
+    return command(DATC_COMMAND::CHANGE_MODBUS_ADDRESS, slave_addr, 0, target);
 }
 
-bool DatcCtrl::grpInitialize() {
-    return command(DATC_COMMAND::GRIPPER_INITIALIZE);
+bool DatcCtrl::grpInitialize(uint16_t target) {
+    return command(DATC_COMMAND::GRIPPER_INITIALIZE, 0, 0, target);
 }
 
-bool DatcCtrl::grpOpen() {
-    return command(DATC_COMMAND::GRIPPER_OPEN);
+bool DatcCtrl::grpOpen(uint16_t target) {
+    return command(DATC_COMMAND::GRIPPER_OPEN, 0, 0, target);
 }
 
-bool DatcCtrl::grpClose() {
-    return command(DATC_COMMAND::GRIPPER_CLOSE);
+bool DatcCtrl::grpClose(uint16_t target) {
+    return command(DATC_COMMAND::GRIPPER_CLOSE, 0, 0, target);
 }
 
-bool DatcCtrl::setFingerPos(uint16_t finger_pos) {
-    string error_prefix = "[Set Finger Position]";
+bool DatcCtrl::setFingerPos(uint16_t finger_pos, uint16_t target) {
+    const char *error_prefix = "[Set Finger Position]";
 
     if (finger_pos < kFingerPosMin) {
-        printf("%s Invalid range of finger position ( < %d)", error_prefix.c_str(), kFingerPosMin);
+        printf("%s Invalid range of finger position ( < %d)", error_prefix, kFingerPosMin);
         finger_pos = kFingerPosMin;
     } else if (finger_pos > kFingerPosMax) {
-        printf("%s Invalid range of finger position ( > %d)", error_prefix.c_str(), kFingerPosMax);
+        printf("%s Invalid range of finger position ( > %d)", error_prefix, kFingerPosMax);
         finger_pos = kFingerPosMax;
     }
 
-    return command(DATC_COMMAND::SET_FINGER_POSITION, finger_pos);
+    return command(DATC_COMMAND::SET_FINGER_POSITION, finger_pos, 0, target);
 }
 
-bool DatcCtrl::motorVelCtrl(int16_t vel) {
-    string error_prefix = "[Motor Velocity Control]";
+bool DatcCtrl::motorVelCtrl(int16_t vel, uint16_t target) {
+    const char *error_prefix = "[Motor Velocity Control]";
 
     if (abs(vel) < kVelMin) {
-        printf("%s Invalid range of speed ( < %d)", error_prefix.c_str(), kVelMin);
+        printf("%s Invalid range of speed ( < %d)", error_prefix, kVelMin);
         vel = (vel >= 0) ? kVelMin : -kVelMin;
     } else if (abs(vel) > kVelMax) {
-        printf("%s Invalid range of speed ( > %d)", error_prefix.c_str(), kVelMax);
+        printf("%s Invalid range of speed ( > %d)", error_prefix, kVelMax);
         vel = (vel >= 0) ? kVelMax : -kVelMax;
     }
 
-    return command(DATC_COMMAND::MOTOR_VELOCITY_CONTROL, vel, 500); // duration no longer works.
+    return command(DATC_COMMAND::MOTOR_VELOCITY_CONTROL, vel, 500, target); // duration no longer works.
 }
 
-bool DatcCtrl::motorCurCtrl(int16_t cur) {
-    string error_prefix = "[Motor Current Control]";
+bool DatcCtrl::motorCurCtrl(int16_t cur, uint16_t target) {
+    const char *error_prefix = "[Motor Current Control]";
 
     if (abs(cur) > kCurMax) {
-        printf("%s Invalid range of current ( > %d)", error_prefix.c_str(), kCurMax);
+        printf("%s Invalid range of current ( > %d)", error_prefix, kCurMax);
         cur = (cur >= 0) ? kCurMax : -kCurMax;
     }
 
-    return command(DATC_COMMAND::MOTOR_CURRENT_CONTROL, cur, 500); // duration no longer works.
+    return command(DATC_COMMAND::MOTOR_CURRENT_CONTROL, cur, 500, target); // duration no longer works.
 }
 
-bool DatcCtrl::motorPosCtrl(int16_t pos_deg, uint16_t duration) {
-    string error_prefix = "[Motor Position Control]";
+bool DatcCtrl::motorPosCtrl(int16_t pos_deg, uint16_t duration, uint16_t target) {
+    const char *error_prefix = "[Motor Position Control]";
     checkDurationRange(error_prefix, duration);
-    return command(DATC_COMMAND::MOTOR_POSITION_CONTROL, pos_deg, duration);
+    return command(DATC_COMMAND::MOTOR_POSITION_CONTROL, pos_deg, duration, target);
 }
 
-bool DatcCtrl::vacuumGrpOn() {
-    return command(DATC_COMMAND::VACUUM_GRIPPER_ON);
+bool DatcCtrl::vacuumGrpOn(uint16_t target) {
+    return command(DATC_COMMAND::VACUUM_GRIPPER_ON, 0, 0, target);
 }
 
-bool DatcCtrl::vacuumGrpOff() {
-    return command(DATC_COMMAND::VACUUM_GRIPPER_OFF);
+bool DatcCtrl::vacuumGrpOff(uint16_t target) {
+    return command(DATC_COMMAND::VACUUM_GRIPPER_OFF, 0, 0, target);
 }
 
-bool DatcCtrl::setMotorTorque(uint16_t torque_ratio) {
-    string error_prefix = "[Set Motor Torque]";
+bool DatcCtrl::setMotorTorque(uint16_t torque_ratio, uint16_t target) {
+    const char *error_prefix = "[Set Motor Torque]";
 
     if (torque_ratio < kTorqueRatioMin) {
-        printf("%s Motor torque is too low ( < %d)", error_prefix.c_str(), kTorqueRatioMin);
+        printf("%s Motor torque is too low ( < %d)", error_prefix, kTorqueRatioMin);
         torque_ratio = kTorqueRatioMin;
     } else if (torque_ratio > kTorqueRatioMax) {
-        printf("%s Motor torque is too high ( > %d)", error_prefix.c_str(), kTorqueRatioMax);
+        printf("%s Motor torque is too high ( > %d)", error_prefix, kTorqueRatioMax);
         torque_ratio = kTorqueRatioMax;
     }
 
-    return command(DATC_COMMAND::SET_MOTOR_TORQUE, torque_ratio);
+    return command(DATC_COMMAND::SET_MOTOR_TORQUE, torque_ratio, 0, target);
 }
 
-bool DatcCtrl::setMotorSpeed (uint16_t speed_ratio) {
-    string error_prefix = "[Set Motor Speed]";
+bool DatcCtrl::setMotorSpeed (uint16_t speed_ratio, uint16_t target) {
+    const char *error_prefix = "[Set Motor Speed]";
 
     if (speed_ratio < kSpeedRatioMin) {
-        printf("%s Motor torque is too low ( < %d)", error_prefix.c_str(), kSpeedRatioMin);
+        printf("%s Motor torque is too low ( < %d)", error_prefix, kSpeedRatioMin);
         speed_ratio = kSpeedRatioMin;
     } else if (speed_ratio > kSpeedRatioMax) {
-        printf("%s Motor torque is too high ( > %d)", error_prefix.c_str(), kSpeedRatioMax);
+        printf("%s Motor torque is too high ( > %d)", error_prefix, kSpeedRatioMax);
         speed_ratio = kSpeedRatioMax;
     }
 
-    return command(DATC_COMMAND::SET_MOTOR_SPEED, speed_ratio);
+    return command(DATC_COMMAND::SET_MOTOR_SPEED, speed_ratio, 0, target);
 }
 
-bool DatcCtrl::readDatcData() {
-    static map<uint16_t, pair<bool*, string>> status_info;
+bool DatcCtrl::execute(DATC_COMMAND cmd, uint16_t value_1, uint16_t value_2, uint16_t target) {
+    switch (cmd) {
+        case DATC_COMMAND::MOTOR_ENABLE:           return motorEnable(target);
+        case DATC_COMMAND::MOTOR_STOP:             return motorStop(target);
+        case DATC_COMMAND::MOTOR_DISABLE:          return motorDisable(target);
+        case DATC_COMMAND::MOTOR_POSITION_CONTROL: return motorPosCtrl((int16_t) value_1, value_2, target);
+        case DATC_COMMAND::MOTOR_VELOCITY_CONTROL: return motorVelCtrl((int16_t) value_1, target);
+        case DATC_COMMAND::MOTOR_CURRENT_CONTROL:  return motorCurCtrl((int16_t) value_1, target);
+        case DATC_COMMAND::CHANGE_MODBUS_ADDRESS:  return setModbusAddr(value_1, target);
+        case DATC_COMMAND::GRIPPER_INITIALIZE:     return grpInitialize(target);
+        case DATC_COMMAND::GRIPPER_OPEN:           return grpOpen(target);
+        case DATC_COMMAND::GRIPPER_CLOSE:          return grpClose(target);
+        case DATC_COMMAND::SET_FINGER_POSITION:    return setFingerPos(value_1, target);
+        case DATC_COMMAND::VACUUM_GRIPPER_ON:      return vacuumGrpOn(target);
+        case DATC_COMMAND::VACUUM_GRIPPER_OFF:     return vacuumGrpOff(target);
+        case DATC_COMMAND::SET_MOTOR_TORQUE:       return setMotorTorque(value_1, target);
+        case DATC_COMMAND::SET_MOTOR_SPEED:        return setMotorSpeed(value_1, target);
+        default:                                   return command(cmd, value_1, value_2, target);
+    }
+}
+
+CommandHandle DatcCtrl::commandAsync(DATC_COMMAND cmd, uint16_t value_1, uint16_t value_2, uint16_t target,
+                                     bool wait_motion, AckCallback on_ack, MotionCallback on_motion) {
+    AsyncRequest request;
+    request.cmd     = cmd;
+    request.value_1 = value_1;
+    request.value_2 = value_2;
+    request.target  = target;
+    request.on_ack  = move(on_ack);
+
+    CommandHandle handle;
+    handle.ack = request.ack.get_future().share();
+
+    if (wait_motion) {
+        const uint16_t slave_addr = resolveSlave(target);
+
+        if (cmd == DATC_COMMAND::GRIPPER_OPEN) {
+            request.motion = make_shared<MotionWatch>(slave_addr, MotionKind::GRIPPER_OPEN, 0, move(on_motion));
+        } else if (cmd == DATC_COMMAND::GRIPPER_CLOSE) {
+            request.motion = make_shared<MotionWatch>(slave_addr, MotionKind::GRIPPER_CLOSE, 0, move(on_motion));
+        } else if (cmd == DATC_COMMAND::SET_FINGER_POSITION) {
+            // Same clamping as setFingerPos()
+            const uint16_t finger_pos = min(max(value_1, kFingerPosMin), kFingerPosMax);
+            request.motion = make_shared<MotionWatch>(slave_addr, MotionKind::FINGER_POSITION, finger_pos, move(on_motion));
+        }
 
-    if (status_info.size() == 0) {
-        // Bit, Value, Status 순서
-        status_info.insert({0, make_pair(&status_.enable        , "Motor Enable")});
-        status_info.insert({1, make_pair(&status_.initialize    , "Gripper Initialize")});
-        status_info.insert({2, make_pair(&status_.motor_pos_ctrl, "Motor Position Control")});
-        status_info.insert({3, make_pair(&status_.motor_vel_ctrl, "Motor Velocity Control")});
-        status_info.insert({4, make_pair(&status_.motor_cur_ctrl, "Motor Current Control")});
-        status_info.insert({5, make_pair(&status_.grp_open      , "Gripper Open")});
-        status_info.insert({6, make_pair(&status_.grp_close     , "Gripper Close")});
-        status_info.insert({9, make_pair(&status_.fault         , "Motor Fault")});
+        if (request.motion) {
+            handle.motion = request.motion->getFuture();
+        }
     }
 
-    // Read input register //
-    uint16_t reg_addr = 10;
-    uint16_t reg_num  = 8;
-    vector<uint16_t> reg;
-
-    if (mbc_.recvData(reg_addr, reg_num, reg)) {
-        uint16_t status    = reg[0];
-        status_.states     = status;
-        status_.motor_pos  = (int16_t) reg[1];
-        status_.motor_cur  = (int16_t) reg[2];
-        status_.motor_vel  = (int16_t) reg[3];
-        status_.finger_pos = reg[4];
-        status_.voltage    = reg[7];
-
-        status_.status_str = "---";
-
-        for (int i = 0; i < 16; i++) {
-            if (status_info.find(i) != status_info.end()) {
-                if (status & (0x01 << i)) {
-                    *status_info[i].first = true;
-                    status_.status_str = status_info[i].second;
-                } else {
-                    *status_info[i].first = false;
-                }
+    enqueueAsync(move(request));
+
+    return handle;
+}
+
+shared_future<bool> DatcCtrl::post(function<bool()> job, AckCallback on_done) {
+    AsyncRequest request;
+    request.job    = move(job);
+    request.on_ack = move(on_done);
+
+    shared_future<bool> result = request.ack.get_future().share();
+
+    enqueueAsync(move(request));
+
+    return result;
+}
+
+void DatcCtrl::enqueueAsync(AsyncRequest &&request) {
+    unique_lock<mutex> lg(mutex_async_);
+
+    if (async_stop_) {
+        lg.unlock();
+
+        request.ack.set_value(false);
+
+        if (request.on_ack) {
+            request.on_ack(false);
+        }
+
+        if (request.motion) {
+            request.motion->resolve(MotionResult::FAILED);
+        }
+
+        return;
+    }
+
+    if (!async_thread_.joinable()) {
+        async_thread_ = std::thread(&DatcCtrl::asyncWorker, this);
+    }
+
+    async_queue_.push_back(move(request));
+    cond_async_.notify_one();
+}
+
+void DatcCtrl::stopAsync() {
+    {
+        unique_lock<mutex> lg(mutex_async_);
+        async_stop_ = true;
+        cond_async_.notify_all();
+    }
+
+    // The worker fails what is still queued
+    if (async_thread_.joinable()) {
+        async_thread_.join();
+    }
+}
+
+void DatcCtrl::asyncWorker() {
+    unique_lock<mutex> lg(mutex_async_);
+
+    while (true) {
+        cond_async_.wait(lg, [this] {return async_stop_ || !async_queue_.empty();});
+
+        if (async_queue_.empty()) {
+            return;
+        }
+
+        AsyncRequest request = move(async_queue_.front());
+        async_queue_.pop_front();
+
+        const bool stopping = async_stop_;
+        lg.unlock();
+
+        // Statuses read before the write must not complete the motion
+        const uint16_t slave_addr = resolveSlave(request.target);
+        const DatcStatusSnapshot before = getStatusSnapshot(slave_addr);
+
+        bool success = false;
+
+        last_command_superseded = false;
+
+        if (!stopping) {
+            success = request.job ? request.job() : execute(request.cmd, request.value_1, request.value_2, request.target);
+        }
+
+        request.ack.set_value(success);
+
+        if (request.on_ack) {
+            request.on_ack(success);
+        }
+
+        if (request.motion) {
+            if (success && last_command_superseded) {
+                // The slave was sent a newer setpoint instead, so this target will never be reached
+                request.motion->resolve(MotionResult::SUPERSEDED);
+            } else if (success) {
+                request.motion->start(before.seq, chrono::steady_clock::now(), before.status.finger_pos);
+
+                lock_guard<mutex> lg_motion(mutex_motion_);
+                motion_watches_.push_back(request.motion);
+            } else {
+                request.motion->resolve(MotionResult::FAILED);
+            }
+        }
+
+        lg.lock();
+    }
+}
+
+void DatcCtrl::updateMotionWatches() {
+    list<shared_ptr<MotionWatch>> finished;
+
+    {
+        lock_guard<mutex> lg(mutex_motion_);
+
+        if (motion_watches_.empty()) {
+            return;
+        }
+
+        const auto now = chrono::steady_clock::now();
+
+        for (auto itr = motion_watches_.begin(); itr != motion_watches_.end();) {
+            auto next = std::next(itr);
+            const DatcStatusSnapshot snapshot = getStatusSnapshot((*itr)->getSlaveAddr());
+
+            MotionSample sample;
+            sample.seq        = snapshot.seq;
+            sample.fault      = snapshot.status.fault;
+            sample.grp_open   = snapshot.status.grp_open;
+            sample.grp_close  = snapshot.status.grp_close;
+            sample.finger_pos = snapshot.status.finger_pos;
+
+            if ((*itr)->check(sample, now)) {
+                finished.splice(finished.end(), motion_watches_, itr);
             }
+            itr = next;
         }
+    }
+
+    // Like cancelMotionWatches(), a motion done callback may send the next motion
+    for (auto &watch : finished) {
+        watch->resolve(watch->getResult());
+    }
+}
+
+void DatcCtrl::cancelMotionWatches(uint16_t slave_addr) {
+    list<shared_ptr<MotionWatch>> cancelled;
 
-        if (!status_.enable) {
-            status_.status_str = "Motor Disabled";
+    {
+        lock_guard<mutex> lg(mutex_motion_);
+
+        for (auto itr = motion_watches_.begin(); itr != motion_watches_.end();) {
+            auto next = std::next(itr);
+
+            if ((*itr)->getSlaveAddr() == slave_addr) {
+                cancelled.splice(cancelled.end(), motion_watches_, itr);
+            }
+            itr = next;
         }
+    }
 
+    // Callbacks run without the lock, they may send the next command
+    for (auto &watch : cancelled) {
+        watch->resolve(MotionResult::SUPERSEDED);
+    }
+}
+
+bool DatcCtrl::readDatcData() {
+    const uint16_t slave_addr = mbc_.getSlaveAddr();
+    DatcStatus status = getDatcStatus();
+
+    if (readDatcData(slave_addr, status)) {
+        status_.store(updatePollState(slave_addr, status, true));
         flag_modbus_recv_err_ = false;
         return true;
     } else {
@@ -198,13 +409,610 @@ bool DatcCtrl::readDatcData() {
     }
 }
 
-bool DatcCtrl::checkDurationRange(string error_prefix, uint16_t &duration) {
+bool DatcCtrl::readDatcData(uint16_t slave_addr, DatcStatus &status) {
+    // Read input register //
+    StatusRegisters reg;
+
+    auto time_request = std::chrono::steady_clock::now();
+
+    if (!readStatusRegisters(slave_addr, reg)) {
+        return false;
+    }
+
+    std::chrono::duration<double, milli> rtt = std::chrono::steady_clock::now() - time_request;
+    poll_stats_.addRoundTrip(rtt.count());
+
+    uint16_t states   = reg[0];
+    status.states     = states;
+    status.motor_pos  = (int16_t) reg[1];
+    status.motor_cur  = (int16_t) reg[2];
+    status.motor_vel  = (int16_t) reg[3];
+    status.finger_pos = reg[4];
+    status.voltage    = reg[7];
+
+    decodeStates(states, status);
+
+    return true;
+}
+
+bool DatcCtrl::readStatusRegisters(uint16_t slave_addr, StatusRegisters &reg) {
+    if (!combined_transfer_ || !isCombinedSupported(slave_addr)) {
+        return mbc_.recvData(slave_addr, kStatusRegAddr, reg);
+    }
+
+    bool read_ok = false;
+
+    // A command waiting for this slave rides along with the status read
+    const bool carried = coalescer_.flushFront(slave_addr, [&] (const CommandCoalescer::Command &command) {
+        bool unsupported = false;
+
+        read_ok = mbc_.sendRecvData(slave_addr, CMD_ADDR, RegisterSpan(command.regs.data(), command.reg_num),
+                                    kStatusRegAddr, reg.size(), reg.data(), unsupported);
+
+        if (!unsupported) {
+            return read_ok;
+        }
+
+        printf("[Combined Transfer] Slave %d does not support function 0x17, falling back to write and read\n", slave_addr);
+
+        {
+            unique_lock<mutex> lg(mutex_slave_);
+            slave_states_[slave_addr].combined_unsupported = true;
+        }
+
+        const bool write_ok = writeCommand(command);
+        read_ok = mbc_.recvData(slave_addr, kStatusRegAddr, reg);
+        return write_ok;
+    });
+
+    return carried ? read_ok : mbc_.recvData(slave_addr, kStatusRegAddr, reg);
+}
+
+bool DatcCtrl::isCombinedSupported(uint16_t slave_addr) {
+    unique_lock<mutex> lg(mutex_slave_);
+
+    auto itr = slave_states_.find(slave_addr);
+    return (itr == slave_states_.end()) || !itr->second.combined_unsupported;
+}
+
+void DatcCtrl::decodeStates(uint16_t states, DatcStatus &status) {
+    const uint16_t active = states & kStatusBitMask;
+
+    for (size_t bit = 0; bit < kStatusBits.size(); bit++) {
+        if (kStatusBits[bit].flag != nullptr) {
+            status.*(kStatusBits[bit].flag) = (active >> bit) & 0x01;
+        }
+    }
+
+    // Highest meaningful bit set
+    int top_bit = -1;
+    for (uint16_t rest = active; rest != 0; rest >>= 1) {
+        top_bit++;
+    }
+
+    if (!status.enable) {
+        status.state = DatcState::MOTOR_DISABLED;
+    } else {
+        status.state = (top_bit < 0) ? DatcState::NONE : kStatusBits[top_bit].state;
+    }
+}
+
+DatcStatusSnapshot DatcCtrl::getStatusSnapshot(uint16_t slave_addr) {
+    unique_lock<mutex> lg(mutex_slave_);
+
+    auto itr = slave_states_.find(slave_addr);
+    return (itr == slave_states_.end()) ? DatcStatusSnapshot() : itr->second.snapshot;
+}
+
+void DatcCtrl::setPollSlaves(const vector<uint16_t> &slave_list) {
+    unique_lock<mutex> lg(mutex_slave_);
+
+    poll_slaves_.clear();
+
+    for (auto slave_addr : slave_list) {
+        if (slave_addr < 1 || slave_addr > 247) {
+            printf("[Poll Slaves] Invalid slave address %d is ignored\n", slave_addr);
+            continue;
+        }
+
+        if (find(poll_slaves_.begin(), poll_slaves_.end(), slave_addr) == poll_slaves_.end()) {
+            poll_slaves_.push_back(slave_addr);
+        }
+    }
+
+    // Drop the states of slaves that are no longer polled. The selected slave is polled in any case,
+    // its seq, health and transfer mode go on.
+    const uint16_t selected_slave = mbc_.getSlaveAddr();
+
+    for (auto itr = slave_states_.begin(); itr != slave_states_.end();) {
+        if (itr->first != selected_slave && find(poll_slaves_.begin(), poll_slaves_.end(), itr->first) == poll_slaves_.end()) {
+            itr = slave_states_.erase(itr);
+        } else {
+            itr++;
+        }
+    }
+}
+
+vector<uint16_t> DatcCtrl::getPollSlaves() {
+    unique_lock<mutex> lg(mutex_slave_);
+    return poll_slaves_;
+}
+
+double DatcCtrl::getPollRate(uint16_t slave_addr) {
+    unique_lock<mutex> lg(mutex_slave_);
+
+    auto itr = slave_states_.find(slave_addr);
+    return (itr == slave_states_.end()) ? 0 : itr->second.poll_rate;
+}
+
+SlaveHealth DatcCtrl::getSlaveHealth(uint16_t slave_addr) {
+    unique_lock<mutex> lg(mutex_slave_);
+
+    auto itr = slave_states_.find(slave_addr);
+    return (itr == slave_states_.end()) ? SlaveHealth::HEALTHY : itr->second.health.get();
+}
+
+bool DatcCtrl::pollBus() {
+    const uint16_t selected_slave = mbc_.getSlaveAddr();
+    const auto now = std::chrono::steady_clock::now();
+
+    {
+        unique_lock<mutex> lg(mutex_slave_);
+
+        // Reuses the capacity of poll_round_, so no allocation once the list is stable
+        poll_round_.assign(poll_slaves_.begin(), poll_slaves_.end());
+
+        if (find(poll_round_.begin(), poll_round_.end(), selected_slave) == poll_round_.end()) {
+            poll_round_.push_back(selected_slave);
+        }
+
+        poll_slave_num_ = poll_round_.size();
+
+        // Down slaves sit out until their next probe, so they cost no timeout on every cycle
+        poll_round_.erase(remove_if(poll_round_.begin(), poll_round_.end(), [&] (uint16_t slave_addr) {
+            auto itr = slave_states_.find(slave_addr);
+            return (itr != slave_states_.end()) && !itr->second.health.isPollDue(now);
+        }), poll_round_.end());
+    }
+
+    bool success_all = true;
+
+    // Slaves are read back to back; pending commands get the port between two reads
+    for (auto slave_addr : poll_round_) {
+        DatcStatus status = getDatcStatus(slave_addr);
+        bool success = readDatcData(slave_addr, status);
+
+        auto snapshot = updatePollState(slave_addr, status, success);
+
+        if (success) {
+            recordStatus(slave_addr, snapshot);
+        }
+
+        if (slave_addr == selected_slave) {
+            if (success) {
+                status_.store(snapshot);
+            }
+            flag_modbus_recv_err_ = !success;
+        }
+
+        success_all &= success;
+    }
+
+    // Commands for slaves outside the round, or queued behind another one, do not wait for the next round
+    if (combined_transfer_) {
+        coalescer_.flushAll([this] (const CommandCoalescer::Command &command) {
+            return writeCommand(command);
+        });
+    }
+
+    updateMotionWatches();
+
+    return success_all;
+}
+
+void DatcCtrl::pollLoop(const atomic<bool> &stop_flag, const function<void()> &on_cycle) {
+    using clock = std::chrono::steady_clock;
+
+    if (poll_realtime_ || poll_cpu_core_ >= 0) {
+        applyPollScheduling();
+    }
+    flag_sched_changed_ = false;
+
+    clock::time_point deadline   = clock::now();
+    clock::time_point last_start = deadline;
+    bool measuring = false;
+
+    bool deferred = false;
+    clock::duration deferred_period {};
+
+    while (!stop_flag) {
+        if (flag_sched_changed_.exchange(false)) {
+            applyPollScheduling();
+        }
+
+        // Slowed down if the baudrate cannot carry the requested rate for every polled slave
+        const double freq = min((double) poll_freq_, getMaxPollFreq(max(poll_round_.size(), (size_t) 1)));
+        const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1 / freq));
+        poll_stats_.setPeriod(1000 / freq);
+
+        // Commands wait for the status reads only while this loop is there to pick them up
+        const bool defer = combined_transfer_ && mbc_.getConnectionState();
+
+        if (defer != deferred || (defer && period != deferred_period)) {
+            coalescer_.setDeferred(defer, std::chrono::duration_cast<std::chrono::milliseconds>(2 * period));
+            deferred = defer;
+            deferred_period = period;
+        }
+
+        auto time_start = clock::now();
+
+        {
+            // Rounds are skipped while calibrateTiming() has the bus
+            unique_lock<mutex> lg_poll(mutex_poll_, try_to_lock);
+            const bool polling = lg_poll.owns_lock() && mbc_.getConnectionState();
+
+            if (polling) {
+                pollBus();
+
+                if (on_cycle) {
+                    on_cycle();
+                }
+
+                if (measuring) {
+                    std::chrono::duration<double, milli> cycle = time_start - last_start;
+                    poll_stats_.addCycle(cycle.count(), clock::now() > deadline + period);
+                }
+            }
+
+            measuring = polling;
+        }
+
+        last_start = time_start;
+
+        // Absolute deadlines, so the sleep and wake-up latency does not accumulate as drift
+        deadline += period;
+
+        auto now = clock::now();
+
+        if (now >= deadline) {
+            // Overrun: start over from now instead of bursting to catch up
+            deadline = now;
+        } else {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+
+    coalescer_.setDeferred(false);
+}
+
+void DatcCtrl::setPollFreq(uint16_t freq) {
+    poll_freq_ = min(max(freq, kPollFreqMin), kPollFreqMax);
+
+    if (poll_freq_ != freq) {
+        COUT("[WARN] Poll rate limited to " + to_string(poll_freq_) + " Hz.");
+    }
+
+    poll_stats_.reset();
+}
+
+double DatcCtrl::getMaxPollFreq(size_t slave_num) {
+    const int baudrate = mbc_.getBaudrate();
+
+    if (baudrate <= 0 || slave_num == 0) {
+        return kPollFreqMax;
+    }
+
+    const double max_freq = (double) baudrate / (kCharsPerStatusRead * kBitsPerChar * slave_num);
+    return max(min(max_freq, (double) kPollFreqMax), (double) kPollFreqMin);
+}
+
+TimingCalibration DatcCtrl::calibrateTiming(size_t samples) {
+    TimingCalibration calibration;
+    calibration.baudrate = mbc_.getBaudrate();
+    calibration.before   = mbc_.getTiming();
+
+    if (!mbc_.getConnectionState()) {
+        COUT("[RS485 Timing] Modbus communication is not enabled.");
+        return calibration;
+    }
+
+    // No poll round in between the measured reads, and none waits for a timeout being tried
+    lock_guard<mutex> lg_poll(mutex_poll_);
+
+    vector<uint16_t> slaves = getPollSlaves();
+
+    if (find(slaves.begin(), slaves.end(), mbc_.getSlaveAddr()) == slaves.end()) {
+        slaves.push_back(mbc_.getSlaveAddr());
+    }
+
+    calibration.missing_slave_before_ms = measureMissingSlave(slaves);
+
+    Rs485Timing timing = calibration.before;
+    timing.response_timeout_us = kCalibrationTimeoutUs;
+    timing.byte_timeout_us     = kCalibrationTimeoutUs;
+    mbc_.setTiming(timing);
+
+    auto failFn = [&] (const string &reason) {
+        COUT("[RS485 Timing] Calibration failed: " + reason);
+        mbc_.setTiming(calibration.before);
+        calibration.after = calibration.before;
+        return calibration;
+    };
+
+    auto meanFn = [] (const vector<double> &rtt) {
+        double sum = 0;
+        for (auto sample : rtt) {
+            sum += sample;
+        }
+        return sum / rtt.size();
+    };
+
+    // 1. Round trips with the current RTS delay
+    map<uint16_t, vector<double>> rtt_ms;
+    measureRoundTrips(slaves, samples, rtt_ms);
+
+    slaves.clear();
+
+    for (auto &slave : rtt_ms) {
+        if (slave.second.empty()) {
+            printf("[RS485 Timing] Slave %d did not answer and is left out\n", slave.first);
+            continue;
+        }
+
+        slaves.push_back(slave.first);
+        calibration.round_before_ms += meanFn(slave.second);
+    }
+
+    if (slaves.empty()) {
+        return failFn("no slave answered");
+    }
+
+    // 2. Halves the RTS delay as long as every probe read succeeds, from the default at most
+    const uint32_t rts_start = max(calibration.before.rts_delay_us, Rs485Timing().rts_delay_us);
+    uint32_t rts_working = rts_start;
+    uint32_t rts_margin  = rts_start; // One step above the smallest working delay
+
+    for (uint32_t candidate = rts_start / 2; rts_working > 0; candidate /= 2) {
+        if (candidate < kRtsDelayMinStep) {
+            candidate = 0;
+        }
+
+        timing.rts_delay_us = candidate;
+        mbc_.setTiming(timing);
+
+        map<uint16_t, vector<double>> probe;
+
+        if (measureRoundTrips(slaves, kCalibrationProbeReads, probe, true) > 0) {
+            break;
+        }
+
+        rts_margin  = rts_working;
+        rts_working = candidate;
+    }
+
+    timing.rts_delay_us = rts_margin;
+    mbc_.setTiming(timing);
+
+    // 3. Round trips with the chosen RTS delay give the timeouts
+    rtt_ms.clear();
+
+    if (measureRoundTrips(slaves, samples, rtt_ms) == slaves.size() * samples) {
+        return failFn("no answer with the calibrated RTS delay");
+    }
+
+    double rtt_p99 = 0;
+    double rtt_min = kCalibrationTimeoutUs / 1000.0;
+
+    for (auto &slave : rtt_ms) {
+        auto &rtt = slave.second;
+
+        if (rtt.empty()) {
+            continue;
+        }
+
+        calibration.round_after_ms += meanFn(rtt);
+
+        auto p99 = rtt.begin() + (rtt.size() - 1) * 99 / 100;
+        nth_element(rtt.begin(), p99, rtt.end());
+
+        calibration.slave_p99_ms[slave.first] = *p99;
+        rtt_p99 = max(rtt_p99, *p99);
+        rtt_min = min(rtt_min, *min_element(rtt.begin(), rtt.end()));
+    }
+
+    // The byte timeout covers the spread of the round trip, and never less than the 3.5 character frame silence
+    const double char_us = 1e6 * kBitsPerChar / calibration.baudrate;
+    const double byte_gap_us = max((rtt_p99 - rtt_min) * 1000, 4 * char_us);
+
+    timing.response_timeout_us = (uint32_t) (rtt_p99 * 1000 * kTimingMarginRatio) + kTimingMarginUs;
+    timing.byte_timeout_us     = (uint32_t) (byte_gap_us * kTimingMarginRatio) + kTimingMarginUs;
+    mbc_.setTiming(timing);
+
+    // 4. The calibrated timing must not cost a single read
+    map<uint16_t, vector<double>> verify;
+
+    if (measureRoundTrips(slaves, kCalibrationProbeReads, verify, true) > 0) {
+        return failFn("verification reads failed with the calibrated timeouts");
+    }
+
+    calibration.after   = timing;
+    calibration.success = true;
+    calibration.missing_slave_after_ms = measureMissingSlave(slaves);
+
+    printf("[RS485 Timing] %s at %d bps: RTS delay %u -> %u us, response timeout %u -> %u us, byte timeout %u -> %u us\n",
+           mbc_.getPortName().c_str(), calibration.baudrate,
+           calibration.before.rts_delay_us, timing.rts_delay_us,
+           calibration.before.response_timeout_us, timing.response_timeout_us,
+           calibration.before.byte_timeout_us, timing.byte_timeout_us);
+    printf("[RS485 Timing] Poll round %.2f -> %.2f ms, a missing slave costs %.1f -> %.1f ms\n",
+           calibration.round_before_ms, calibration.round_after_ms,
+           calibration.missing_slave_before_ms, calibration.missing_slave_after_ms);
+
+    Rs485TimingStore::save(mbc_.getPortName(), calibration);
+
+    return calibration;
+}
+
+size_t DatcCtrl::measureRoundTrips(const vector<uint16_t> &slaves, size_t count, map<uint16_t, vector<double>> &rtt_ms,
+                                   bool stop_on_failure) {
+    StatusRegisters reg;
+    size_t failures = 0;
+
+    for (auto slave_addr : slaves) {
+        auto &rtt = rtt_ms[slave_addr];
+        rtt.reserve(count);
+
+        size_t misses = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            double sample = 0;
+
+            if (mbc_.probeData(slave_addr, kStatusRegAddr, reg.size(), reg.data(), sample)) {
+                rtt.push_back(sample);
+                misses = 0;
+                continue;
+            }
+
+            failures++;
+
+            // Every failed read waits for the full timeout, a slave that is not there is given up early
+            if (stop_on_failure) {
+                return failures;
+            } else if (++misses >= kCalibrationMaxMisses) {
+                failures += count - i - 1;
+                break;
+            }
+        }
+    }
+
+    return failures;
+}
+
+double DatcCtrl::measureMissingSlave(const vector<uint16_t> &slaves) {
+    StatusRegisters reg;
+    size_t tries = 0;
+
+    // The highest addresses are the least likely to be in use
+    for (uint16_t slave_addr = kMissingSlaveProbeAddr; slave_addr > 0 && tries < kMissingSlaveProbeTries; slave_addr--) {
+        if (find(slaves.begin(), slaves.end(), slave_addr) != slaves.end()) {
+            continue;
+        }
+
+        tries++;
+        double elapsed_ms = 0;
+
+        if (!mbc_.probeData(slave_addr, kStatusRegAddr, reg.size(), reg.data(), elapsed_ms)) {
+            return elapsed_ms;
+        }
+
+        printf("[RS485 Timing] Slave %d answered although it is not polled, trying another address\n", slave_addr);
+    }
+
+    return 0;
+}
+
+void DatcCtrl::setCombinedTransfer(bool enable) {
+    combined_transfer_ = enable;
+
+    if (!enable) {
+        coalescer_.setDeferred(false);
+    }
+}
+
+void DatcCtrl::setPollScheduling(bool realtime, int cpu_core) {
+    poll_realtime_ = realtime;
+    poll_cpu_core_ = cpu_core;
+    flag_sched_changed_ = true;
+}
+
+void DatcCtrl::applyPollScheduling() {
+#ifdef __linux__
+    sched_param param {};
+    int policy = SCHED_OTHER;
+
+    if (poll_realtime_) {
+        policy = SCHED_FIFO;
+        param.sched_priority = kPollRtPriority;
+    }
+
+    if (pthread_setschedparam(pthread_self(), policy, &param) != 0) {
+        COUT("[WARN] Failed to set the poll thread scheduling (SCHED_FIFO requires CAP_SYS_NICE).");
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    const int cpu_num = (int) std::thread::hardware_concurrency();
+
+    if (poll_cpu_core_ >= 0 && poll_cpu_core_ < cpu_num) {
+        CPU_SET(poll_cpu_core_, &cpu_set);
+    } else {
+        for (int i = 0; i < cpu_num && i < CPU_SETSIZE; i++) {
+            CPU_SET(i, &cpu_set);
+        }
+    }
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        COUT("[WARN] Failed to set the poll thread CPU affinity.");
+    }
+#else
+    if (poll_realtime_ || poll_cpu_core_ >= 0) {
+        COUT("[WARN] Real-time scheduling of the poll thread is only supported on Linux.");
+    }
+#endif
+}
+
+DatcStatusSnapshot DatcCtrl::updatePollState(uint16_t slave_addr, const DatcStatus &status, bool success) {
+    auto now = chrono::steady_clock::now();
+
+    unique_lock<mutex> lg(mutex_slave_);
+
+    auto &state = slave_states_[slave_addr];
+    state.recv_err = !success;
+
+    const SlaveHealth previous = state.health.get();
+    const bool health_changed  = state.health.update(success, now);
+    const SlaveHealth health   = state.health.get();
+
+    if (success) {
+        state.snapshot.status = status;
+        state.snapshot.seq++;
+        state.snapshot.timestamp_us = chrono::duration_cast<chrono::microseconds>(now.time_since_epoch()).count();
+        state.poll_count++;
+    }
+
+    chrono::duration<double> window = now - state.rate_window_start;
+
+    if (window.count() >= 1.0) {
+        state.poll_rate = state.poll_count / window.count();
+        state.poll_count = 0;
+        state.rate_window_start = now;
+    }
+
+    const DatcStatusSnapshot snapshot = state.snapshot;
+    lg.unlock();
+
+    // Outside the lock, the callback may read the states again
+    if (health_changed) {
+        printf("[Slave Health] Slave %d: %.*s -> %.*s\n", slave_addr,
+               (int) slaveHealthName(previous).size(), slaveHealthName(previous).data(),
+               (int) slaveHealthName(health).size(), slaveHealthName(health).data());
+
+        if (on_health_) {
+            on_health_(slave_addr, previous, health);
+        }
+    }
+
+    return snapshot;
+}
+
+bool DatcCtrl::checkDurationRange(const char *error_prefix, uint16_t &duration) {
     if (duration < kDurationMin) {
-        printf("%s Duration is too short ( < %dms)", error_prefix.c_str(), kDurationMin);
+        printf("%s Duration is too short ( < %dms)", error_prefix, kDurationMin);
         duration = kDurationMin;
         return false;
     } else if (duration > kDurationMax) {
-        printf("%s Duration is too long ( > %dms)", error_prefix.c_str(), kDurationMax);
+        printf("%s Duration is too long ( > %dms)", error_prefix, kDurationMax);
         duration = kDurationMax;
         return false;
     }
@@ -212,61 +1020,61 @@ bool DatcCtrl::checkDurationRange(string error_prefix, uint16_t &duration) {
     return true;
 }
 
-bool DatcCtrl::command(DATC_COMMAND cmd, uint16_t value_1, uint16_t value_2) {
+bool DatcCtrl::command(DATC_COMMAND cmd, uint16_t value_1, uint16_t value_2, uint16_t target) {
     switch (cmd) {
         case DATC_COMMAND::MOTOR_ENABLE:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::MOTOR_STOP:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::MOTOR_DISABLE:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::MOTOR_POSITION_CONTROL:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1, value_2}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1, value_2});
 
         case DATC_COMMAND::MOTOR_VELOCITY_CONTROL:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1, value_2}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1, value_2});
 
         case DATC_COMMAND::MOTOR_CURRENT_CONTROL:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1, value_2}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1, value_2});
 
         case DATC_COMMAND::CHANGE_MODBUS_ADDRESS:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1});
 
         case DATC_COMMAND::GRIPPER_INITIALIZE:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::GRIPPER_OPEN:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::GRIPPER_CLOSE:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::SET_FINGER_POSITION:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1});
 
         case DATC_COMMAND::VACUUM_GRIPPER_ON:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::VACUUM_GRIPPER_OFF:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::IMPEDANCE_ON:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::IMPEDANCE_OFF:
-            return SEND_CMD(cmd);
+            return SEND_CMD(target, cmd);
 
         case DATC_COMMAND::SET_IMPEDANCE_PARAMS:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1, value_2}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1, value_2});
 
         case DATC_COMMAND::SET_MOTOR_TORQUE:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1});
 
         case DATC_COMMAND::SET_MOTOR_SPEED:
-            return SEND_CMD_VECTOR(vector<uint16_t> ({(uint16_t) cmd, value_1}));
+            return SEND_CMD_REGS(target, {(uint16_t) cmd, value_1});
 
         default:
             COUT("Error: Undefined command.");
@@ -274,9 +1082,126 @@ bool DatcCtrl::command(DATC_COMMAND cmd, uint16_t value_1, uint16_t value_2) {
     }
 }
 
+bool DatcCtrl::submitCommand(uint16_t slave_addr, initializer_list<uint16_t> regs) {
+    CommandCoalescer::Command command;
+
+    command.slave    = slave_addr;
+    command.setpoint = isSetpointCommand(*regs.begin());
+    command.reg_num  = min(regs.size(), CommandCoalescer::kMaxRegNum);
+    copy_n(regs.begin(), command.reg_num, command.regs.begin());
+
+    // Would only wait for the response timeout
+    if (getSlaveHealth(slave_addr) == SlaveHealth::DOWN) {
+        printf("[Command] Slave %d is down, command %d is not sent\n", slave_addr, *regs.begin());
+        recordCommand(command, false);
+        return false;
+    }
+
+    bool superseded = false;
+    const bool result = coalescer_.submit(command, [this] (const CommandCoalescer::Command &command) {
+        return writeCommand(command);
+    }, superseded);
+
+    last_command_superseded = superseded;
+
+    // The motion being watched on this slave will not finish as asked any more
+    if (result && !superseded && isMotionCommand(command.regs[0])) {
+        cancelMotionWatches(slave_addr);
+    }
+
+    recordCommand(command, result);
+
+    return result;
+}
+
+bool DatcCtrl::writeCommand(const CommandCoalescer::Command &command) {
+    return mbc_.sendData(command.slave, CMD_ADDR, RegisterSpan(command.regs.data(), command.reg_num));
+}
+
+bool DatcCtrl::startRecording(uint16_t bus_id, const string &directory) {
+    RecorderConfig config;
+
+    config.directory      = directory;
+    config.bus_id         = bus_id;
+    config.port_name      = mbc_.getPortName();
+    config.baudrate       = mbc_.getBaudrate();
+    config.selected_slave = mbc_.getSlaveAddr();
+    config.poll_slaves    = getPollSlaves();
+
+    auto recorder = make_shared<TelemetryRecorder>();
+
+    if (!recorder->start(config)) {
+        return false;
+    }
+
+    // The poll thread may still append to the previous one, it drops records once stopped
+    auto previous = atomic_exchange(&recorder_, recorder);
+
+    if (previous) {
+        previous->stop();
+    }
+
+    return true;
+}
+
+void DatcCtrl::stopRecording() {
+    auto recorder = atomic_exchange(&recorder_, shared_ptr<TelemetryRecorder>());
+
+    if (recorder) {
+        recorder->stop();
+    }
+}
+
+RecorderStats DatcCtrl::getRecorderStats() {
+    auto recorder = atomic_load(&recorder_);
+    return recorder ? recorder->getStats() : RecorderStats();
+}
+
+void DatcCtrl::recordStatus(uint16_t slave_addr, const DatcStatusSnapshot &snapshot) {
+    auto recorder = atomic_load(&recorder_);
+
+    if (!recorder) {
+        return;
+    }
+
+    StatusRecord record = {};
+
+    record.timestamp_us = snapshot.timestamp_us;
+    record.type         = RecordType::STATUS;
+    record.slave_addr   = slave_addr;
+    record.seq          = snapshot.seq;
+    record.states       = snapshot.status.states;
+    record.motor_pos    = snapshot.status.motor_pos;
+    record.motor_vel    = snapshot.status.motor_vel;
+    record.motor_cur    = snapshot.status.motor_cur;
+    record.finger_pos   = snapshot.status.finger_pos;
+    record.voltage      = snapshot.status.voltage;
+
+    recorder->append(record);
+}
+
+void DatcCtrl::recordCommand(const CommandCoalescer::Command &command, bool result) {
+    auto recorder = atomic_load(&recorder_);
+
+    if (!recorder) {
+        return;
+    }
+
+    CommandRecord record = {};
+
+    record.timestamp_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    record.type         = RecordType::COMMAND;
+    record.result       = result ? 1 : 0;
+    record.slave_addr   = command.slave;
+    record.reg_num      = (uint16_t) command.reg_num;
+    copy_n(command.regs.begin(), min((size_t) command.reg_num, kRecorderCommandRegNum), record.regs);
+
+    recorder->append(record);
+}
+
 // Dev ui related functions
 bool DatcCtrl::customCmd(uint16_t cmd, uint16_t value_1, uint16_t value_2, uint16_t value_3) {
-    return SEND_CMD_VECTOR(vector<uint16_t> ({cmd, value_1, value_2, value_3}));
+    return SEND_CMD_REGS(kSelectedSlave, {cmd, value_1, value_2, value_3});
 }
 
 // Impedance related functions
@@ -289,21 +1214,21 @@ bool DatcCtrl::impedanceOff() {
 }
 
 bool DatcCtrl::setImpedanceParams(int16_t slave_num, int16_t stiffness_level) {
-    string error_prefix = "[Set Impedance M]";
+    const char *error_prefix = "[Set Impedance M]";
 
     if (slave_num < 1) {
-        printf("%s slave_num is too small ( < %d)", error_prefix.c_str(), 1);
+        printf("%s slave_num is too small ( < %d)", error_prefix, 1);
         slave_num = 1;
     } else if (slave_num > 100) {
-        printf("%s slave_num is too large ( > %d)", error_prefix.c_str(), 100);
+        printf("%s slave_num is too large ( > %d)", error_prefix, 100);
         slave_num = 100;
     }
 
     if (stiffness_level < 1) {
-        printf("%s stiffness_level is too small ( < %d)", error_prefix.c_str(), 1);
+        printf("%s stiffness_level is too small ( < %d)", error_prefix, 1);
         stiffness_level = 1;
     } else if (stiffness_level > 10) {
-        printf("%s stiffness_level is too large ( > %d)", error_prefix.c_str(), 10);
+        printf("%s stiffness_level is too large ( > %d)", error_prefix, 10);
         stiffness_level = 10;
     }
 
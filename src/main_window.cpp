@@ -23,6 +23,7 @@ MainWindow::MainWindow(int argc, char **argv, bool &success, QWidget *parent) :
     advanced_ctrl_widget_  = new AdvancedCtrlWidget(this);
     impedance_ctrl_widget_ = new ImpedanceCtrlWidget(this);
     dev_tab_widget_        = new DevTabWidget(this);
+    telemetry_plot_widget_ = new TelemetryPlotWidget(this);
 
     ui_->setupUi(this);
 
@@ -35,6 +36,7 @@ MainWindow::MainWindow(int argc, char **argv, bool &success, QWidget *parent) :
     ui_->stackedWidget->addWidget(advanced_ctrl_widget_);
     ui_->stackedWidget->addWidget(impedance_ctrl_widget_);
     ui_->stackedWidget->addWidget(dev_tab_widget_);
+    ui_->stackedWidget->addWidget(telemetry_plot_widget_);
 
 #ifndef RCLCPP__RCLCPP_HPP_
     ui_->stackedWidget->addWidget(tcp_widget_);
@@ -84,6 +86,8 @@ MainWindow::MainWindow(int argc, char **argv, bool &success, QWidget *parent) :
     QString checkbox_qstr = "QCheckBox::indicator {width:25px; height: 25px;}";
 
     tcp_widget_->ui_.checkBox_tcp_send_status->setStyleSheet(checkbox_qstr);
+    modbus_widget_->ui_.checkBox_all_ports->setStyleSheet(checkbox_qstr);
+    modbus_widget_->ui_.checkBox_poll_realtime->setStyleSheet(checkbox_qstr);
 
     checkbox_qstr = "QCheckBox::indicator {width:20px; height: 20px;}";
 
@@ -128,6 +132,12 @@ MainWindow::MainWindow(int argc, char **argv, bool &success, QWidget *parent) :
     QObject::connect(modbus_widget_->ui_.pushButton_modbus_stop , SIGNAL(clicked()), this, SLOT(releaseModbus()));
     QObject::connect(modbus_widget_->ui_.pushButton_modbus_slave_change  , SIGNAL(clicked()), this, SLOT(changeSlaveAddress()));
     QObject::connect(modbus_widget_->ui_.pushButton_modbus_set_slave_addr, SIGNAL(clicked()), this, SLOT(setSlaveAddr()));
+    QObject::connect(modbus_widget_->ui_.lineEdit_poll_slaves, SIGNAL(editingFinished()), this, SLOT(setPollSlaves()));
+    QObject::connect(modbus_widget_->ui_.spinBox_poll_freq   , SIGNAL(editingFinished()), this, SLOT(setPollFreq()));
+    QObject::connect(modbus_widget_->ui_.spinBox_poll_cpu    , SIGNAL(editingFinished()), this, SLOT(setPollScheduling()));
+    QObject::connect(modbus_widget_->ui_.checkBox_poll_realtime, SIGNAL(toggled(bool)), this, SLOT(setPollScheduling()));
+    QObject::connect(modbus_widget_->ui_.checkBox_combined_transfer, SIGNAL(toggled(bool)), this, SLOT(setCombinedTransfer(bool)));
+    QObject::connect(modbus_widget_->ui_.pushButton_calibrate_timing, SIGNAL(clicked()), this, SLOT(calibrateTiming()));
 
     // Impedance control related btn
     QObject::connect(impedance_ctrl_widget_->ui_.pushButton_cmd_impedance_on       , SIGNAL(clicked()), this, SLOT(datcImpedanceOn()));
@@ -161,9 +171,46 @@ MainWindow::MainWindow(int argc, char **argv, bool &success, QWidget *parent) :
     ui_->pushButton_select_tcp->setHidden(true);
 #endif
 
+    // Modbus I/O runs on the bus worker, results come back through the event loop
+    QObject::connect(datc_interface_, SIGNAL(actionFinished(QString, bool)), this, SLOT(onActionFinished(QString, bool)), Qt::QueuedConnection);
+    QObject::connect(this, SIGNAL(timingCalibrated(QString)), this, SLOT(showTimingCalibration(QString)), Qt::QueuedConnection);
+
+    // Monitor widgets are rendered when the poll thread reports a change, starting from the current status
+    QObject::connect(datc_interface_, SIGNAL(statusChanged(MonitorStatus)), this, SLOT(renderStatus(MonitorStatus)), Qt::QueuedConnection);
+    renderStatus(datc_interface_->getMonitorStatus());
+
+#ifndef RCLCPP__RCLCPP_HPP_
+    QObject::connect(tcp_widget_->ui_.checkBox_tcp_send_status, SIGNAL(toggled(bool)), this, SLOT(setTcpSendStatus(bool)));
+    setTcpSendStatus(tcp_widget_->ui_.checkBox_tcp_send_status->isChecked());
+#endif
+
+    // Telemetry plot, fed by the poll thread of bus 0
+    for (int seconds : kPlotWindowSeconds) {
+        telemetry_plot_widget_->ui_.comboBox_plot_window->addItem(QString::number(seconds) + " s");
+    }
+    telemetry_plot_widget_->ui_.comboBox_plot_window->setCurrentIndex(1);
+    telemetry_plot_widget_->ui_.widget_plot->setRing(&datc_interface_->getTelemetry());
+    setPlotWindow(telemetry_plot_widget_->ui_.comboBox_plot_window->currentIndex());
+    setPlotChannels();
+
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_motor_pos , SIGNAL(toggled(bool)), this, SLOT(setPlotChannels()));
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_motor_vel , SIGNAL(toggled(bool)), this, SLOT(setPlotChannels()));
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_motor_cur , SIGNAL(toggled(bool)), this, SLOT(setPlotChannels()));
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_finger_pos, SIGNAL(toggled(bool)), this, SLOT(setPlotChannels()));
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_voltage   , SIGNAL(toggled(bool)), this, SLOT(setPlotChannels()));
+    QObject::connect(telemetry_plot_widget_->ui_.comboBox_plot_window    , SIGNAL(currentIndexChanged(int)), this, SLOT(setPlotWindow(int)));
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_pause     , SIGNAL(toggled(bool)), this, SLOT(setPlotPaused(bool)));
+    QObject::connect(telemetry_plot_widget_->ui_.checkBox_plot_record    , SIGNAL(toggled(bool)), this, SLOT(setRecording(bool)));
+
+    // Slider sync and frame time
     timer_ = new QTimer(this);
     connect(timer_, SIGNAL(timeout()), this, SLOT(timerCallback()));
-    timer_->start(100); // msec
+    timer_->start(kGuiRefreshPeriod);
+
+    // Poll rates and statistics, averaged over a second anyway
+    stats_refresh_timer_ = new QTimer(this);
+    connect(stats_refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshStats()));
+    stats_refresh_timer_->start(kStatsRefreshPeriod);
 
     datc_interface_->start();
     success = true;
@@ -179,60 +226,26 @@ MainWindow::~MainWindow() {
     if(timer_ != NULL) {
         delete timer_;
     }
+
+    if(stats_refresh_timer_ != NULL) {
+        delete stats_refresh_timer_;
+    }
 }
 
 void MainWindow::timerCallback() {
-    static std::function setButtonStyle([=] (QPushButton *btn) {
-        bool is_activated = btn->isEnabled();
-        btn->setStyleSheet(is_activated ? btn_active_str_ : btn_inactive_str_);
-    });
-
-    DatcStatus datc_status = datc_interface_->getDatcStatus();
+    QElapsedTimer busy_timer;
+    busy_timer.start();
 
-    // Display
-    ui_->lineEdit_monitor_finger_position->setText(QString::number((double) datc_status.finger_pos / 10 , 'f', 1) + " %");
-    ui_->lineEdit_monitor_current        ->setText(QString::number(datc_status.motor_cur) + " mA");
+    // Anything blocking the event loop shows up as a longer interval
+    if (frame_timer_.isValid()) {
+        const double frame_ms = frame_timer_.nsecsElapsed() / 1e6;
+        frame_ms_.add(frame_ms);
 
-    // Comm. status check
-    const bool is_modbus_connected = datc_interface_->getConnectionState();
-
-    modbus_widget_->ui_.pushButton_modbus_start->setEnabled(!is_modbus_connected);
-    modbus_widget_->ui_.pushButton_modbus_stop ->setEnabled(is_modbus_connected);
-    modbus_widget_->ui_.pushButton_modbus_set_slave_addr->setEnabled(is_modbus_connected);
-    modbus_widget_->ui_.pushButton_modbus_slave_change->setEnabled(is_modbus_connected);
-
-    setButtonStyle(modbus_widget_->ui_.pushButton_modbus_start);
-    setButtonStyle(modbus_widget_->ui_.pushButton_modbus_stop);
-    setButtonStyle(modbus_widget_->ui_.pushButton_modbus_set_slave_addr);
-    setButtonStyle(modbus_widget_->ui_.pushButton_modbus_slave_change);
-
-    if (is_modbus_connected) {
-        if (datc_interface_->getModbusRecvErr()) {
-            ui_->lineEdit_monitor_mode->setText("Failed to read input register.");
-        } else {
-            ui_->lineEdit_monitor_mode->setText(" " + QString::fromStdString(datc_status.status_str));
+        if (frame_ms > kGuiStallMs) {
+            COUT("[GUI] Event loop blocked, " + to_string((int) frame_ms) + " ms since the last refresh");
         }
-
-        QString qstr_slave_addr = (datc_interface_->getSlaveAddr() == 0) ?
-                                  "N/A" : QString::number(datc_interface_->getSlaveAddr());
-
-        ui_->lineEdit_current_slave_addr->setText(qstr_slave_addr);
-    } else {
-        ui_->lineEdit_current_slave_addr->setText("N/A");
     }
-
-#ifndef RCLCPP__RCLCPP_HPP_
-    // Socket comm. status check
-    const bool is_socket_connected = datc_interface_->isSocketConnected();
-
-    tcp_widget_->ui_.pushButton_tcp_start->setEnabled(!is_socket_connected);
-    tcp_widget_->ui_.pushButton_tcp_stop ->setEnabled(is_socket_connected);
-
-    setButtonStyle(tcp_widget_->ui_.pushButton_tcp_start);
-    setButtonStyle(tcp_widget_->ui_.pushButton_tcp_stop);
-
-    datc_interface_->setTcpSendStatus(tcp_widget_->ui_.checkBox_tcp_send_status->isChecked());
-#endif
+    frame_timer_.start();
 
     // Slider control
     static std::function syncSliderSpinboxFn(
@@ -293,88 +306,258 @@ void MainWindow::timerCallback() {
     syncSliderSpinboxFn(slider_cur_prev, cur_prev,
                         advanced_ctrl_widget_->ui_.horizontalSlider_motor_current,
                         advanced_ctrl_widget_->ui_.doubleSpinBox_motor_current);
+
+    gui_busy_ns_ += busy_timer.nsecsElapsed();
+}
+
+void MainWindow::setButtonActive(QPushButton *btn, bool active) {
+    btn->setEnabled(active);
+    btn->setStyleSheet(active ? btn_active_str_ : btn_inactive_str_);
+}
+
+void MainWindow::renderStatus(MonitorStatus status) {
+    QElapsedTimer busy_timer;
+    busy_timer.start();
+
+    // Only the widgets whose value differs from the last rendered status are touched
+    const bool first = !has_rendered_;
+    const MonitorStatus &last = rendered_status_;
+
+    if (first || status.finger_pos != last.finger_pos) {
+        ui_->lineEdit_monitor_finger_position->setText(QString::number((double) status.finger_pos / 10 , 'f', 1) + " %");
+    }
+
+    if (first || status.motor_cur != last.motor_cur) {
+        ui_->lineEdit_monitor_current->setText(QString::number(status.motor_cur) + " mA");
+    }
+
+    // Button styles follow the connection transitions
+    if (first || status.modbus_connected != last.modbus_connected) {
+        const bool is_modbus_connected = status.modbus_connected;
+
+        setButtonActive(modbus_widget_->ui_.pushButton_modbus_start, !is_modbus_connected);
+        setButtonActive(modbus_widget_->ui_.pushButton_modbus_stop , is_modbus_connected);
+        setButtonActive(modbus_widget_->ui_.pushButton_modbus_set_slave_addr, is_modbus_connected);
+        setButtonActive(modbus_widget_->ui_.pushButton_modbus_slave_change, is_modbus_connected);
+
+        if (!is_modbus_connected) {
+            ui_->lineEdit_current_slave_addr->setText("N/A");
+            modbus_widget_->ui_.lineEdit_poll_rate->setText("");
+            ui_->lineEdit_monitor_mode->setText("");
+            monitor_mode_text_.clear();
+        }
+    }
+
+    if (status.modbus_connected) {
+        QString mode_text;
+
+        if (status.health == SlaveHealth::DOWN) {
+            mode_text = "No response, the slave is down.";
+        } else if (status.recv_err) {
+            mode_text = "Failed to read input register.";
+        } else {
+            const string_view state_name = datcStateName(status.state);
+            mode_text = " " + QString::fromUtf8(state_name.data(), (int) state_name.size());
+        }
+
+        if (mode_text != monitor_mode_text_) {
+            ui_->lineEdit_monitor_mode->setText(mode_text);
+            monitor_mode_text_ = mode_text;
+        }
+
+        if (first || !last.modbus_connected || status.slave_addr != last.slave_addr) {
+            ui_->lineEdit_current_slave_addr->setText((status.slave_addr == 0) ? "N/A" : QString::number(status.slave_addr));
+        }
+    }
+
+#ifndef RCLCPP__RCLCPP_HPP_
+    if (first || status.socket_connected != last.socket_connected) {
+        setButtonActive(tcp_widget_->ui_.pushButton_tcp_start, !status.socket_connected);
+        setButtonActive(tcp_widget_->ui_.pushButton_tcp_stop , status.socket_connected);
+    }
+#endif
+
+    rendered_status_ = status;
+    has_rendered_    = true;
+
+    gui_busy_ns_ += busy_timer.nsecsElapsed();
+}
+
+void MainWindow::refreshStats() {
+    QElapsedTimer busy_timer;
+    busy_timer.start();
+
+    auto setTextFn = [] (QLineEdit *line_edit, const QString &text) {
+        if (line_edit->text() != text) {
+            line_edit->setText(text);
+        }
+    };
+
+    // p99 / max over the last kSampleWindowSize refreshes, should stay near kGuiRefreshPeriod
+    vector<double> frame_samples = frame_ms_.copy();
+    const TimingSummary frame_summary = summarizeSamples(frame_samples);
+
+    // Time the GUI thread spent refreshing widgets, per second
+    const double busy_ms_per_s = (busy_window_timer_.isValid() && busy_window_timer_.elapsed() > 0) ?
+                                 gui_busy_ns_ / 1e6 / (busy_window_timer_.elapsed() / 1000.0) : 0;
+    gui_busy_ns_ = 0;
+    busy_window_timer_.start();
+
+    const QString frame_str = "GUI frame " + QString::number(frame_summary.p99, 'f', 1) + "/" +
+                              QString::number(frame_summary.max, 'f', 1) + " ms" +
+                              "  Busy " + QString::number(busy_ms_per_s, 'f', 2) + " ms/s";
+
+    if (!rendered_status_.modbus_connected) {
+        setTextFn(modbus_widget_->ui_.lineEdit_poll_stats, frame_str);
+        gui_busy_ns_ += busy_timer.nsecsElapsed();
+        return;
+    }
+
+    // Achieved poll rate of every slave on the bus at the current baudrate
+    QStringList poll_rate_list;
+
+    auto appendPollRateFn = [&poll_rate_list] (DatcCtrl &bus, const QString &prefix) {
+        vector<uint16_t> poll_slaves = bus.getPollSlaves();
+        const uint16_t selected_slave = bus.getSlaveAddr();
+
+        if (find(poll_slaves.begin(), poll_slaves.end(), selected_slave) == poll_slaves.end()) {
+            poll_slaves.push_back(selected_slave);
+        }
+
+        for (auto slave_addr : poll_slaves) {
+            const SlaveHealth health = bus.getSlaveHealth(slave_addr);
+            QString rate = QString::number(bus.getPollRate(slave_addr), 'f', 1) + " Hz";
+
+            // Suspect and down slaves are flagged, a down slave is only probed
+            if (health != SlaveHealth::HEALTHY) {
+                const string_view health_name = slaveHealthName(health);
+                rate += " (" + QString::fromUtf8(health_name.data(), (int) health_name.size()) + ")";
+            }
+
+            poll_rate_list << prefix + "#" + QString::number(slave_addr) + ": " + rate;
+        }
+    };
+
+    appendPollRateFn(*datc_interface_, "");
+
+    // Additional ports opened with "Open all ports"
+    for (auto &bus : datc_interface_->getBuses()) {
+        appendPollRateFn(*bus, "[bus " + QString::number(bus->getBusId()) + "] ");
+    }
+
+    setTextFn(modbus_widget_->ui_.lineEdit_poll_rate, poll_rate_list.join("  "));
+
+    // Loop jitter and modbus round trip of bus 0 (min / avg / p99 / max)
+    const PollStatsSnapshot stats = datc_interface_->getPollStats();
+    const CoalescerStats command_stats = datc_interface_->getCommandStats();
+
+    auto summaryFn = [] (const TimingSummary &summary) {
+        return QString::number(summary.min, 'f', 1) + "/" + QString::number(summary.avg, 'f', 1) + "/" +
+               QString::number(summary.p99, 'f', 1) + "/" + QString::number(summary.max, 'f', 1);
+    };
+
+    setTextFn(modbus_widget_->ui_.lineEdit_poll_stats, "Cycle " + summaryFn(stats.cycle_ms) + " ms" +
+                                                       "  RTT " + summaryFn(stats.rtt_ms) + " ms" +
+                                                       "  Overrun " + QString::number(stats.overruns) +
+                                                       "  Cmd " + QString::number(command_stats.written) + "/" +
+                                                       QString::number(command_stats.submitted) + " written" +
+                                                       "  Combined " + QString::number(command_stats.combined) +
+                                                       "  " + frame_str);
+
+    gui_busy_ns_ += busy_timer.nsecsElapsed();
 }
 
 // Enable Disable
 void MainWindow::datcEnable() {
-    datc_interface_->motorEnable();
+    datc_interface_->postAction("Motor enable", [this] {return datc_interface_->motorEnable();});
 }
 
 void MainWindow::datcDisable() {
-    datc_interface_->motorDisable();
+    datc_interface_->postAction("Motor disable", [this] {return datc_interface_->motorDisable();});
 }
 
 // Datc control
 void MainWindow::datcFingerPosCtrl() {
-    datc_interface_->setFingerPos(datc_ctrl_widget_->ui_.doubleSpinBox_finger_pos->value() * 10);
+    uint16_t finger_pos = datc_ctrl_widget_->ui_.doubleSpinBox_finger_pos->value() * 10;
+    datc_interface_->postAction("Finger position", [this, finger_pos] {return datc_interface_->setFingerPos(finger_pos);});
 }
 
 void MainWindow::datcFingerPosCtrl2() {
-    datc_interface_->setFingerPos(impedance_ctrl_widget_->ui_.doubleSpinBox_finger_pos->value() * 10);
+    uint16_t finger_pos = impedance_ctrl_widget_->ui_.doubleSpinBox_finger_pos->value() * 10;
+    datc_interface_->postAction("Finger position", [this, finger_pos] {return datc_interface_->setFingerPos(finger_pos);});
 }
 
 void MainWindow::datcMotorVelCtrl() {
     int16_t vel = advanced_ctrl_widget_->ui_.doubleSpinBox_motor_speed->value() * kVelMax / 100;
     vel *= (advanced_ctrl_widget_->ui_.checkBox_motor_speed_reverse->isChecked()) ? -1 : 1;
-    datc_interface_->motorVelCtrl(vel);
+    datc_interface_->postAction("Motor velocity", [this, vel] {return datc_interface_->motorVelCtrl(vel);});
 }
 
 void MainWindow::datcMotorCurCtrl() {
     int16_t cur = advanced_ctrl_widget_->ui_.doubleSpinBox_motor_current->value() * kCurMax / 100;
     cur *= (advanced_ctrl_widget_->ui_.checkBox_motor_current_reverse->isChecked()) ? -1 : 1;
-    datc_interface_->motorCurCtrl(cur);
+    datc_interface_->postAction("Motor current", [this, cur] {return datc_interface_->motorCurCtrl(cur);});
 }
 
 void MainWindow::datcInit() {
-    datc_interface_->grpInitialize();
+    datc_interface_->postAction("Gripper initialize", [this] {return datc_interface_->grpInitialize();});
 }
 
 void MainWindow::datcOpen() {
-    datc_interface_->grpOpen();
+    datc_interface_->postAction("Gripper open", [this] {return datc_interface_->grpOpen();});
 }
 
 void MainWindow::datcClose() {
-    datc_interface_->grpClose();
+    datc_interface_->postAction("Gripper close", [this] {return datc_interface_->grpClose();});
 }
 
 void MainWindow::datcStop() {
-    datc_interface_->motorStop();
+    datc_interface_->postAction("Motor stop", [this] {return datc_interface_->motorStop();});
 }
 
 void MainWindow::datcVacuumGrpOn() {
-    datc_interface_->vacuumGrpOn();
+    datc_interface_->postAction("Vacuum gripper on", [this] {return datc_interface_->vacuumGrpOn();});
 }
 
 void MainWindow::datcVacuumGrpOff() {
-    datc_interface_->vacuumGrpOff();
+    datc_interface_->postAction("Vacuum gripper off", [this] {return datc_interface_->vacuumGrpOff();});
 }
 
 void MainWindow::datcSetTorque() {
-    datc_interface_->setMotorTorque((uint16_t) datc_ctrl_widget_->ui_.doubleSpinBox_torque->value());
+    uint16_t torque_ratio = datc_ctrl_widget_->ui_.doubleSpinBox_torque->value();
+    datc_interface_->postAction("Set torque", [this, torque_ratio] {return datc_interface_->setMotorTorque(torque_ratio);});
 }
 
 void MainWindow::datcSetSpeed() {
-    datc_interface_->setMotorSpeed((uint16_t) datc_ctrl_widget_->ui_.doubleSpinBox_speed->value());
+    uint16_t speed_ratio = datc_ctrl_widget_->ui_.doubleSpinBox_speed->value();
+    datc_interface_->postAction("Set speed", [this, speed_ratio] {return datc_interface_->setMotorSpeed(speed_ratio);});
 }
 
 // Impedance related functions
 void MainWindow::datcImpedanceOn() {
-    datc_interface_->impedanceOn();
-    usleep(100000);
-    datc_interface_->grpInitialize();
+    // The DATC needs a moment to switch the mode before it initializes, waited for on the worker
+    datc_interface_->postAction("Impedance on", [this] {
+        const bool success = datc_interface_->impedanceOn();
+        this_thread::sleep_for(kImpedanceSwitchDelay);
+        return datc_interface_->grpInitialize() && success;
+    });
 }
 
 void MainWindow::datcImpedanceOff() {
-    datc_interface_->impedanceOff();
-    usleep(100000);
-    datc_interface_->grpInitialize();
+    datc_interface_->postAction("Impedance off", [this] {
+        const bool success = datc_interface_->impedanceOff();
+        this_thread::sleep_for(kImpedanceSwitchDelay);
+        return datc_interface_->grpInitialize() && success;
+    });
 }
 
 void MainWindow::datcSetImpedanceParams() {
     int16_t slave_num       = impedance_ctrl_widget_->ui_.spinBox_impedance_slave_num->value();
     int16_t stiffness_level = impedance_ctrl_widget_->ui_.spinBox_impedance_stiffness_level->value();
 
-    datc_interface_->setImpedanceParams(slave_num, stiffness_level);
+    datc_interface_->postAction("Impedance params", [this, slave_num, stiffness_level] {
+        return datc_interface_->setImpedanceParams(slave_num, stiffness_level);
+    });
 }
 
 // Modbus RTU related
@@ -384,46 +567,198 @@ void MainWindow::initModbus() {
     COUT("[INFO] Slave address #" + modbus_widget_->ui_.spinBox_slave_addr->text().toStdString());
     COUT("--------------------------------------------");
 
-    const char* port = modbus_widget_->ui_.comboBox_serial_port->currentText().toStdString().c_str();
+    const string port = modbus_widget_->ui_.comboBox_serial_port->currentText().toStdString();
     uint16_t slave_addr = modbus_widget_->ui_.spinBox_slave_addr->value();
 
     // 왜인지 이렇게 우회해야만 release mode에서 정상적으로 동작함
     auto baudrate_qstr = modbus_widget_->ui_.comboBox_baudrate->currentText();
     auto baudrate = baudrate_qstr.toInt();
 
-    if (datc_interface_->init(port, slave_addr, baudrate)) {
-        // Successed
-    } else {
-        ui_->lineEdit_monitor_mode->setText("Invalid port or permission.");
-        COUT("[ERROR] Port name or slave address invlaid !");
+    // Every other listed port becomes a bus of its own with the same settings
+    vector<string> other_ports;
+
+    if (modbus_widget_->ui_.checkBox_all_ports->isChecked()) {
+        for (int i = 0; i < modbus_widget_->ui_.comboBox_serial_port->count(); i++) {
+            const string port_name = modbus_widget_->ui_.comboBox_serial_port->itemText(i).toStdString();
+
+            if (!port_name.empty() && port_name != port) {
+                other_ports.push_back(port_name);
+            }
+        }
     }
+
+    // Opening a port may take a while, the widgets are only read above
+    datc_interface_->postAction(kActionModbusInit, [this, port, slave_addr, baudrate, other_ports] {
+        if (!datc_interface_->init(port.c_str(), slave_addr, baudrate)) {
+            COUT("[ERROR] Port name or slave address invlaid !");
+            return false;
+        }
+
+        for (auto &port_name : other_ports) {
+            datc_interface_->openBus(port_name, slave_addr, baudrate, datc_interface_->getPollSlaves());
+        }
+
+        return true;
+    });
 }
 
 void MainWindow::releaseModbus() {
-    datc_interface_->modbusRelease();
-    ui_->lineEdit_monitor_mode->setText("");
+    datc_interface_->postAction("Modbus release", [this] {
+        datc_interface_->closeAllBuses();
+        return datc_interface_->modbusRelease();
+    });
 }
 
 void MainWindow::changeSlaveAddress() {
     uint16_t slave_addr = modbus_widget_->ui_.spinBox_slave_addr->value();
 
-    if (datc_interface_->modbusSlaveChange(slave_addr)) {
-        // Successed
-    } else {
-        COUT("[ERROR] Slave change failed !");
-    }
+    datc_interface_->postAction("Slave change", [this, slave_addr] {return datc_interface_->modbusSlaveChange(slave_addr);});
 }
 
 void MainWindow::setSlaveAddr() {
     uint16_t slave_addr = modbus_widget_->ui_.spinBox_slave_addr_4set->value();
 
-    if (datc_interface_->setModbusAddr(slave_addr)) {
-        // Successed
-    } else {
-        COUT("[ERROR] Slave change failed !");
+    datc_interface_->postAction("Set slave address", [this, slave_addr] {return datc_interface_->setModbusAddr(slave_addr);});
+}
+
+void MainWindow::setPollSlaves() {
+    vector<uint16_t> slave_list;
+
+    // Accepts "1,2,3" as well as "1 2 3"
+    QStringList slave_str_list = modbus_widget_->ui_.lineEdit_poll_slaves->text().split(QRegularExpression("[,\\s]+"), Qt::SkipEmptyParts);
+
+    for (auto &slave_str : slave_str_list) {
+        bool ok = false;
+        uint slave_addr = slave_str.toUInt(&ok);
+
+        if (ok) {
+            slave_list.push_back(slave_addr);
+        } else {
+            COUT("[ERROR] Invalid slave address: " + slave_str.toStdString());
+        }
+    }
+
+    datc_interface_->setPollSlaves(slave_list);
+}
+
+void MainWindow::setPollFreq() {
+    uint16_t poll_freq = modbus_widget_->ui_.spinBox_poll_freq->value();
+
+    datc_interface_->setPollFreq(poll_freq);
+
+    for (auto &bus : datc_interface_->getBuses()) {
+        bus->setPollFreq(poll_freq);
+    }
+}
+
+void MainWindow::setPollScheduling() {
+    const bool realtime = modbus_widget_->ui_.checkBox_poll_realtime->isChecked();
+
+    // Only bus 0 is pinned, the other buses keep the real-time class
+    datc_interface_->setPollScheduling(realtime, modbus_widget_->ui_.spinBox_poll_cpu->value());
+
+    for (auto &bus : datc_interface_->getBuses()) {
+        bus->setPollScheduling(realtime);
+    }
+}
+
+void MainWindow::calibrateTiming() {
+    modbus_widget_->ui_.lineEdit_timing->setText("Calibrating...");
+
+    // Takes a few seconds per port, the result is saved and reused when the port is opened again
+    datc_interface_->postAction("Timing calibration", [this] {
+        TimingCalibration calibration = datc_interface_->calibrateTiming();
+
+        for (auto &bus : datc_interface_->getBuses()) {
+            bus->calibrateTiming();
+        }
+
+        if (!calibration.success) {
+            Q_EMIT timingCalibrated("Calibration failed");
+            return false;
+        }
+
+        const Rs485Timing &timing = calibration.after;
+
+        Q_EMIT timingCalibrated("RTS " + QString::number(timing.rts_delay_us) + " us" +
+                                "  Timeout " + QString::number(timing.response_timeout_us / 1000.0, 'f', 1) + "/" +
+                                QString::number(timing.byte_timeout_us / 1000.0, 'f', 1) + " ms" +
+                                "  Round " + QString::number(calibration.round_before_ms, 'f', 1) + " -> " +
+                                QString::number(calibration.round_after_ms, 'f', 1) + " ms");
+        return true;
+    });
+}
+
+void MainWindow::setCombinedTransfer(bool enable) {
+    datc_interface_->setCombinedTransfer(enable);
+
+    for (auto &bus : datc_interface_->getBuses()) {
+        bus->setCombinedTransfer(enable);
     }
 }
 
+void MainWindow::showTimingCalibration(QString text) {
+    modbus_widget_->ui_.lineEdit_timing->setText(text);
+}
+
+void MainWindow::onActionFinished(QString name, bool success) {
+    if (success) {
+        return;
+    }
+
+    COUT("[ERROR] " + name.toStdString() + " failed !");
+
+    // While connected the monitor shows the state of the gripper instead
+    if (name == kActionModbusInit) {
+        ui_->lineEdit_monitor_mode->setText("Invalid port or permission.");
+    }
+}
+
+// Telemetry plot
+void MainWindow::setPlotChannels() {
+    TelemetryPlot *plot = telemetry_plot_widget_->ui_.widget_plot;
+
+    plot->setChannelVisible(TelemetryChannel::MOTOR_POS , telemetry_plot_widget_->ui_.checkBox_plot_motor_pos ->isChecked());
+    plot->setChannelVisible(TelemetryChannel::MOTOR_VEL , telemetry_plot_widget_->ui_.checkBox_plot_motor_vel ->isChecked());
+    plot->setChannelVisible(TelemetryChannel::MOTOR_CUR , telemetry_plot_widget_->ui_.checkBox_plot_motor_cur ->isChecked());
+    plot->setChannelVisible(TelemetryChannel::FINGER_POS, telemetry_plot_widget_->ui_.checkBox_plot_finger_pos->isChecked());
+    plot->setChannelVisible(TelemetryChannel::VOLTAGE   , telemetry_plot_widget_->ui_.checkBox_plot_voltage   ->isChecked());
+}
+
+void MainWindow::setPlotWindow(int index) {
+    if (index < 0 || index >= (int) kPlotWindowSeconds.size()) {
+        return;
+    }
+
+    telemetry_plot_widget_->ui_.widget_plot->setWindow((uint64_t) kPlotWindowSeconds[index] * 1000000);
+}
+
+void MainWindow::setPlotPaused(bool paused) {
+    telemetry_plot_widget_->ui_.widget_plot->setPaused(paused);
+}
+
+void MainWindow::setRecording(bool record) {
+    // Creating the first segment of every bus touches the disk, so it runs on the bus worker
+    datc_interface_->postAction("Recording", [this, record] {
+        if (!record) {
+            datc_interface_->stopRecording();
+
+            for (auto &bus : datc_interface_->getBuses()) {
+                bus->stopRecording();
+            }
+            return true;
+        }
+
+        bool success = datc_interface_->startRecording(0);
+
+        for (auto &bus : datc_interface_->getBuses()) {
+            success &= bus->startRecording(bus->getBusId());
+        }
+
+        return success;
+    });
+}
+
 // Dev ui related functions
 void MainWindow::dev_setGainP() {
     int p_p = dev_tab_widget_->ui_.spinBox_p_p->value();
@@ -431,7 +766,7 @@ void MainWindow::dev_setGainP() {
     int p_d = dev_tab_widget_->ui_.spinBox_p_d->value();
 
     // Set pos pid gain cmd: 211
-    datc_interface_->customCmd(211, p_p, p_i, p_d);
+    datc_interface_->postAction("Set position gain", [this, p_p, p_i, p_d] {return datc_interface_->customCmd(211, p_p, p_i, p_d);});
 }
 
 void MainWindow::dev_setGainV() {
@@ -439,7 +774,7 @@ void MainWindow::dev_setGainV() {
     int v_i = dev_tab_widget_->ui_.spinBox_v_i->value();
 
     // Set pos pid gain cmd: 214
-    datc_interface_->customCmd(214, v_p, v_i);
+    datc_interface_->postAction("Set velocity gain", [this, v_p, v_i] {return datc_interface_->customCmd(214, v_p, v_i);});
 }
 
 void MainWindow::dev_setGainC() {
@@ -447,7 +782,7 @@ void MainWindow::dev_setGainC() {
     int c_i = dev_tab_widget_->ui_.spinBox_c_i->value();
 
     // Set pos pid gain cmd: 215
-    datc_interface_->customCmd(215, c_p, c_i);
+    datc_interface_->postAction("Set current gain", [this, c_p, c_i] {return datc_interface_->customCmd(215, c_p, c_i);});
 }
 
 void MainWindow::dev_customCmd() {
@@ -456,17 +791,19 @@ void MainWindow::dev_customCmd() {
     int value_2 = dev_tab_widget_->ui_.spinBox_custom_cmd_value_2->value();
     int value_3 = dev_tab_widget_->ui_.spinBox_custom_cmd_value_3->value();
 
-    datc_interface_->customCmd(addr, value_1, value_2, value_3);
+    datc_interface_->postAction("Custom command", [this, addr, value_1, value_2, value_3] {
+        return datc_interface_->customCmd(addr, value_1, value_2, value_3);
+    });
 }
 
 void MainWindow::dev_resetPos() {
     // reset position order cmd: 8
-    datc_interface_->customCmd(8);
+    datc_interface_->postAction("Reset position", [this] {return datc_interface_->customCmd(8);});
 }
 
 void MainWindow::dev_setElecAngle() {
     // set electrical angle order cmd: 50
-    datc_interface_->customCmd(50);
+    datc_interface_->postAction("Set electrical angle", [this] {return datc_interface_->customCmd(50);});
 }
 
 #ifndef RCLCPP__RCLCPP_HPP_
@@ -475,11 +812,22 @@ void MainWindow::startTcpComm() {
     string addr          = tcp_widget_->ui_.lineEdit_tcp_addr->text().toStdString();
     uint16_t socket_port = tcp_widget_->ui_.lineEdit_tcp_port->text().toUInt();
 
-    datc_interface_->initTcp(addr, socket_port);
+    // Binding the port and starting the command worker stay off the GUI thread
+    datc_interface_->postAction("TCP start", [this, addr, socket_port] {
+        return datc_interface_->initTcp(addr, socket_port);
+    });
 }
 
 void MainWindow::stopTcpComm() {
-    datc_interface_->releaseTcp();
+    // Joins the command worker, which may be waiting on a modbus response
+    datc_interface_->postAction("TCP stop", [this] {
+        datc_interface_->releaseTcp();
+        return true;
+    });
+}
+
+void MainWindow::setTcpSendStatus(bool flag) {
+    datc_interface_->setTcpSendStatus(flag);
 }
 #endif
 
@@ -491,6 +839,7 @@ void MainWindow::on_pushButton_select_modbus_clicked() {
     ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_inactive_str_);
 }
 
 void MainWindow::on_pushButton_select_datc_ctrl_clicked() {
@@ -501,6 +850,7 @@ void MainWindow::on_pushButton_select_datc_ctrl_clicked() {
     ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_inactive_str_);
 }
 
 void MainWindow::on_pushButton_select_adv_clicked() {
@@ -511,6 +861,7 @@ void MainWindow::on_pushButton_select_adv_clicked() {
     ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_active_str_);
     ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_inactive_str_);
 }
 
 void MainWindow::on_pushButton_select_tcp_clicked() {
@@ -521,6 +872,7 @@ void MainWindow::on_pushButton_select_tcp_clicked() {
     ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_active_str_);
     ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_inactive_str_);
 }
 
 void MainWindow::on_pushButton_select_imped_ctrl_clicked() {
@@ -531,6 +883,18 @@ void MainWindow::on_pushButton_select_imped_ctrl_clicked() {
     ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_inactive_str_);
     ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_active_str_);
+    ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_inactive_str_);
+}
+
+void MainWindow::on_pushButton_select_plot_clicked() {
+    ui_->stackedWidget->setCurrentIndex((int) WidgetSeq::PLOT_WIDGET);
+
+    ui_->pushButton_select_modbus    ->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_datc_ctrl ->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_inactive_str_);
+    ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_active_str_);
 }
 
 void MainWindow::on_pushButton_modbus_refresh_clicked() {
@@ -559,6 +923,7 @@ void MainWindow::on_pushButton_logo_clicked() {
             ui_->pushButton_select_adv       ->setStyleSheet(menu_btn_inactive_str_);
             ui_->pushButton_select_tcp       ->setStyleSheet(menu_btn_inactive_str_);
             ui_->pushButton_select_imped_ctrl->setStyleSheet(menu_btn_inactive_str_);
+            ui_->pushButton_select_plot      ->setStyleSheet(menu_btn_inactive_str_);
         }
     }
 }
@@ -4,48 +4,57 @@
 //#include <boost/bind.hpp>
 #include <iostream>
 #include <system_error>
-#include <unistd.h>
 
-TcpServer::TcpServer(const int port)
+TcpServer::TcpServer(const int port, size_t io_thread_num)
         :acceptor_(io_service_, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)) {
     startAccept();
 
+    if (io_thread_num == 0) {
+        io_thread_num = max(1u, thread::hardware_concurrency());
+    }
+
+    // Every thread runs the same io_service; per-socket strands keep each connection serialised
 //    boost::thread io_service_thread(boost::bind(&boost::asio::io_service::run, &io_service_));
-    std::thread io_service_thread([&] () {io_service_.run();});
-    io_service_thread.detach();
+    for (size_t i = 0; i < io_thread_num; i++) {
+        io_threads_.emplace_back([&] () {io_service_.run();});
+    }
 }
 
 TcpServer::~TcpServer() {
-    acceptor_.close();
+    boost::system::error_code error;
+    acceptor_.close(error);
     io_service_.stop();
 
-    while (!io_service_.stopped()) {
-        usleep(1000);
+    for (auto &io_thread : io_threads_) {
+        if (io_thread.joinable()) {
+            io_thread.join();
+        }
     }
-
-    usleep(1000000);
 }
 
 void TcpServer::startAccept() {
-    TcpSocket *socket = new TcpSocket(io_service_);
+    auto socket = make_shared<TcpSocket>(io_service_);
 //    acceptor_.async_accept(socket->getSocket(), boost::bind(&TcpServer::acceptHandler, this, socket, boost::asio::placeholders::error));
     acceptor_.async_accept(socket->getSocket(), std::bind(&TcpServer::acceptHandler, this, socket, std::placeholders::_1));
 }
 
-void TcpServer::acceptHandler(TcpSocket* socket, const boost::system::error_code& err) {
+void TcpServer::acceptHandler(shared_ptr<TcpSocket> socket, const boost::system::error_code& err) {
+    if (err == boost::asio::error::operation_aborted) {
+        return;
+    }
+
     if (!err) {
         socket->start();
-    } else {
-        delete socket;
+        cout << "Tcp connected" << endl;
     }
 
-    usleep(50000);
     startAccept();
-    cout << "Tcp connected" << endl;
 }
 
 TcpSocket::TcpSocket(boost::asio::io_service &io_service)
-    :message_handler_(MessageManager<Json::Value>::getInstance()), socket_(io_service) {
+    :message_handler_(MessageManager<Json::Value>::getInstance()), socket_(io_service), strand_(io_service) {
+    Json::CharReaderBuilder builder;
+    json_reader_.reset(builder.newCharReader());
 
 }
 
@@ -58,17 +67,32 @@ boost::asio::ip::tcp::socket &TcpSocket::getSocket() {
 }
 
 void TcpSocket::start() {
-    message_handler_.createClientQueue(socket_.native_handle());
-//    boost::thread parse_thread(boost::bind(&TcpSocket::writeHandler, this));
-    std::thread parse_thread(std::bind(&TcpSocket::writeHandler, this));
-    parse_thread.detach();
-//    socket_.async_read_some(boost::asio::buffer(buffer_, MAX_BUFFER), boost::bind(&TcpSocket::readHandler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
-    socket_.async_read_some(boost::asio::buffer(buffer_, MAX_BUFFER), std::bind(&TcpSocket::readHandler, this, std::placeholders::_1, std::placeholders::_2));
+    client_id_ = socket_.native_handle();
+
+    // Status pushed by the worker is drained by an async_write chain on this socket's strand
+    weak_ptr<TcpSocket> weak_self = shared_from_this();
+    message_handler_.createClientQueue(client_id_, [weak_self] () {
+        if (auto self = weak_self.lock()) {
+            self->startWrite();
+        }
+    }, [weak_self] () {
+        // Slow consumer: closed on the strand, away from the publishing thread
+        if (auto self = weak_self.lock()) {
+            cout << "Client " << self->client_id_ << " does not keep up, disconnecting" << endl;
+            boost::asio::post(self->strand_, std::bind(&TcpSocket::close, self));
+        }
+    });
+
+    startRead();
 }
 
 void TcpSocket::close() {
+    if (closed_.exchange(true)) {
+        return;
+    }
+
     try {
-        message_handler_.deleteClientQueue(socket_.native_handle());
+        message_handler_.deleteClientQueue(client_id_);
         if (socket_.is_open()) {
             socket_.close();
         }
@@ -77,43 +101,59 @@ void TcpSocket::close() {
     }
 }
 
-void TcpSocket::writeHandler() {
-    while (socket_.is_open()) {
-        Json::Value json;
+void TcpSocket::startRead() {
+//    socket_.async_read_some(boost::asio::buffer(buffer_, MAX_BUFFER), boost::bind(&TcpSocket::readHandler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+    socket_.async_read_some(boost::asio::buffer(buffer_, MAX_BUFFER),
+                            boost::asio::bind_executor(strand_, std::bind(&TcpSocket::readHandler, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+}
 
-        if (message_handler_.tryPopFromClientQueue(socket_.native_handle(), json)) {
-            Json::FastWriter writer;
-            string data = writer.write(json);
-            boost::system::error_code error;
+void TcpSocket::startWrite() {
+    if (writing_.exchange(true)) {
+        return;
+    }
 
-            boost::asio::write(socket_, boost::asio::buffer(data, data.size()), error);
-            // boost::asio::write(socket_, boost::asio::buffer(data, 2048), error);
+    boost::asio::post(strand_, std::bind(&TcpSocket::writeNext, shared_from_this()));
+}
 
-            if (error) {
-                cout << "Write error: " << error.message() << endl;
-                socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-                close();
-            }
+void TcpSocket::writeNext() {
+    while (!message_handler_.tryPopFromClientQueue(client_id_, write_message_)) {
+        writing_.store(false);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        // A message pushed between the failed pop and the store above would otherwise be left unsent
+        if (message_handler_.isClientQueueEmpty(client_id_) || writing_.exchange(true)) {
+            return;
         }
-        usleep(1000);
     }
+
+    // The message is already serialised and shared with the other clients
+    boost::asio::async_write(socket_, boost::asio::buffer(*write_message_),
+                             boost::asio::bind_executor(strand_, std::bind(&TcpSocket::writeHandler, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
 }
 
-void TcpSocket::readHandler(const boost::system::error_code& err, size_t bytes_transferred) {
-    if (!err) {
-        recevied_ += string(buffer_, buffer_ + bytes_transferred);
+void TcpSocket::writeHandler(const boost::system::error_code& err, size_t /*bytes_transferred*/) {
+    // Hand the buffer back to the encoder's pool
+    write_message_.reset();
 
-        Json::Value json;
-        while (parseJsonFromBuffer(json)) {
-            Json::FastWriter writer;
-            string data = writer.write(json);
+    if (!err) {
+        writeNext();
+    } else {
+        boost::system::error_code error_temp = err;
+        cout << "Write error: " << err.message() << endl;
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error_temp);
+        close();
+    }
+}
 
-            message_handler_.pushToWorkerQueue(json);
+void TcpSocket::readHandler(const boost::system::error_code& err, size_t bytes_transferred) {
+    if (!err) {
+        if (format_ == WireFormat::BINARY) {
+            processBinary(buffer_, bytes_transferred);
+        } else {
+            processJson(buffer_, bytes_transferred);
         }
 
-        usleep(1000);
-//        socket_.async_read_some(boost::asio::buffer(buffer_, MAX_BUFFER), boost::bind(&TcpSocket::readHandler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
-        socket_.async_read_some(boost::asio::buffer(buffer_, MAX_BUFFER), std::bind(&TcpSocket::readHandler, this, std::placeholders::_1, std::placeholders::_2));
+        startRead();
     } else {
         boost::system::error_code error_temp = err;
         cout << "Read error: " << err.message() << endl;
@@ -122,27 +162,106 @@ void TcpSocket::readHandler(const boost::system::error_code& err, size_t bytes_t
     }
 }
 
-bool TcpSocket::parseJsonFromBuffer(Json::Value &json) {
-    string json_str;
-    size_t index = recevied_.find('{');
-    if (index == string::npos) {
-        recevied_.clear();
-        return false;
+void TcpSocket::processJson(const char *data, size_t size) {
+    framer_.append(data, size);
+
+    const char *frame_begin, *frame_end;
+    while (framer_.next(frame_begin, frame_end)) {
+        Json::Value json;
+        if (!json_reader_->parse(frame_begin, frame_end, &json, nullptr)) {
+            continue;
+        }
+
+        if (handleProtocolRequest(json)) {
+            if (format_ == WireFormat::BINARY) {
+                // Whatever followed the request in this chunk is already binary
+                processBinary(framer_.remainingData(), framer_.remainingSize());
+                framer_.reset();
+                return;
+            }
+            continue;
+        }
+
+        // Lets the worker answer a request to this client only
+        json["client_id"] = client_id_;
+        pushToWorker(json);
     }
-    recevied_.erase(0, index);
+}
 
-    index = recevied_.find('}');
-    if (index == string::npos) {
-        return false;
+void TcpSocket::processBinary(const char *data, size_t size) {
+    using namespace binary_protocol;
+
+    binary_framer_.append(data, size);
+
+    FrameType type;
+    const char *payload;
+    size_t payload_size;
+
+    while (binary_framer_.next(type, payload, payload_size)) {
+        Json::Value json;
+
+        if (type == FrameType::COMMAND && (payload_size == kCommandSize || payload_size == kRoutedCommandSize)) {
+            json["command"] = getU16(payload);
+            json["value_1"] = (int16_t) getU16(payload + 2);
+            json["value_2"] = getU16(payload + 4);
+
+            if (payload_size == kRoutedCommandSize) {
+                json["bus"]   = getU16(payload + 6);
+                json["slave"] = getU16(payload + 8);
+            }
+        } else if (type == FrameType::CHANGE_SLAVE && payload_size == kChangeSlaveSize) {
+            json["change_slave"] = getU16(payload);
+        } else {
+            cout << "Invalid binary frame (type " << (int) type << ")" << endl;
+            continue;
+        }
+
+        // Lets the worker answer a request to this client only
+        json["client_id"] = client_id_;
+        pushToWorker(json);
     }
+}
 
-    json_str = recevied_.substr(0, index + 1);
-    recevied_.erase(0, index + 1);
+void TcpSocket::pushToWorker(const Json::Value &json) {
+    if (message_handler_.pushToWorkerQueue(json)) {
+        return;
+    }
 
-    Json::Reader reader;
-    if (!reader.parse(json_str, json)) {
+    cout << "Worker queue full, message of client " << client_id_ << " dropped" << endl;
+
+    // The client may not assume the command was carried out
+    Json::Value reply;
+    reply["error"]["reason"] = "busy";
+    reply["error"]["dropped"] = (Json::UInt64) message_handler_.getWorkerQueueDropped();
+
+    for (const char *key : {"id", "command", "bus", "slave"}) {
+        if (json.isMember(key)) {
+            reply["error"][key] = json[key];
+        }
+    }
+
+    Json::FastWriter writer;
+    message_handler_.pushToClientQueue(client_id_, make_shared<const string>(writer.write(reply)));
+}
+
+bool TcpSocket::handleProtocolRequest(const Json::Value &json) {
+    if (!json.isMember("protocol")) {
         return false;
     }
 
+    const string protocol = json["protocol"].asString();
+
+    if (protocol == "binary") {
+        format_ = WireFormat::BINARY;
+    } else if (protocol == "json") {
+        format_ = WireFormat::JSON;
+    } else {
+        cout << "Unknown protocol: " << protocol << endl;
+        return true;
+    }
+
+    // The acknowledgement is the last message in the old format, status queued before it is dropped
+    message_handler_.switchClientFormat(client_id_, format_, make_shared<const string>("{\"protocol\":\"" + protocol + "\"}\n"));
+
     return true;
 }
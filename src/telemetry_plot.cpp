@@ -0,0 +1,220 @@
+/**
+ * @file telemetry_plot.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Implementation of the telemetry plot panel
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "telemetry_plot.hpp"
+
+#include <QLine>
+#include <QPainter>
+#include <QVector>
+
+#include <limits>
+#include <algorithm>
+
+const array<const char *, kTelemetryChannelNum> kChannelColors = {
+    "#E74C3C", // motor_pos
+    "#3498DB", // motor_vel
+    "#2ECC71", // motor_cur
+    "#9B59B6", // finger_pos
+    "#F39C12", // voltage
+};
+
+TelemetryPlot::TelemetryPlot(QWidget *parent) : QWidget(parent) {
+    timer_ = new QTimer(this);
+    connect(timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+    timer_->start(kPlotRefreshPeriod);
+}
+
+void TelemetryPlot::setRing(const TelemetryRing *ring) {
+    ring_ = ring;
+    rebuild();
+    update();
+}
+
+void TelemetryPlot::setWindow(uint64_t window_us) {
+    window_us_ = max(window_us, (uint64_t) 1000);
+    rebuild();
+    update();
+}
+
+void TelemetryPlot::setChannelVisible(TelemetryChannel channel, bool visible) {
+    visible_[(size_t) channel] = visible;
+    update();
+}
+
+void TelemetryPlot::setPaused(bool paused) {
+    paused_ = paused;
+}
+
+void TelemetryPlot::refresh() {
+    // Nothing is read while hidden, the backlog is rebuilt from the window once shown again
+    if (ring_ == nullptr || paused_ || !isVisible()) {
+        return;
+    }
+
+    const uint64_t read_index = read_index_;
+
+    if (ring_->getHead() - read_index_ > kPlotRebuildSamples) {
+        rebuild();
+    } else {
+        readNewSamples();
+    }
+
+    if (read_index_ != read_index) {
+        update();
+    }
+}
+
+void TelemetryPlot::rebuild() {
+    decimator_.reset(plotArea().width(), window_us_);
+
+    if (ring_ == nullptr) {
+        return;
+    }
+
+    // Only what fits the window is read, starting at its left edge
+    TelemetrySample latest;
+    const uint64_t head = ring_->getHead();
+
+    if (head == 0 || !ring_->at(head - 1, latest)) {
+        read_index_ = head;
+        return;
+    }
+
+    read_index_ = ring_->findTime((latest.timestamp_us > window_us_) ? latest.timestamp_us - window_us_ : 0);
+
+    readNewSamples();
+}
+
+void TelemetryPlot::readNewSamples() {
+    // In chunks, so the buffer stays small however long the backlog
+    const uint64_t head = ring_->getHead();
+
+    while (read_index_ < head) {
+        new_samples_.clear();
+        ring_->read(read_index_, new_samples_, kPlotRebuildSamples);
+
+        for (auto &sample : new_samples_) {
+            decimator_.addSample(sample);
+        }
+    }
+}
+
+QRect TelemetryPlot::plotArea() const {
+    return rect().adjusted(8, 8, -8, -20);
+}
+
+void TelemetryPlot::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+
+    // One column per pixel
+    rebuild();
+}
+
+void TelemetryPlot::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    const QRect area = plotArea();
+
+    painter.fillRect(rect(), QColor("#FFFFFF"));
+
+    painter.setPen(QColor("#DDDDDD"));
+    for (int i = 1; i < 4; i++) {
+        const int y = area.top() + area.height() * i / 4;
+        painter.drawLine(area.left(), y, area.right(), y);
+    }
+    painter.drawRect(area);
+
+    painter.setPen(QColor("#888888"));
+    painter.drawText(area.left(), rect().bottom() - 4, "-" + QString::number(window_us_ / 1e6, 'g', 3) + " s");
+    painter.drawText(QRect(area.left(), area.bottom(), area.width(), rect().bottom() - area.bottom()),
+                     Qt::AlignRight | Qt::AlignVCenter, "0 s");
+
+    if (decimator_.isEmpty()) {
+        return;
+    }
+
+    using Column = TelemetryDecimator::Column;
+
+    const int width = decimator_.getWidth();
+    const int max_gap = max((int) (kPlotMaxGapUs / decimator_.getSliceUs()), 1);
+    int legend_y = area.top() + 16;
+
+    QVector<QLine> lines;
+    lines.reserve(2 * width);
+
+    for (size_t channel = 0; channel < kTelemetryChannelNum; channel++) {
+        if (!visible_[channel]) {
+            continue;
+        }
+
+        // Scaled to what is visible of this channel
+        int32_t low  = numeric_limits<int32_t>::max();
+        int32_t high = numeric_limits<int32_t>::min();
+
+        for (int x = 0; x < width; x++) {
+            if (const Column *column = decimator_.column(x)) {
+                low  = min(low , column->min[channel]);
+                high = max(high, column->max[channel]);
+            }
+        }
+
+        if (low > high) {
+            continue;
+        }
+
+        const int32_t range_low  = (low == high) ? low  - 1 : low;
+        const int32_t range_high = (low == high) ? high + 1 : high;
+        const double scale = (area.height() - 1) / (double) (range_high - range_low);
+
+        auto yFn = [&] (int32_t value) {
+            return area.bottom() - (int) ((value - range_low) * scale);
+        };
+
+        lines.clear();
+
+        const Column *prev = nullptr;
+        int prev_x = 0;
+
+        for (int x = 0; x < width; x++) {
+            const Column *column = decimator_.column(x);
+
+            if (column == nullptr) {
+                continue;
+            }
+
+            int32_t column_low  = column->min[channel];
+            int32_t column_high = column->max[channel];
+
+            if (prev != nullptr && x - prev_x == 1) {
+                // Adjacent: the vertical line also covers the step from the previous column
+                column_low  = min(column_low , prev->last[channel]);
+                column_high = max(column_high, prev->last[channel]);
+            } else if (prev != nullptr && x - prev_x <= max_gap) {
+                lines.append(QLine(area.left() + prev_x, yFn(prev->last[channel]), area.left() + x, yFn(column->first[channel])));
+            }
+
+            lines.append(QLine(area.left() + x, yFn(column_low), area.left() + x, yFn(column_high)));
+
+            prev   = column;
+            prev_x = x;
+        }
+
+        const QColor color(kChannelColors[channel]);
+
+        painter.setPen(color);
+        painter.drawLines(lines);
+
+        const string_view name = kTelemetryChannelNames[channel];
+        painter.drawText(area.left() + 6, legend_y, QString::fromUtf8(name.data(), (int) name.size()) + "  " +
+                                                    QString::number(low) + " ~ " + QString::number(high));
+        legend_y += 16;
+    }
+}
@@ -0,0 +1,428 @@
+/**
+ * @file telemetry_recorder.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Implementation of the memory-mapped telemetry recorder
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "telemetry_recorder.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(WIN64) || defined(_WIN64) || defined(__WIN64__)
+#define RECORDER_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+uint64_t steadyTimeUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t unixTimeUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t pageSize() {
+#ifdef RECORDER_WINDOWS
+    return 4096;
+#else
+    static const uint64_t page_size = (uint64_t) sysconf(_SC_PAGESIZE);
+    return page_size;
+#endif
+}
+
+} // namespace
+
+TelemetryRecorder::~TelemetryRecorder() {
+    stop();
+}
+
+bool TelemetryRecorder::start(const RecorderConfig &config) {
+    stop();
+
+    config_ = config;
+    config_.segment_size = max(config_.segment_size, kRecorderSegmentMinSize);
+
+    error_code ec;
+    filesystem::create_directories(config_.directory, ec);
+
+    if (ec) {
+        printf("[Recorder] Failed to create %s: %s\n", config_.directory.c_str(), ec.message().c_str());
+        return false;
+    }
+
+    const time_t now = time(nullptr);
+    tm local = {};
+#ifdef RECORDER_WINDOWS
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+
+    file_prefix_ = (filesystem::path(config_.directory) /
+                    ("datc_bus" + to_string(config_.bus_id) + "_" + stamp)).string();
+
+    unique_ptr<Segment> segment = openSegment(0);
+
+    if (!segment) {
+        return false;
+    }
+
+    segment->start_time = chrono::steady_clock::now();
+    const string path   = segment->path;
+
+    {
+        lock_guard<mutex> lg(mutex_);
+
+        current_    = move(segment);
+        next_index_ = 1;
+        need_next_  = true;
+        stop_       = false;
+        records_    = 0;
+        dropped_    = 0;
+        segments_   = 1;
+        retired_.reserve(4);
+    }
+
+    flush_thread_ = std::thread(&TelemetryRecorder::flushLoop, this);
+
+    printf("[Recorder] Bus %d recording to %s\n", config_.bus_id, path.c_str());
+    return true;
+}
+
+void TelemetryRecorder::stop() {
+    {
+        lock_guard<mutex> lg(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_one();
+
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+
+    unique_ptr<Segment> current;
+    unique_ptr<Segment> next;
+    vector<unique_ptr<Segment>> retired;
+
+    {
+        lock_guard<mutex> lg(mutex_);
+
+        current = move(current_);
+        next    = move(next_);
+        retired.swap(retired_);
+    }
+
+    for (auto &segment : retired) {
+        closeSegment(*segment);
+    }
+
+    if (current) {
+        closeSegment(*current);
+        printf("[Recorder] Bus %d stopped, %llu records in %u segments, %llu dropped\n", config_.bus_id,
+               (unsigned long long) records_, segments_, (unsigned long long) dropped_);
+    }
+
+    // Prepared ahead but never written
+    if (next) {
+        closeSegment(*next, true);
+    }
+}
+
+RecorderStats TelemetryRecorder::getStats() {
+    lock_guard<mutex> lg(mutex_);
+
+    RecorderStats stats;
+
+    stats.records  = records_;
+    stats.dropped  = dropped_;
+    stats.segments = segments_;
+
+    if (current_) {
+        stats.file_name = filesystem::path(current_->path).filename().string();
+    }
+
+    return stats;
+}
+
+bool TelemetryRecorder::append(const void *record) {
+    lock_guard<mutex> lg(mutex_);
+
+    if (!current_) {
+        return false;
+    }
+
+    if (current_->count == current_->capacity && !rotate()) {
+        dropped_++;
+        return false;
+    }
+
+    memcpy(current_->records() + current_->count * kRecordSize, record, kRecordSize);
+    current_->count++;
+    records_++;
+
+    return true;
+}
+
+bool TelemetryRecorder::rotate() {
+    if (!need_next_) {
+        need_next_ = true;
+        cond_.notify_one();
+    }
+
+    if (!next_) {
+        return false;
+    }
+
+    next_->start_time = chrono::steady_clock::now();
+
+    retired_.push_back(move(current_));
+    current_ = move(next_);
+    segments_++;
+
+    return true;
+}
+
+void TelemetryRecorder::flushLoop() {
+    unique_lock<mutex> lk(mutex_);
+
+    while (true) {
+        cond_.wait_for(lk, kRecorderFlushInterval, [this] {return stop_ || need_next_ || !retired_.empty();});
+
+        if (stop_) {
+            break;
+        }
+
+        need_next_ = false;
+
+        if (chrono::steady_clock::now() - current_->start_time >= config_.segment_duration) {
+            rotate();
+        }
+
+        vector<unique_ptr<Segment>> retired;
+        retired.swap(retired_);
+        retired_.reserve(4);
+
+        // Only this thread closes segments, so current stays mapped while it is flushed unlocked
+        Segment *current     = current_.get();
+        const uint64_t count = current->count;
+        const bool prepare   = !next_;
+
+        lk.unlock();
+
+        for (auto &segment : retired) {
+            closeSegment(*segment);
+        }
+
+        flushSegment(*current, count);
+
+        unique_ptr<Segment> segment = prepare ? openSegment(next_index_++) : nullptr;
+
+        lk.lock();
+
+        if (segment) {
+            next_ = move(segment);
+        }
+    }
+}
+
+unique_ptr<TelemetryRecorder::Segment> TelemetryRecorder::openSegment(uint32_t index) {
+    auto segment = make_unique<Segment>();
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%04u.bin", index);
+    segment->path = file_prefix_ + suffix;
+
+    segment->capacity = (config_.segment_size - sizeof(RecorderFileHeader)) / kRecordSize;
+
+    if (!mapFile(segment->path, sizeof(RecorderFileHeader) + segment->capacity * kRecordSize, segment->file)) {
+        printf("[Recorder] Failed to create %s\n", segment->path.c_str());
+        return nullptr;
+    }
+
+    // The file is zero-filled, so only the set fields are written
+    RecorderFileHeader *header = segment->header();
+
+    memcpy(header->magic, kRecorderMagic, sizeof(header->magic));
+    header->version        = kRecorderVersion;
+    header->header_size    = sizeof(RecorderFileHeader);
+    header->record_size    = kRecordSize;
+    header->bus_id         = config_.bus_id;
+    header->baudrate       = config_.baudrate;
+    header->segment_index  = index;
+    header->unix_time_us   = unixTimeUs();
+    header->steady_time_us = steadyTimeUs();
+    header->selected_slave = config_.selected_slave;
+    header->poll_slave_num = (uint16_t) min(config_.poll_slaves.size(), kRecorderMaxSlaves);
+
+    strncpy(header->port_name, config_.port_name.c_str(), kRecorderPortNameSize - 1);
+    copy_n(config_.poll_slaves.begin(), header->poll_slave_num, header->poll_slaves);
+
+    return segment;
+}
+
+void TelemetryRecorder::closeSegment(Segment &segment, bool remove_file) {
+    if (remove_file) {
+        unmapFile(segment.file, 0);
+
+        error_code ec;
+        filesystem::remove(segment.path, ec);
+        return;
+    }
+
+    segment.header()->record_count = segment.count;
+
+    unmapFile(segment.file, sizeof(RecorderFileHeader) + segment.count * kRecordSize);
+}
+
+void TelemetryRecorder::flushSegment(Segment &segment, uint64_t count) {
+    // Whole pages only, the page being appended to is left alone until it is full
+    const uint64_t end = (sizeof(RecorderFileHeader) + count * kRecordSize) / pageSize() * pageSize();
+
+    if (end > segment.flushed) {
+        flushFile(segment.file, segment.flushed, end - segment.flushed, false);
+        segment.flushed = end;
+    }
+}
+
+#ifdef RECORDER_WINDOWS
+
+bool TelemetryRecorder::mapFile(const string &path, uint64_t size, MappedFile &file) {
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    // Extends the file to size
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, (DWORD) (size >> 32),
+                                        (DWORD) (size & 0xFFFFFFFF), nullptr);
+    void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T) size) : nullptr;
+
+    if (!base) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(handle);
+        DeleteFileA(path.c_str());
+        return false;
+    }
+
+    file.file    = handle;
+    file.mapping = mapping;
+    file.base    = (uint8_t *) base;
+    file.size    = size;
+
+    return true;
+}
+
+void TelemetryRecorder::flushFile(MappedFile &file, uint64_t offset, uint64_t length, bool wait) {
+    FlushViewOfFile(file.base + offset, (SIZE_T) length);
+
+    if (wait) {
+        FlushFileBuffers((HANDLE) file.file);
+    }
+}
+
+void TelemetryRecorder::unmapFile(MappedFile &file, uint64_t truncate_size) {
+    flushFile(file, 0, file.size, true);
+
+    UnmapViewOfFile(file.base);
+    CloseHandle((HANDLE) file.mapping);
+
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG) truncate_size;
+
+    SetFilePointerEx((HANDLE) file.file, end, nullptr, FILE_BEGIN);
+    SetEndOfFile((HANDLE) file.file);
+    CloseHandle((HANDLE) file.file);
+
+    file = MappedFile();
+}
+
+#else
+
+bool TelemetryRecorder::mapFile(const string &path, uint64_t size, MappedFile &file) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    // Blocks are reserved here, so a full disk fails this call instead of a later write through the mapping
+#ifdef __linux__
+    bool allocated = (posix_fallocate(fd, 0, (off_t) size) == 0);
+#else
+    bool allocated = (ftruncate(fd, (off_t) size) == 0);
+#endif
+
+    void *base = allocated ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if (base == MAP_FAILED) {
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+
+    // Pages are faulted in writable here, on the background thread, instead of one fault every
+    // 128 records on the poll thread. Kernels before 5.14 reject it and fault on first write.
+#ifdef MADV_POPULATE_WRITE
+    madvise(base, size, MADV_POPULATE_WRITE);
+#endif
+
+    file.fd   = fd;
+    file.base = (uint8_t *) base;
+    file.size = size;
+
+    return true;
+}
+
+void TelemetryRecorder::flushFile(MappedFile &file, uint64_t offset, uint64_t length, bool wait) {
+#ifdef __linux__
+    // MS_ASYNC does not start any writeback on Linux
+    if (!wait) {
+        sync_file_range(file.fd, (off64_t) offset, (off64_t) length, SYNC_FILE_RANGE_WRITE);
+        return;
+    }
+#endif
+
+    msync(file.base + offset, length, wait ? MS_SYNC : MS_ASYNC);
+}
+
+void TelemetryRecorder::unmapFile(MappedFile &file, uint64_t truncate_size) {
+    flushFile(file, 0, file.size, true);
+
+    munmap(file.base, file.size);
+
+    if (ftruncate(file.fd, (off_t) truncate_size) != 0) {
+        printf("[Recorder] Failed to truncate a segment to %llu bytes\n", (unsigned long long) truncate_size);
+    }
+
+    close(file.fd);
+
+    file = MappedFile();
+}
+
+#endif
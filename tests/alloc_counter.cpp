@@ -0,0 +1,57 @@
+/**
+ * @file alloc_counter.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Global operator new and delete counting the allocations per thread
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "alloc_counter.hpp"
+
+#include <new>
+#include <cstdlib>
+
+namespace {
+
+thread_local uint64_t thread_allocations = 0;
+
+void *allocate(size_t size) {
+    thread_allocations++;
+
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+uint64_t threadAllocations() {
+    return thread_allocations;
+}
+
+void *operator new(size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
@@ -0,0 +1,23 @@
+/**
+ * @file alloc_counter.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Counts the heap allocations of the calling thread
+ * @details alloc_counter.cpp replaces the global operator new, so every target linking it counts
+ * all allocations made through new, make_shared, std::string, std::vector, ...
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <cstdint>
+
+/**
+ * @brief Allocations made by this thread since it started.
+ */
+uint64_t threadAllocations();
+
+#endif // ALLOC_COUNTER_HPP
@@ -0,0 +1,137 @@
+/**
+ * @file bench_binary_protocol.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Encode and decode of status and command messages, binary frames against jsoncpp
+ * @details Status: encoded by the server, framed and decoded to its fields as a client would.
+ * Command: framed and decoded by the server as TcpSocket::processJson and processBinary do.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include "json_framer.hpp"
+#include "status_encoder.hpp"
+
+using namespace tcp_communication::binary_protocol;
+
+namespace {
+
+DatcStatus benchStatus() {
+    DatcStatus status;
+
+    status.motor_pos  = 1234;
+    status.motor_cur  = -56;
+    status.motor_vel  = 789;
+    status.finger_pos = 5000;
+    status.voltage    = 240;
+    status.states     = 0x0061;
+
+    return status;
+}
+
+void BM_StatusJsonRoundTrip(benchmark::State &state) {
+    const DatcStatus status = benchStatus();
+    StatusEncoder encoder;
+    JsonFramer framer;
+
+    Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value json;
+    int64_t sum = 0;
+
+    for (auto _ : state) {
+        OutboundMessage message = encoder.encodeJson(status, true, 1, 1);
+        framer.append(message->data(), message->size());
+
+        const char *begin, *end;
+        while (framer.next(begin, end)) {
+            reader->parse(begin, end, &json, nullptr);
+            sum += json["finger_pos"].asInt() + json["motor_pos"].asInt() + json["states"].asInt();
+        }
+        state.counters["bytes_per_msg"] = (double) message->size();
+    }
+
+    benchmark::DoNotOptimize(sum);
+}
+
+void BM_StatusBinaryRoundTrip(benchmark::State &state) {
+    const DatcStatus status = benchStatus();
+    StatusEncoder encoder;
+    BinaryFramer framer;
+
+    FrameType type;
+    const char *payload;
+    size_t payload_size;
+    uint32_t seq = 0;
+    int64_t sum  = 0;
+
+    for (auto _ : state) {
+        OutboundMessage message = encoder.encodeBinary(status, 1, 1, seq++, 0);
+        framer.append(message->data(), message->size());
+
+        while (framer.next(type, payload, payload_size)) {
+            sum += getU16(payload + 20) + (int16_t) getU16(payload + 14) + getU16(payload + 12);
+        }
+        state.counters["bytes_per_msg"] = (double) message->size();
+    }
+
+    benchmark::DoNotOptimize(sum);
+}
+
+void BM_CommandJsonDecode(benchmark::State &state) {
+    const string command = "{\"command\":104,\"value_1\":500,\"value_2\":0,\"bus\":1,\"slave\":2}";
+    JsonFramer framer;
+
+    Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value json;
+    int64_t sum = 0;
+
+    for (auto _ : state) {
+        framer.append(command.data(), command.size());
+
+        const char *begin, *end;
+        while (framer.next(begin, end)) {
+            reader->parse(begin, end, &json, nullptr);
+            sum += json["command"].asInt() + json["value_1"].asInt() + json["slave"].asInt();
+        }
+    }
+
+    benchmark::DoNotOptimize(sum);
+}
+
+void BM_CommandBinaryDecode(benchmark::State &state) {
+    string command(kHeaderSize + kRoutedCommandSize, '\0');
+    putHeader(&command[0], FrameType::COMMAND, kRoutedCommandSize);
+    putU16(&command[4], 104);
+    putU16(&command[6], 500);
+    putU16(&command[8], 0);
+    putU16(&command[10], 1);
+    putU16(&command[12], 2);
+
+    BinaryFramer framer;
+    FrameType type;
+    const char *payload;
+    size_t payload_size;
+    int64_t sum = 0;
+
+    for (auto _ : state) {
+        framer.append(command.data(), command.size());
+
+        while (framer.next(type, payload, payload_size)) {
+            sum += getU16(payload) + (int16_t) getU16(payload + 2) + getU16(payload + 8);
+        }
+    }
+
+    benchmark::DoNotOptimize(sum);
+}
+
+} // namespace
+
+BENCHMARK(BM_StatusJsonRoundTrip);
+BENCHMARK(BM_StatusBinaryRoundTrip);
+BENCHMARK(BM_CommandJsonDecode);
+BENCHMARK(BM_CommandBinaryDecode);
@@ -0,0 +1,98 @@
+/**
+ * @file bench_command_dispatch.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Latency from a loopback TCP client to the command worker
+ * @details Each iteration sends one Json command to a TcpServer and waits until it comes out of
+ * the worker queue, as DatcCommInterface::recvCommand does. The "poll" variant is the former
+ * sleep-poll loop (tryPop, then sleep 10 ms) for comparison.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include "tcp_manager.hpp"
+
+namespace {
+
+const int kBenchPort = 18421;
+
+void setLatencyCounters(benchmark::State &state, vector<double> &latency_us) {
+    if (latency_us.empty()) {
+        return;
+    }
+
+    sort(latency_us.begin(), latency_us.end());
+
+    auto percentile = [&] (double p) {
+        return latency_us[min(latency_us.size() - 1, (size_t) (p * latency_us.size()))];
+    };
+
+    state.counters["p50_us"] = percentile(0.50);
+    state.counters["p90_us"] = percentile(0.90);
+    state.counters["p99_us"] = percentile(0.99);
+    state.counters["max_us"] = latency_us.back();
+
+    // Share of commands per latency bucket
+    const double limits[] = {25, 50, 100, 250, 1000, 10000};
+    const char *names[]   = {"le_25us", "le_50us", "le_100us", "le_250us", "le_1ms", "le_10ms"};
+
+    for (size_t i = 0; i < 6; i++) {
+        const size_t count = upper_bound(latency_us.begin(), latency_us.end(), limits[i]) - latency_us.begin();
+        state.counters[names[i]] = (double) count / latency_us.size();
+    }
+}
+
+void BM_TcpToWorker(benchmark::State &state) {
+    const bool poll = (state.range(0) == 1);
+
+    TcpServer server(kBenchPort, 1);
+    auto &manager = MessageManager<Json::Value>::getInstance();
+
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::socket client(io_service);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), kBenchPort));
+    client.set_option(boost::asio::ip::tcp::no_delay(true));
+
+    const string command = "{\"command\":104,\"value_1\":500,\"value_2\":0}";
+    Json::Value json;
+
+    auto receive = [&] () {
+        if (!poll) {
+            while (!manager.waitPopFromWorkerQueue(json, chrono::seconds(1))) {}
+            return;
+        }
+
+        while (!manager.tryPopFromWokerQueue(json)) {
+            usleep(10000);
+        }
+    };
+
+    // The first command also waits for the accept
+    boost::asio::write(client, boost::asio::buffer(command));
+    receive();
+
+    vector<double> latency_us;
+    latency_us.reserve(100000);
+
+    for (auto _ : state) {
+        const auto start = chrono::steady_clock::now();
+
+        boost::asio::write(client, boost::asio::buffer(command));
+        receive();
+
+        latency_us.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+    }
+
+    setLatencyCounters(state, latency_us);
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_TcpToWorker)->ArgName("poll")->Arg(0)->UseRealTime();
+BENCHMARK(BM_TcpToWorker)->ArgName("poll")->Arg(1)->Iterations(200)->UseRealTime();
@@ -0,0 +1,98 @@
+/**
+ * @file bench_json_framer.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief JsonFramer on 1 MB of concatenated commands delivered in random chunk sizes
+ * @details The chunk sizes (1 to MAX_BUFFER bytes, as async_read_some delivers them) are drawn once
+ * with a fixed seed. "parse" also runs every frame through one reused Json::CharReader, as
+ * TcpSocket::processJson does.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <jsoncpp/json/json.h>
+
+#include "json_framer.hpp"
+
+using namespace tcp_communication;
+
+namespace {
+
+const size_t kStreamSize = 1 << 20;
+const size_t kMaxChunk   = 1024;
+
+struct Stream {
+    string data;
+    vector<size_t> chunks;
+    size_t frames = 0;
+};
+
+const Stream &stream() {
+    static const Stream stream = [] () {
+        Stream s;
+        mt19937 rng(42);
+
+        for (int i = 0; s.data.size() < kStreamSize; i++) {
+            s.data += "{\"command\":104,\"value_1\":" + to_string(i % 1000) + ",\"value_2\":0,\"bus\":1,\"slave\":" +
+                      to_string(1 + i % 16) + "}\n";
+            s.frames++;
+        }
+
+        uniform_int_distribution<size_t> chunk_size(1, kMaxChunk);
+        for (size_t pos = 0; pos < s.data.size();) {
+            const size_t size = min(chunk_size(rng), s.data.size() - pos);
+            s.chunks.push_back(size);
+            pos += size;
+        }
+        return s;
+    }();
+
+    return stream;
+}
+
+void BM_JsonFramer(benchmark::State &state) {
+    const bool parse = (state.range(0) == 1);
+    const Stream &s  = stream();
+
+    Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value json;
+
+    for (auto _ : state) {
+        JsonFramer framer;
+        const char *data = s.data.data();
+        size_t frames = 0;
+
+        for (size_t size : s.chunks) {
+            framer.append(data, size);
+            data += size;
+
+            const char *begin, *end;
+            while (framer.next(begin, end)) {
+                if (parse) {
+                    reader->parse(begin, end, &json, nullptr);
+                }
+                frames++;
+            }
+        }
+
+        if (frames != s.frames) {
+            state.SkipWithError("Frames lost");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * s.data.size());
+    state.SetItemsProcessed(state.iterations() * s.frames);
+}
+
+} // namespace
+
+BENCHMARK(BM_JsonFramer)->ArgName("parse")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
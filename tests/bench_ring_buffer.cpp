@@ -0,0 +1,102 @@
+/**
+ * @file bench_ring_buffer.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief ConcurrentQueue against a mutex-guarded std::queue at 1, 4 and 16 producers
+ * @details Every iteration moves kItems shared messages from the producers to one consumer, the
+ * shape of the client queues (many publishers, one writer per socket).
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_queue.hpp"
+
+using namespace tcp_communication;
+
+namespace {
+
+const size_t kItems = 100000;
+
+using Message = shared_ptr<const string>;
+
+class MutexQueue {
+public:
+    bool tryPush(Message const &data) {
+        lock_guard<mutex> lg(mutex_);
+        queue_.push(data);
+        return true;
+    }
+
+    bool tryPop(Message &value) {
+        lock_guard<mutex> lg(mutex_);
+        if (queue_.empty()) {
+            return false;
+        }
+        value = move(queue_.front());
+        queue_.pop();
+        return true;
+    }
+
+private:
+    mutex mutex_;
+    queue<Message> queue_;
+};
+
+class RingQueue {
+public:
+    bool tryPush(Message const &data) {return queue_.push(data);}
+    bool tryPop(Message &value) {return queue_.tryPop(value);}
+
+private:
+    ConcurrentQueue<Message> queue_ {1024};
+};
+
+template<typename Queue>
+void BM_Producers(benchmark::State &state) {
+    const size_t producer_num = (size_t) state.range(0);
+    const auto message = make_shared<const string>(256, 'x');
+
+    for (auto _ : state) {
+        Queue queue;
+        vector<std::thread> producers;
+
+        for (size_t p = 0; p < producer_num; p++) {
+            producers.emplace_back([&, p] () {
+                const size_t count = kItems / producer_num + (p < kItems % producer_num ? 1 : 0);
+                for (size_t i = 0; i < count; i++) {
+                    while (!queue.tryPush(message)) {
+                        this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        Message value;
+        for (size_t received = 0; received < kItems;) {
+            if (queue.tryPop(value)) {
+                received++;
+            } else {
+                this_thread::yield();
+            }
+        }
+
+        for (auto &producer : producers) {
+            producer.join();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kItems);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_Producers, MutexQueue)->ArgName("producers")->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Producers, RingQueue)->ArgName("producers")->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
@@ -0,0 +1,94 @@
+/**
+ * @file bench_status_encoder.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Status serialisation per poll cycle: StatusEncoder against Json::Value and FastWriter
+ * @details allocs_per_op counts the heap allocations of one serialisation, taken from the global
+ * operator new (alloc_counter.cpp).
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include "alloc_counter.hpp"
+#include "status_encoder.hpp"
+
+namespace {
+
+DatcStatus benchStatus() {
+    DatcStatus status;
+
+    status.motor_pos  = 1234;
+    status.motor_cur  = -56;
+    status.motor_vel  = 789;
+    status.finger_pos = 5000;
+    status.voltage    = 240;
+    status.states     = 0x0061;
+
+    return status;
+}
+
+void setAllocCounter(benchmark::State &state, uint64_t allocations) {
+    state.counters["allocs_per_op"] = (double) allocations / state.iterations();
+}
+
+void BM_StatusFastWriter(benchmark::State &state) {
+    const DatcStatus status = benchStatus();
+    const uint64_t before   = threadAllocations();
+
+    for (auto _ : state) {
+        Json::Value json;
+
+        json["finger_pos"] = status.finger_pos;
+        json["motor_cur"]  = status.motor_cur;
+        json["motor_pos"]  = status.motor_pos;
+        json["motor_vel"]  = status.motor_vel;
+        json["states"]     = status.states;
+        json["voltage"]    = status.voltage;
+
+        Json::FastWriter writer;
+        auto message = make_shared<const string>(writer.write(json));
+        benchmark::DoNotOptimize(message);
+    }
+
+    setAllocCounter(state, threadAllocations() - before);
+}
+
+void BM_StatusEncoderJson(benchmark::State &state) {
+    const DatcStatus status = benchStatus();
+    StatusEncoder encoder;
+
+    benchmark::DoNotOptimize(encoder.encodeJson(status));
+    const uint64_t before = threadAllocations();
+
+    for (auto _ : state) {
+        auto message = encoder.encodeJson(status);
+        benchmark::DoNotOptimize(message);
+    }
+
+    setAllocCounter(state, threadAllocations() - before);
+}
+
+void BM_StatusEncoderBinary(benchmark::State &state) {
+    const DatcStatus status = benchStatus();
+    StatusEncoder encoder;
+
+    benchmark::DoNotOptimize(encoder.encodeBinary(status, 1, 1, 0, 0));
+    const uint64_t before = threadAllocations();
+    uint32_t seq = 0;
+
+    for (auto _ : state) {
+        auto message = encoder.encodeBinary(status, 1, 1, seq++, 0);
+        benchmark::DoNotOptimize(message);
+    }
+
+    setAllocCounter(state, threadAllocations() - before);
+}
+
+} // namespace
+
+BENCHMARK(BM_StatusFastWriter);
+BENCHMARK(BM_StatusEncoderJson);
+BENCHMARK(BM_StatusEncoderBinary);
@@ -0,0 +1,76 @@
+/**
+ * @file bench_tcp_server.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Command ingestion rate of TcpServer against the number of io threads
+ * @details Every iteration, 16 loopback clients each send a burst of Json commands and the bench
+ * thread takes them all from the worker queue. A burst stays below kWorkerQueueCapacity so that
+ * nothing is dropped.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include "tcp_manager.hpp"
+
+namespace {
+
+const int kBenchPort           = 18423;
+const size_t kClients          = 16;
+const size_t kCommandsPerBurst = 50;
+
+void BM_CommandIngest(benchmark::State &state) {
+    auto &manager = MessageManager<Json::Value>::getInstance();
+    TcpServer server(kBenchPort, (size_t) state.range(0));
+
+    boost::asio::io_service io_service;
+    vector<unique_ptr<boost::asio::ip::tcp::socket>> clients;
+    const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), kBenchPort);
+
+    string burst;
+    for (size_t i = 0; i < kCommandsPerBurst; i++) {
+        burst += "{\"command\":104,\"value_1\":" + to_string(i) + ",\"value_2\":0,\"slave\":1}";
+    }
+
+    for (size_t i = 0; i < kClients; i++) {
+        clients.push_back(make_unique<boost::asio::ip::tcp::socket>(io_service));
+        clients.back()->connect(endpoint);
+    }
+
+    while (manager.getAllClientId().size() < kClients) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    Json::Value json;
+    size_t lost = 0;
+
+    for (auto _ : state) {
+        for (auto &client : clients) {
+            boost::asio::write(*client, boost::asio::buffer(burst));
+        }
+
+        for (size_t received = 0; received < kClients * kCommandsPerBurst; received++) {
+            if (!manager.waitPopFromWorkerQueue(json, chrono::seconds(1))) {
+                lost += kClients * kCommandsPerBurst - received;
+                break;
+            }
+        }
+    }
+
+    for (auto &client : clients) {
+        client->close();
+    }
+
+    while (!manager.getAllClientId().empty()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    state.counters["lost"] = (double) lost;
+    state.SetItemsProcessed(state.iterations() * kClients * kCommandsPerBurst);
+}
+
+} // namespace
+
+BENCHMARK(BM_CommandIngest)->ArgName("io_threads")->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
@@ -0,0 +1,81 @@
+/**
+ * @file bench_telemetry_decimator.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Telemetry plot cost: folding samples into columns, and one repaint pass over the columns
+ * @details The repaint pass is run after minutes of 500 Hz history of different lengths; its
+ * time should not grow with the history.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include "alloc_counter.hpp"
+#include "telemetry_decimator.hpp"
+
+namespace {
+
+const int kPlotWidth      = 1200;
+const uint64_t kSampleUs  = 2000; // 500 Hz
+const uint64_t kWindowUs  = 60000000;
+
+TelemetrySample benchSample(uint64_t timestamp_us) {
+    TelemetrySample sample;
+    sample.timestamp_us = timestamp_us;
+    for (size_t channel = 0; channel < kTelemetryChannelNum; channel++) {
+        sample.values[channel] = (int32_t) ((timestamp_us / kSampleUs * (channel + 7)) % 4096);
+    }
+    return sample;
+}
+
+void BM_DecimatorAddSample(benchmark::State &state) {
+    TelemetryDecimator decimator;
+    decimator.reset(kPlotWidth, kWindowUs);
+
+    uint64_t timestamp_us = 0;
+    const uint64_t before = threadAllocations();
+
+    for (auto _ : state) {
+        decimator.addSample(benchSample(timestamp_us));
+        timestamp_us += kSampleUs;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_op"] = (double) (threadAllocations() - before) / state.iterations();
+}
+
+/**
+ * @brief What paintEvent() reads per channel: the visible range, then every column.
+ */
+void BM_DecimatorRepaintPass(benchmark::State &state) {
+    const uint64_t history_us = (uint64_t) state.range(0) * 1000000;
+
+    TelemetryDecimator decimator;
+    decimator.reset(kPlotWidth, kWindowUs);
+
+    for (uint64_t t = 0; t < history_us; t += kSampleUs) {
+        decimator.addSample(benchSample(t));
+    }
+
+    for (auto _ : state) {
+        int64_t sum = 0;
+
+        for (size_t channel = 0; channel < kTelemetryChannelNum; channel++) {
+            for (int x = 0; x < decimator.getWidth(); x++) {
+                if (const auto *column = decimator.column(x)) {
+                    sum += column->max[channel] - column->min[channel];
+                }
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.counters["history_samples"] = (double) (history_us / kSampleUs);
+}
+
+} // namespace
+
+BENCHMARK(BM_DecimatorAddSample);
+BENCHMARK(BM_DecimatorRepaintPass)->Arg(60)->Arg(300)->Arg(600);
@@ -0,0 +1,78 @@
+/**
+ * @file bench_telemetry_recorder.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Cost of one TelemetryRecorder append on the poll thread, segment rotation included
+ * @details 500 Hz x 16 slaves is 8000 appends per second, so the poll loop overhead is 8000 divided
+ * by items_per_second. Appending flat out fills segments faster than the next one can be prepared;
+ * that wait is not timed and shows in rotation_waits instead. Segments are written to a directory
+ * under the system temp path.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <filesystem>
+
+#include "alloc_counter.hpp"
+#include "telemetry_recorder.hpp"
+
+namespace {
+
+void BM_RecorderAppendStatus(benchmark::State &state) {
+    const string directory = (filesystem::temp_directory_path() / "datc_recorder_bench").string();
+    filesystem::remove_all(directory);
+
+    RecorderConfig config;
+    config.directory    = directory;
+    config.port_name    = "/dev/ttyUSB0";
+    config.baudrate     = 115200;
+    config.segment_size = (uint64_t) state.range(0) << 20;
+
+    TelemetryRecorder recorder;
+    if (!recorder.start(config)) {
+        state.SkipWithError("Failed to start the recorder");
+        return;
+    }
+
+    StatusRecord record = {};
+    record.type = RecordType::STATUS;
+
+    uint64_t rotation_waits = 0;
+    const uint64_t before   = threadAllocations();
+
+    for (auto _ : state) {
+        record.timestamp_us += 125;
+        record.slave_addr = (uint16_t) (1 + record.seq % kRecorderMaxSlaves);
+        record.seq++;
+
+        if (!recorder.append(record)) {
+            state.PauseTiming();
+            rotation_waits++;
+
+            while (!recorder.append(record)) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            state.ResumeTiming();
+        }
+    }
+
+    const uint64_t allocations = threadAllocations() - before;
+    const RecorderStats stats  = recorder.getStats();
+
+    recorder.stop();
+    filesystem::remove_all(directory);
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_op"]  = (double) allocations / state.iterations();
+    state.counters["segments"]       = stats.segments;
+    state.counters["rotation_waits"] = (double) rotation_waits;
+}
+
+} // namespace
+
+// Default segment size, and a small one that rotates every 32k records
+BENCHMARK(BM_RecorderAppendStatus)->Arg(64)->Arg(1);
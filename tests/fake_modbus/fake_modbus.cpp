@@ -0,0 +1,282 @@
+/**
+ * @file fake_modbus.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief libmodbus functions served by the simulated bus of fake_modbus.hpp
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "fake_modbus.hpp"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <algorithm>
+
+#include <modbus/modbus-rtu.h>
+
+struct _modbus {
+    int slave = 0;
+    uint32_t response_timeout_us = 500000;
+};
+
+namespace fake_modbus {
+
+namespace {
+
+// Status register bits (see kStatusBits)
+const uint16_t kEnableBit = 1 << 0;
+const uint16_t kOpenBit   = 1 << 5;
+const uint16_t kCloseBit  = 1 << 6;
+const uint16_t kFaultBit  = 1 << 9;
+
+const uint16_t kStatusRegNum = 8;
+
+struct Bus {
+    std::mutex mutex;
+    std::map<uint16_t, SlaveState> slaves;
+    std::vector<Operation> operations;
+
+    std::chrono::microseconds read_time {0};
+    std::chrono::microseconds write_time {0};
+    bool combined_supported = true;
+    bool log_operations     = true;
+};
+
+Bus &bus() {
+    static Bus bus;
+    return bus;
+}
+
+void writeCommand(SlaveState &slave, const uint16_t *values, int nb) {
+    slave.command = values[0];
+
+    switch (slave.command) {
+        case 102: slave.target = kOpenPos; break;
+        case 103: slave.target = kClosePos; break;
+        case 104: slave.target = (nb > 1) ? values[1] : slave.target; break;
+        default: break;
+    }
+}
+
+void readStatus(SlaveState &slave, int nb, uint16_t *dest) {
+    if (slave.finger_pos < slave.target) {
+        slave.finger_pos = (uint16_t) std::min<int>(slave.target, slave.finger_pos + slave.step);
+    } else {
+        slave.finger_pos = (uint16_t) std::max<int>(slave.target, slave.finger_pos - slave.step);
+    }
+    slave.reads++;
+
+    const bool reached = (slave.finger_pos == slave.target);
+
+    uint16_t regs[kStatusRegNum] = {};
+    regs[0] = kEnableBit | (slave.fault ? kFaultBit : 0) |
+              ((slave.command == 102 && reached) ? kOpenBit : 0) |
+              ((slave.command == 103 && reached) ? kCloseBit : 0);
+    regs[4] = slave.finger_pos;
+    regs[7] = 240;
+
+    std::copy_n(regs, std::min<int>(nb, kStatusRegNum), dest);
+}
+
+/**
+ * @brief Runs one transaction: waits the wire time (or the response timeout without slave), then
+ * applies it to the slave and logs it.
+ */
+template<typename ApplyFn>
+int transact(modbus_t *ctx, OperationKind kind, const uint16_t *values, int write_nb, int result, ApplyFn &&apply) {
+    Bus &b = bus();
+    std::chrono::microseconds wait;
+    bool present;
+
+    {
+        std::lock_guard<std::mutex> lg(b.mutex);
+        present = (b.slaves.count((uint16_t) ctx->slave) > 0);
+        wait    = !present ? std::chrono::microseconds(ctx->response_timeout_us)
+                           : (kind == OperationKind::READ ? b.read_time : b.write_time);
+    }
+
+    if (wait.count() > 0) {
+        std::this_thread::sleep_for(wait);
+    }
+
+    std::lock_guard<std::mutex> lg(b.mutex);
+
+    auto itr = b.slaves.find((uint16_t) ctx->slave);
+    present  = (itr != b.slaves.end());
+
+    if (b.log_operations) {
+        b.operations.push_back({kind, (uint16_t) ctx->slave, std::vector<uint16_t>(values, values + write_nb), present});
+    }
+
+    if (!present) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    if (!apply(itr->second)) {
+        return -1;
+    }
+    return result;
+}
+
+} // namespace
+
+void reset() {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+
+    b.slaves.clear();
+    b.operations.clear();
+    b.read_time  = std::chrono::microseconds(0);
+    b.write_time = std::chrono::microseconds(0);
+    b.combined_supported = true;
+    b.log_operations     = true;
+}
+
+void addSlave(uint16_t slave, uint16_t finger_pos) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+
+    SlaveState state;
+    state.finger_pos = finger_pos;
+    state.target     = finger_pos;
+    b.slaves[slave]  = state;
+}
+
+void removeSlave(uint16_t slave) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    b.slaves.erase(slave);
+}
+
+void setFingerStep(uint16_t slave, uint16_t step) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    b.slaves[slave].step = step;
+}
+
+void setFault(uint16_t slave, bool fault) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    b.slaves[slave].fault = fault;
+}
+
+SlaveState getSlave(uint16_t slave) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+
+    auto itr = b.slaves.find(slave);
+    return (itr != b.slaves.end()) ? itr->second : SlaveState();
+}
+
+void setTransactionTime(std::chrono::microseconds read_time, std::chrono::microseconds write_time) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+
+    b.read_time  = read_time;
+    b.write_time = write_time;
+}
+
+void setCombinedSupported(bool supported) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    b.combined_supported = supported;
+}
+
+std::vector<Operation> operations() {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    return b.operations;
+}
+
+void clearOperations() {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    b.operations.clear();
+}
+
+void setLogOperations(bool log) {
+    Bus &b = bus();
+    std::lock_guard<std::mutex> lg(b.mutex);
+    b.log_operations = log;
+}
+
+} // namespace fake_modbus
+
+using namespace fake_modbus;
+
+extern "C" {
+
+modbus_t *modbus_new_rtu(const char *, int, char, int, int) {
+    return new _modbus();
+}
+
+int modbus_rtu_set_serial_mode(modbus_t *, int) {return 0;}
+int modbus_rtu_set_rts_delay(modbus_t *, int) {return 0;}
+int modbus_set_debug(modbus_t *, int) {return 0;}
+
+int modbus_set_slave(modbus_t *ctx, int slave) {
+    if (slave < 0 || slave > 247) {
+        errno = EINVAL;
+        return -1;
+    }
+    ctx->slave = slave;
+    return 0;
+}
+
+int modbus_set_response_timeout(modbus_t *ctx, uint32_t to_sec, uint32_t to_usec) {
+    ctx->response_timeout_us = to_sec * 1000000 + to_usec;
+    return 0;
+}
+
+int modbus_set_byte_timeout(modbus_t *, uint32_t, uint32_t) {return 0;}
+int modbus_connect(modbus_t *) {return 0;}
+void modbus_close(modbus_t *) {}
+
+void modbus_free(modbus_t *ctx) {
+    delete ctx;
+}
+
+const char *modbus_strerror(int errnum) {
+    return (errnum == ETIMEDOUT) ? "Connection timed out" : "Fake modbus error";
+}
+
+int modbus_read_registers(modbus_t *ctx, int, int nb, uint16_t *dest) {
+    return transact(ctx, OperationKind::READ, nullptr, 0, nb, [&] (SlaveState &slave) {
+        readStatus(slave, nb, dest);
+        return true;
+    });
+}
+
+int modbus_write_register(modbus_t *ctx, int, uint16_t value) {
+    return transact(ctx, OperationKind::WRITE, &value, 1, 1, [&] (SlaveState &slave) {
+        writeCommand(slave, &value, 1);
+        return true;
+    });
+}
+
+int modbus_write_registers(modbus_t *ctx, int, int nb, const uint16_t *data) {
+    return transact(ctx, OperationKind::WRITE, data, nb, nb, [&] (SlaveState &slave) {
+        writeCommand(slave, data, nb);
+        return true;
+    });
+}
+
+int modbus_write_and_read_registers(modbus_t *ctx, int, int write_nb, const uint16_t *src, int, int read_nb, uint16_t *dest) {
+    return transact(ctx, OperationKind::WRITE_READ, src, write_nb, read_nb, [&] (SlaveState &slave) {
+        if (!bus().combined_supported) {
+            errno = EMBXILFUN;
+            return false;
+        }
+
+        writeCommand(slave, src, write_nb);
+        readStatus(slave, read_nb, dest);
+        return true;
+    });
+}
+
+}
@@ -0,0 +1,84 @@
+/**
+ * @file fake_modbus.hpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Simulated RS485 bus of DATC grippers behind the libmodbus API, for the tests
+ * @details fake_modbus.cpp implements the functions of modbus/modbus-rtu.h on one shared bus.
+ * A slave answers status reads with its simulated state and moves its finger by a fixed step on
+ * every read after GRIPPER_OPEN, GRIPPER_CLOSE or SET_FINGER_POSITION. An address without slave
+ * times out after the response timeout set on the context, as a real bus does.
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef FAKE_MODBUS_HPP
+#define FAKE_MODBUS_HPP
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+namespace fake_modbus {
+
+const uint16_t kOpenPos    = 0;
+const uint16_t kClosePos   = 10000;
+const uint16_t kFingerStep = 300; /**< Finger movement per status read */
+
+enum class OperationKind : uint8_t {
+    READ,
+    WRITE,
+    WRITE_READ,
+};
+
+struct Operation {
+    OperationKind kind;
+    uint16_t slave;
+    std::vector<uint16_t> values; /**< Written registers */
+    bool answered;
+};
+
+struct SlaveState {
+    uint16_t command    = 0; /**< Last DATC_COMMAND written */
+    uint16_t finger_pos = 5000;
+    uint16_t target     = 5000;
+    uint16_t step       = kFingerStep; /**< 0: the finger is stuck */
+    bool fault          = false;
+    uint32_t reads      = 0;
+};
+
+/**
+ * @brief Removes every slave and clears the log and the delays.
+ */
+void reset();
+
+void addSlave(uint16_t slave, uint16_t finger_pos = 5000);
+void removeSlave(uint16_t slave);
+void setFingerStep(uint16_t slave, uint16_t step);
+void setFault(uint16_t slave, bool fault);
+SlaveState getSlave(uint16_t slave);
+
+/**
+ * @brief Time every answered transaction takes on the wire.
+ */
+void setTransactionTime(std::chrono::microseconds read_time, std::chrono::microseconds write_time);
+
+/**
+ * @brief false: function 0x17 is answered with an illegal function exception.
+ */
+void setCombinedSupported(bool supported);
+
+/**
+ * @brief Transactions in the order they finished.
+ */
+std::vector<Operation> operations();
+void clearOperations();
+
+/**
+ * @brief false: transactions are not logged, so the bus itself never allocates.
+ */
+void setLogOperations(bool log);
+
+} // namespace fake_modbus
+
+#endif // FAKE_MODBUS_HPP
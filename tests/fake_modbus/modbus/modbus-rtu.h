@@ -0,0 +1,50 @@
+/**
+ * @file modbus-rtu.h
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief The part of the libmodbus API used by modbus_comm.hpp, for the tests
+ * @details Same declarations and error codes as libmodbus 3.1, so the application headers build
+ * without libmodbus installed. The tests link a simulated bus instead (fake_modbus.cpp).
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef FAKE_MODBUS_RTU_H
+#define FAKE_MODBUS_RTU_H
+
+#include <stdint.h>
+
+#define MODBUS_RTU_RS232 0
+#define MODBUS_RTU_RS485 1
+
+#define MODBUS_ENOBASE 112345678
+#define EMBXILFUN (MODBUS_ENOBASE + 1)
+
+extern "C" {
+
+typedef struct _modbus modbus_t;
+
+modbus_t *modbus_new_rtu(const char *device, int baud, char parity, int data_bit, int stop_bit);
+int modbus_rtu_set_serial_mode(modbus_t *ctx, int mode);
+int modbus_rtu_set_rts_delay(modbus_t *ctx, int us);
+
+int modbus_set_debug(modbus_t *ctx, int flag);
+int modbus_set_slave(modbus_t *ctx, int slave);
+int modbus_set_response_timeout(modbus_t *ctx, uint32_t to_sec, uint32_t to_usec);
+int modbus_set_byte_timeout(modbus_t *ctx, uint32_t to_sec, uint32_t to_usec);
+
+int modbus_connect(modbus_t *ctx);
+void modbus_close(modbus_t *ctx);
+void modbus_free(modbus_t *ctx);
+const char *modbus_strerror(int errnum);
+
+int modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest);
+int modbus_write_register(modbus_t *ctx, int addr, uint16_t value);
+int modbus_write_registers(modbus_t *ctx, int addr, int nb, const uint16_t *data);
+int modbus_write_and_read_registers(modbus_t *ctx, int write_addr, int write_nb, const uint16_t *src,
+                                    int read_addr, int read_nb, uint16_t *dest);
+
+}
+
+#endif // FAKE_MODBUS_RTU_H
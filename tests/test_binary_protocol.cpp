@@ -0,0 +1,161 @@
+/**
+ * @file test_binary_protocol.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Binary frame layout and BinaryFramer on split, concatenated and corrupted streams
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "status_encoder.hpp"
+
+using namespace tcp_communication::binary_protocol;
+
+namespace {
+
+struct Frame {
+    FrameType type;
+    string payload;
+
+    bool operator==(const Frame &other) const {return type == other.type && payload == other.payload;}
+};
+
+string frame(FrameType type, const string &payload) {
+    string data(kHeaderSize, '\0');
+    putHeader(&data[0], type, (uint8_t) payload.size());
+    return data + payload;
+}
+
+string commandPayload(uint16_t command, int16_t value_1, uint16_t value_2) {
+    string payload(kCommandSize, '\0');
+    putU16(&payload[0], command);
+    putU16(&payload[2], (uint16_t) value_1);
+    putU16(&payload[4], value_2);
+    return payload;
+}
+
+vector<Frame> feed(BinaryFramer &framer, const string &data) {
+    framer.append(data.data(), data.size());
+
+    vector<Frame> frames;
+    FrameType type;
+    const char *payload;
+    size_t payload_size;
+
+    while (framer.next(type, payload, payload_size)) {
+        frames.push_back({type, string(payload, payload_size)});
+    }
+    return frames;
+}
+
+uint32_t getU32(const char *p) {
+    return getU16(p) | ((uint32_t) getU16(p + 2) << 16);
+}
+
+uint64_t getU64(const char *p) {
+    return getU32(p) | ((uint64_t) getU32(p + 4) << 32);
+}
+
+} // namespace
+
+TEST(BinaryProtocol, LittleEndianFields) {
+    char p[8];
+
+    putU16(p, 0x1234);
+    EXPECT_EQ((uint8_t) p[0], 0x34);
+    EXPECT_EQ((uint8_t) p[1], 0x12);
+    EXPECT_EQ(getU16(p), 0x1234);
+
+    putU16(p, (uint16_t) (int16_t) -2);
+    EXPECT_EQ((int16_t) getU16(p), -2);
+
+    putU64(p, 0x0102030405060708ULL);
+    EXPECT_EQ((uint8_t) p[0], 0x08);
+    EXPECT_EQ((uint8_t) p[7], 0x01);
+    EXPECT_EQ(getU64(p), 0x0102030405060708ULL);
+}
+
+TEST(BinaryProtocol, StatusFrameLayout) {
+    DatcStatus status;
+    status.states     = 0x0221;
+    status.motor_pos  = -1234;
+    status.motor_cur  = 321;
+    status.motor_vel  = -5;
+    status.finger_pos = 10000;
+    status.voltage    = 241;
+
+    StatusEncoder encoder;
+    OutboundMessage message = encoder.encodeBinary(status, 2, 17, 0xA0B0C0D0, 123456789012ULL);
+    ASSERT_EQ(message->size(), kHeaderSize + kStatusSize);
+
+    BinaryFramer framer;
+    const auto frames = feed(framer, *message);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].type, FrameType::STATUS);
+
+    const char *p = frames[0].payload.data();
+    EXPECT_EQ(getU32(p), 0xA0B0C0D0u);
+    EXPECT_EQ(getU64(p + 4), 123456789012ULL);
+    EXPECT_EQ(getU16(p + 12), 0x0221);
+    EXPECT_EQ((int16_t) getU16(p + 14), -1234);
+    EXPECT_EQ((int16_t) getU16(p + 16), 321);
+    EXPECT_EQ((int16_t) getU16(p + 18), -5);
+    EXPECT_EQ(getU16(p + 20), 10000);
+    EXPECT_EQ(getU16(p + 22), 241);
+    EXPECT_EQ(getU16(p + 24), 17);
+    EXPECT_EQ(getU16(p + 26), 2);
+}
+
+TEST(BinaryFramer, ConcatenatedFrames) {
+    const string slave(kChangeSlaveSize, '\x05');
+    const string data = frame(FrameType::COMMAND, commandPayload(104, 500, 0)) +
+                        frame(FrameType::CHANGE_SLAVE, slave) +
+                        frame(FrameType::COMMAND, commandPayload(102, 0, 0));
+
+    BinaryFramer framer;
+    EXPECT_EQ(feed(framer, data), vector<Frame>({{FrameType::COMMAND, commandPayload(104, 500, 0)},
+                                                 {FrameType::CHANGE_SLAVE, slave},
+                                                 {FrameType::COMMAND, commandPayload(102, 0, 0)}}));
+}
+
+TEST(BinaryFramer, FrameSplitAcrossChunks) {
+    const string data = frame(FrameType::COMMAND, commandPayload(104, -1, 65535));
+    BinaryFramer framer;
+
+    // Split inside the header and inside the payload
+    for (size_t i = 0; i + 1 < data.size(); i++) {
+        EXPECT_TRUE(feed(framer, data.substr(i, 1)).empty()) << "at byte " << i;
+    }
+    EXPECT_EQ(feed(framer, data.substr(data.size() - 1)),
+              vector<Frame>({{FrameType::COMMAND, commandPayload(104, -1, 65535)}}));
+}
+
+TEST(BinaryFramer, FrameAndPartOfTheNextInOneChunk) {
+    const string first  = frame(FrameType::COMMAND, commandPayload(101, 0, 0));
+    const string second = frame(FrameType::COMMAND, commandPayload(103, 0, 0));
+    BinaryFramer framer;
+
+    EXPECT_EQ(feed(framer, first + second.substr(0, 5)).size(), 1u);
+    EXPECT_EQ(feed(framer, second.substr(5)), vector<Frame>({{FrameType::COMMAND, commandPayload(103, 0, 0)}}));
+}
+
+TEST(BinaryFramer, ResynchronisesOnGarbage) {
+    const string command = frame(FrameType::COMMAND, commandPayload(104, 42, 0));
+
+    // Garbage, a lone first sync byte and a sync pair in the wrong order
+    const string garbage = string("\x01\x02\xDA\x00\x7C\xDA", 6);
+    BinaryFramer framer;
+
+    EXPECT_EQ(feed(framer, garbage + command), vector<Frame>({{FrameType::COMMAND, commandPayload(104, 42, 0)}}));
+    EXPECT_EQ(feed(framer, command), vector<Frame>({{FrameType::COMMAND, commandPayload(104, 42, 0)}}));
+}
+
+TEST(BinaryFramer, EmptyPayload) {
+    BinaryFramer framer;
+    EXPECT_EQ(feed(framer, frame(FrameType::HEALTH, "")), vector<Frame>({{FrameType::HEALTH, ""}}));
+}
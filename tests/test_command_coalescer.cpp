@@ -0,0 +1,201 @@
+/**
+ * @file test_command_coalescer.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Setpoint merging, ordering of discrete commands and superseded reporting of CommandCoalescer
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "command_coalescer.hpp"
+
+namespace {
+
+using Command = CommandCoalescer::Command;
+
+Command setpoint(uint16_t slave, uint16_t code, uint16_t value) {
+    Command command;
+    command.slave    = slave;
+    command.setpoint = true;
+    command.reg_num  = 2;
+    command.regs[0]  = code;
+    command.regs[1]  = value;
+    return command;
+}
+
+Command discrete(uint16_t slave, uint16_t code) {
+    Command command;
+    command.slave   = slave;
+    command.reg_num = 1;
+    command.regs[0] = code;
+    return command;
+}
+
+struct Submitted {
+    bool result     = false;
+    bool superseded = false;
+};
+
+/**
+ * @brief Queues the commands one after the other in deferred mode, so none is written before
+ * flushAll(), and returns what each caller was told.
+ */
+vector<Submitted> submitDeferred(CommandCoalescer &coalescer, const vector<Command> &commands, vector<Command> &written) {
+    coalescer.setDeferred(true, chrono::milliseconds(10000));
+
+    auto writeFn = [&written] (const Command &command) {
+        written.push_back(command);
+        return true;
+    };
+
+    vector<Submitted> submitted(commands.size());
+    vector<std::thread> callers;
+
+    for (size_t i = 0; i < commands.size(); i++) {
+        const uint64_t before = coalescer.getStats().submitted;
+
+        callers.emplace_back([&, i] {
+            submitted[i].result = coalescer.submit(commands[i], writeFn, submitted[i].superseded);
+        });
+
+        // Keeps the submission order
+        while (coalescer.getStats().submitted == before) {
+            this_thread::yield();
+        }
+    }
+
+    coalescer.flushAll(writeFn);
+    coalescer.setDeferred(false);
+
+    for (auto &caller : callers) {
+        caller.join();
+    }
+    return submitted;
+}
+
+} // namespace
+
+TEST(CommandCoalescer, WritesAtOnceWhenIdle) {
+    CommandCoalescer coalescer;
+    vector<Command> written;
+    bool superseded = true;
+
+    EXPECT_TRUE(coalescer.submit(setpoint(1, 104, 500), [&] (const Command &command) {
+        written.push_back(command);
+        return true;
+    }, superseded));
+
+    EXPECT_FALSE(superseded);
+    ASSERT_EQ(written.size(), 1u);
+    EXPECT_EQ(written[0].regs[1], 500);
+}
+
+TEST(CommandCoalescer, LastSetpointWinsAndTheOthersAreSuperseded) {
+    CommandCoalescer coalescer;
+    vector<Command> written;
+
+    const auto submitted = submitDeferred(coalescer, {setpoint(1, 104, 100), setpoint(1, 104, 200), setpoint(1, 104, 300)}, written);
+
+    ASSERT_EQ(written.size(), 1u);
+    EXPECT_EQ(written[0].regs[1], 300);
+
+    EXPECT_TRUE(submitted[0].result && submitted[0].superseded);
+    EXPECT_TRUE(submitted[1].result && submitted[1].superseded);
+    EXPECT_TRUE(submitted[2].result);
+    EXPECT_FALSE(submitted[2].superseded);
+
+    const CoalescerStats stats = coalescer.getStats();
+    EXPECT_EQ(stats.submitted, 3u);
+    EXPECT_EQ(stats.coalesced, 2u);
+    EXPECT_EQ(stats.written, 1u);
+}
+
+TEST(CommandCoalescer, OtherSlaveOrCodeIsNotMerged) {
+    CommandCoalescer coalescer;
+    vector<Command> written;
+
+    const auto submitted = submitDeferred(coalescer, {setpoint(1, 104, 100), setpoint(2, 104, 200), setpoint(1, 106, 300)}, written);
+
+    ASSERT_EQ(written.size(), 3u);
+    for (auto &caller : submitted) {
+        EXPECT_FALSE(caller.superseded);
+    }
+}
+
+TEST(CommandCoalescer, NothingIsMergedAcrossADiscreteCommand) {
+    CommandCoalescer coalescer;
+    vector<Command> written;
+
+    const auto submitted = submitDeferred(coalescer, {setpoint(1, 104, 100), discrete(1, 102), setpoint(1, 104, 200),
+                                                      setpoint(1, 104, 300)}, written);
+
+    ASSERT_EQ(written.size(), 3u);
+    EXPECT_EQ(written[0].regs[1], 100);
+    EXPECT_EQ(written[1].regs[0], 102);
+    EXPECT_EQ(written[2].regs[1], 300);
+
+    EXPECT_FALSE(submitted[0].superseded);
+    EXPECT_FALSE(submitted[1].superseded);
+    EXPECT_TRUE(submitted[2].superseded);
+    EXPECT_FALSE(submitted[3].superseded);
+}
+
+TEST(CommandCoalescer, FailedWriteReachesEveryMergedCaller) {
+    CommandCoalescer coalescer;
+    coalescer.setDeferred(true, chrono::milliseconds(10000));
+
+    Submitted first, second;
+    std::thread caller_1([&] {first.result = coalescer.submit(setpoint(1, 104, 100), [] (const Command &) {return false;}, first.superseded);});
+
+    while (coalescer.getStats().submitted == 0) {
+        this_thread::yield();
+    }
+    std::thread caller_2([&] {second.result = coalescer.submit(setpoint(1, 104, 200), [] (const Command &) {return false;}, second.superseded);});
+
+    while (coalescer.getStats().submitted == 1) {
+        this_thread::yield();
+    }
+
+    EXPECT_TRUE(coalescer.flushFront(1, [] (const Command &command) {return command.regs[1] == 300;}));
+    caller_1.join();
+    caller_2.join();
+
+    EXPECT_FALSE(first.result);
+    EXPECT_FALSE(second.result);
+    EXPECT_TRUE(first.superseded);
+    EXPECT_FALSE(second.superseded);
+    EXPECT_EQ(coalescer.getStats().combined, 1u);
+}
+
+TEST(CommandCoalescer, ConcurrentCallersAllComplete) {
+    CommandCoalescer coalescer;
+    atomic<int> writes {0};
+
+    vector<std::thread> callers;
+    for (uint16_t t = 0; t < 8; t++) {
+        callers.emplace_back([&, t] {
+            for (uint16_t i = 0; i < 500; i++) {
+                const Command command = (i % 10 == 0) ? discrete(t % 2, 101) : setpoint(t % 2, 104, i);
+                EXPECT_TRUE(coalescer.submit(command, [&] (const Command &) {
+                    writes++;
+                    return true;
+                }));
+            }
+        });
+    }
+
+    for (auto &caller : callers) {
+        caller.join();
+    }
+
+    const CoalescerStats stats = coalescer.getStats();
+    EXPECT_EQ(stats.submitted, 4000u);
+    EXPECT_EQ(stats.written, (uint64_t) writes.load());
+    EXPECT_EQ(stats.written + stats.coalesced, stats.submitted);
+}
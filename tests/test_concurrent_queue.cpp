@@ -0,0 +1,146 @@
+/**
+ * @file test_concurrent_queue.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Blocking pop, batch pop and capacity of ConcurrentQueue
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "concurrent_queue.hpp"
+
+using namespace tcp_communication;
+
+TEST(ConcurrentQueue, WaitPopTimesOutWhenEmpty) {
+    ConcurrentQueue<int> queue(8);
+    int value = 0;
+
+    const auto start = chrono::steady_clock::now();
+    EXPECT_FALSE(queue.waitPop(value, chrono::milliseconds(20)));
+    EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(20));
+}
+
+TEST(ConcurrentQueue, WaitPopReturnsQueuedDataWithoutWaiting) {
+    ConcurrentQueue<int> queue(8);
+    ASSERT_TRUE(queue.push(7));
+
+    int value = 0;
+    const auto start = chrono::steady_clock::now();
+    EXPECT_TRUE(queue.waitPop(value, chrono::seconds(5)));
+    EXPECT_EQ(value, 7);
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(100));
+}
+
+TEST(ConcurrentQueue, WaitPopWakesOnPush) {
+    ConcurrentQueue<int> queue(8);
+    int value = 0;
+    bool popped = false;
+    chrono::steady_clock::time_point woken;
+
+    std::thread consumer([&] () {
+        popped = queue.waitPop(value, chrono::seconds(5));
+        woken  = chrono::steady_clock::now();
+    });
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+    const auto pushed = chrono::steady_clock::now();
+    ASSERT_TRUE(queue.push(42));
+    consumer.join();
+
+    EXPECT_TRUE(popped);
+    EXPECT_EQ(value, 42);
+    // Far below the timeout, the consumer was woken and did not poll
+    EXPECT_LT(woken - pushed, chrono::milliseconds(500));
+}
+
+TEST(ConcurrentQueue, PushFailsWhenFull) {
+    ConcurrentQueue<int> queue(4);
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_EQ(queue.size(), 4u);
+
+    int value = -1;
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.push(4));
+}
+
+TEST(ConcurrentQueue, TryPopBatchKeepsOrder) {
+    ConcurrentQueue<int> queue(16);
+
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(queue.push(i));
+    }
+
+    vector<int> values;
+    EXPECT_EQ(queue.tryPopBatch(back_inserter(values), 4), 4u);
+    EXPECT_EQ(values, vector<int>({0, 1, 2, 3}));
+
+    values.clear();
+    EXPECT_EQ(queue.tryPopBatch(back_inserter(values), 100), 6u);
+    EXPECT_EQ(values, vector<int>({4, 5, 6, 7, 8, 9}));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(ConcurrentQueue, BlockedConsumersReceiveEveryItemOnce) {
+    const int kConsumers = 4;
+    const int kItems     = 20000;
+
+    ConcurrentQueue<int> queue(64);
+    vector<vector<int>> received(kConsumers);
+    vector<std::thread> consumers;
+
+    for (int c = 0; c < kConsumers; c++) {
+        consumers.emplace_back([&, c] () {
+            int value;
+            while (true) {
+                if (!queue.waitPop(value, chrono::seconds(5))) {
+                    ADD_FAILURE() << "Consumer " << c << " starved";
+                    return;
+                }
+                if (value < 0) {
+                    return;
+                }
+                received[c].push_back(value);
+            }
+        });
+    }
+
+    for (int i = 0; i < kItems; i++) {
+        while (!queue.push(i)) {
+            this_thread::yield();
+        }
+    }
+    for (int c = 0; c < kConsumers; c++) {
+        while (!queue.push(-1)) {
+            this_thread::yield();
+        }
+    }
+
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+
+    set<int> all;
+    size_t total = 0;
+    for (auto &values : received) {
+        total += values.size();
+        all.insert(values.begin(), values.end());
+
+        // One consumer sees a single producer's items in order
+        EXPECT_TRUE(is_sorted(values.begin(), values.end()));
+    }
+
+    EXPECT_EQ(total, (size_t) kItems);
+    EXPECT_EQ(all.size(), (size_t) kItems);
+}
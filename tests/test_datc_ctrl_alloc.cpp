@@ -0,0 +1,73 @@
+/**
+ * @file test_datc_ctrl_alloc.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Heap allocations per poll cycle and per command of DatcCtrl, on the simulated bus
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "alloc_counter.hpp"
+#include "datc_ctrl.hpp"
+#include "fake_modbus.hpp"
+
+namespace {
+
+class DatcCtrlAllocTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fake_modbus::reset();
+        for (uint16_t slave_addr = 1; slave_addr <= 4; slave_addr++) {
+            fake_modbus::addSlave(slave_addr);
+        }
+
+        ASSERT_TRUE(ctrl_.modbusInit("/dev/fake", 1, 115200));
+        ctrl_.setPollSlaves({1, 2, 3, 4});
+
+        // The first rounds size the per-slave state and the round buffer
+        for (int i = 0; i < 10; i++) {
+            ASSERT_TRUE(ctrl_.pollBus());
+        }
+        fake_modbus::setLogOperations(false);
+    }
+
+    DatcCtrl ctrl_;
+};
+
+} // namespace
+
+TEST_F(DatcCtrlAllocTest, PollCycleDoesNotAllocate) {
+    const uint64_t before = threadAllocations();
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(ctrl_.pollBus());
+    }
+
+    EXPECT_EQ(threadAllocations() - before, 0u);
+    EXPECT_EQ(fake_modbus::getSlave(4).reads, 110u);
+}
+
+TEST_F(DatcCtrlAllocTest, CommandPathDoesNotAllocate) {
+    // The first command of each kind may size the coalescer
+    ASSERT_TRUE(ctrl_.setFingerPos(1000, 2));
+    ASSERT_TRUE(ctrl_.grpOpen(3));
+    ASSERT_TRUE(ctrl_.motorPosCtrl(90, 500, 4));
+
+    const uint64_t before = threadAllocations();
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(ctrl_.setFingerPos((uint16_t) (i * 100), 2));
+        ASSERT_TRUE(ctrl_.grpOpen(3));
+        ASSERT_TRUE(ctrl_.motorPosCtrl((int16_t) i, 500, 4));
+        ASSERT_TRUE(ctrl_.motorEnable());
+    }
+
+    EXPECT_EQ(threadAllocations() - before, 0u);
+
+    const auto slave = fake_modbus::getSlave(2);
+    EXPECT_EQ(slave.command, 104);
+    EXPECT_EQ(slave.target, 9900);
+}
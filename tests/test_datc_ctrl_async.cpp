@@ -0,0 +1,172 @@
+/**
+ * @file test_datc_ctrl_async.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Asynchronous commands of DatcCtrl on the simulated bus: ack, motion completion, superseded motions
+ * and posted jobs
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "datc_ctrl.hpp"
+#include "fake_modbus.hpp"
+
+namespace {
+
+const uint16_t kSlave = 1;
+
+class DatcCtrlAsyncTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fake_modbus::reset();
+        fake_modbus::addSlave(kSlave, 5000);
+
+        ASSERT_TRUE(ctrl_.modbusInit("/dev/fake", kSlave, 115200));
+        ASSERT_TRUE(ctrl_.pollBus());
+    }
+
+    /**
+     * @brief Polls until the motion resolved, as the poll thread would. The watch is armed by the
+     * async worker after the ack, so polls made before that do not count.
+     */
+    MotionResult pollUntilDone(const shared_future<MotionResult> &motion) {
+        const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+
+        while (motion.wait_for(chrono::seconds(0)) != future_status::ready) {
+            if (chrono::steady_clock::now() > deadline) {
+                ADD_FAILURE() << "Motion not resolved";
+                return MotionResult::TIMEOUT;
+            }
+
+            ctrl_.pollBus();
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        return motion.get();
+    }
+
+    void waitSubmitted(uint64_t submitted) {
+        while (ctrl_.getCommandStats().submitted < submitted) {
+            this_thread::yield();
+        }
+    }
+
+    DatcCtrl ctrl_;
+};
+
+bool isReady(const shared_future<MotionResult> &motion) {
+    return motion.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+} // namespace
+
+TEST_F(DatcCtrlAsyncTest, MotionResolvesWhenTheTargetIsReached) {
+    auto handle = ctrl_.commandAsync(DATC_COMMAND::SET_FINGER_POSITION, 8000, 0, kSlave, true);
+
+    EXPECT_TRUE(handle.ack.get());
+    EXPECT_EQ(pollUntilDone(handle.motion), MotionResult::DONE);
+    EXPECT_EQ(fake_modbus::getSlave(kSlave).finger_pos, 8000);
+}
+
+TEST_F(DatcCtrlAsyncTest, LaterMotionCommandSupersedesTheWatchedOne) {
+    auto first = ctrl_.commandAsync(DATC_COMMAND::SET_FINGER_POSITION, 2000, 0, kSlave, true);
+    ASSERT_TRUE(first.ack.get());
+    ctrl_.pollBus();
+    EXPECT_FALSE(isReady(first.motion));
+
+    auto second = ctrl_.commandAsync(DATC_COMMAND::GRIPPER_CLOSE, 0, 0, kSlave, true);
+    ASSERT_TRUE(second.ack.get());
+
+    // Resolved by the write of the second command, without waiting for a poll
+    ASSERT_TRUE(isReady(first.motion));
+    EXPECT_EQ(first.motion.get(), MotionResult::SUPERSEDED);
+    EXPECT_EQ(pollUntilDone(second.motion), MotionResult::DONE);
+}
+
+TEST_F(DatcCtrlAsyncTest, OtherCommandsDoNotSupersedeTheMotion) {
+    auto handle = ctrl_.commandAsync(DATC_COMMAND::SET_FINGER_POSITION, 7000, 0, kSlave, true);
+    ASSERT_TRUE(handle.ack.get());
+
+    EXPECT_TRUE(ctrl_.motorEnable(kSlave));
+    EXPECT_FALSE(isReady(handle.motion));
+    EXPECT_EQ(pollUntilDone(handle.motion), MotionResult::DONE);
+}
+
+TEST_F(DatcCtrlAsyncTest, CoalescedSetpointResolvesSupersededAtOnce) {
+    fake_modbus::setTransactionTime(chrono::microseconds(0), chrono::milliseconds(100));
+
+    // Holds the port while the async command and the one replacing it are queued
+    std::thread busy([this] {EXPECT_TRUE(ctrl_.setFingerPos(1000, kSlave));});
+    waitSubmitted(1);
+
+    auto async = ctrl_.commandAsync(DATC_COMMAND::SET_FINGER_POSITION, 2000, 0, kSlave, true);
+    waitSubmitted(2);
+
+    std::thread later([this] {EXPECT_TRUE(ctrl_.setFingerPos(3000, kSlave));});
+
+    busy.join();
+    later.join();
+
+    // Resolved by the async worker right after the ack, not by polling
+    EXPECT_TRUE(async.ack.get());
+    ASSERT_EQ(async.motion.wait_for(chrono::seconds(1)), future_status::ready);
+    EXPECT_EQ(async.motion.get(), MotionResult::SUPERSEDED);
+
+    EXPECT_EQ(ctrl_.getCommandStats().coalesced, 1u);
+    EXPECT_EQ(fake_modbus::getSlave(kSlave).target, 3000);
+}
+
+TEST_F(DatcCtrlAsyncTest, PostReturnsWhileTheBusIsBusy) {
+    fake_modbus::setTransactionTime(chrono::microseconds(0), chrono::milliseconds(200));
+
+    // A command holding the port, as the poll thread or another caller would
+    std::thread busy([this] {EXPECT_TRUE(ctrl_.setFingerPos(1000, kSlave));});
+    waitSubmitted(1);
+
+    const auto caller = this_thread::get_id();
+    vector<int> order;
+    bool done_off_caller = false;
+
+    const auto post_start = chrono::steady_clock::now();
+
+    auto first = ctrl_.post([&] {order.push_back(1); return ctrl_.motorEnable(kSlave);}, [&] (bool) {
+        done_off_caller = (this_thread::get_id() != caller);
+    });
+    auto command = ctrl_.commandAsync(DATC_COMMAND::GRIPPER_OPEN, 0, 0, kSlave, false, [&] (bool) {order.push_back(2);});
+    auto last = ctrl_.post([&] {order.push_back(3); return false;});
+
+    // The caller (a GUI slot) does not wait for the port
+    EXPECT_LT(chrono::steady_clock::now() - post_start, chrono::milliseconds(50));
+    EXPECT_EQ(first.wait_for(chrono::seconds(0)), future_status::timeout);
+
+    busy.join();
+
+    EXPECT_TRUE(first.get());
+    EXPECT_TRUE(command.ack.get());
+    EXPECT_FALSE(last.get());
+
+    EXPECT_EQ(order, (vector<int> {1, 2, 3}));
+    EXPECT_TRUE(done_off_caller);
+}
+
+TEST_F(DatcCtrlAsyncTest, MotionDoneCallbackCanSendTheNextMotion) {
+    bool next_sent = false;
+
+    // Runs on the polling thread, here the test thread calling pollBus()
+    auto handle = ctrl_.commandAsync(DATC_COMMAND::SET_FINGER_POSITION, 6000, 0, kSlave, true, nullptr,
+                                     [&] (MotionResult result) {
+                                         if (result == MotionResult::DONE) {
+                                             next_sent = ctrl_.grpClose(kSlave);
+                                         }
+                                     });
+
+    ASSERT_TRUE(handle.ack.get());
+    EXPECT_EQ(pollUntilDone(handle.motion), MotionResult::DONE);
+
+    EXPECT_TRUE(next_sent);
+    EXPECT_EQ(fake_modbus::getSlave(kSlave).command, (uint16_t) DATC_COMMAND::GRIPPER_CLOSE);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file test_json_framer.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief JsonFramer on split, concatenated, nested and malformed input
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "json_framer.hpp"
+
+using namespace tcp_communication;
+
+namespace {
+
+vector<string> feed(JsonFramer &framer, const string &data) {
+    framer.append(data.data(), data.size());
+
+    vector<string> frames;
+    const char *begin, *end;
+
+    while (framer.next(begin, end)) {
+        frames.emplace_back(begin, end);
+    }
+    return frames;
+}
+
+} // namespace
+
+TEST(JsonFramer, SingleObject) {
+    JsonFramer framer;
+    EXPECT_EQ(feed(framer, "{\"command\":101}"), vector<string>({"{\"command\":101}"}));
+}
+
+TEST(JsonFramer, ConcatenatedObjectsInOneChunk) {
+    JsonFramer framer;
+    EXPECT_EQ(feed(framer, "{\"a\":1}{\"b\":2}\n{\"c\":3}"),
+              vector<string>({"{\"a\":1}", "{\"b\":2}", "{\"c\":3}"}));
+}
+
+TEST(JsonFramer, ObjectSplitAcrossChunks) {
+    const string object = "{\"command\":104,\"value_1\":500}";
+    JsonFramer framer;
+
+    // One byte per read, the frame appears with its last byte only
+    for (size_t i = 0; i + 1 < object.size(); i++) {
+        EXPECT_TRUE(feed(framer, object.substr(i, 1)).empty()) << "at byte " << i;
+    }
+    EXPECT_EQ(feed(framer, object.substr(object.size() - 1)), vector<string>({object}));
+}
+
+TEST(JsonFramer, FrameAndPartOfTheNextInOneChunk) {
+    JsonFramer framer;
+
+    EXPECT_EQ(feed(framer, "{\"a\":1}{\"b\""), vector<string>({"{\"a\":1}"}));
+    EXPECT_EQ(feed(framer, ":2}"), vector<string>({"{\"b\":2}"}));
+}
+
+TEST(JsonFramer, NestedObjects) {
+    const string object = "{\"subscribe\":{\"slaves\":[1,2],\"filter\":{\"fields\":[\"motor_pos\"]}}}";
+    JsonFramer framer;
+
+    EXPECT_EQ(feed(framer, object + object), vector<string>({object, object}));
+}
+
+TEST(JsonFramer, BracesAndEscapesInsideStrings) {
+    const string object = "{\"text\":\"}{ \\\"quoted\\\" \\\\\",\"next\":\"{\"}";
+    JsonFramer framer;
+
+    EXPECT_EQ(feed(framer, object), vector<string>({object}));
+
+    // Split right after the backslash
+    const size_t split = object.find("\\\"");
+    JsonFramer split_framer;
+    EXPECT_TRUE(feed(split_framer, object.substr(0, split + 1)).empty());
+    EXPECT_EQ(feed(split_framer, object.substr(split + 1)), vector<string>({object}));
+}
+
+TEST(JsonFramer, SkipsDataBetweenObjects) {
+    JsonFramer framer;
+
+    // A chunk with no '{' is kept waiting, not an error
+    EXPECT_TRUE(feed(framer, "garbage \r\n").empty());
+    EXPECT_EQ(feed(framer, "} noise {\"a\":1} tail"), vector<string>({"{\"a\":1}"}));
+    EXPECT_EQ(feed(framer, "{\"b\":2}"), vector<string>({"{\"b\":2}"}));
+}
+
+TEST(JsonFramer, DiscardsOversizedObject) {
+    JsonFramer framer(32);
+
+    EXPECT_TRUE(feed(framer, "{\"a\":\"" + string(64, 'x')).empty());
+    EXPECT_TRUE(feed(framer, "\"}").empty());
+    EXPECT_EQ(feed(framer, "{\"b\":2}"), vector<string>({"{\"b\":2}"}));
+}
+
+TEST(JsonFramer, RemainingDataAfterFrame) {
+    JsonFramer framer;
+    const string data = "{\"protocol\":\"binary\"}\xDA\x7C";
+
+    framer.append(data.data(), data.size());
+
+    const char *begin, *end;
+    ASSERT_TRUE(framer.next(begin, end));
+    EXPECT_EQ(string(framer.remainingData(), framer.remainingSize()), "\xDA\x7C");
+}
+
+TEST(JsonFramer, RandomChunkingGivesTheSameFrames) {
+    vector<string> objects;
+    string stream;
+
+    for (int i = 0; i < 500; i++) {
+        objects.push_back("{\"command\":" + to_string(100 + i % 10) + ",\"note\":\"{" + to_string(i) +
+                          "\\\"}\",\"nested\":{\"i\":" + to_string(i) + "}}");
+        stream += objects.back();
+        if (i % 7 == 0) {
+            stream += "\n";
+        }
+    }
+
+    mt19937 rng(1234);
+    uniform_int_distribution<size_t> chunk_size(1, 97);
+    JsonFramer framer;
+    vector<string> frames;
+
+    for (size_t pos = 0; pos < stream.size();) {
+        const size_t size = min(chunk_size(rng), stream.size() - pos);
+        const auto chunk_frames = feed(framer, stream.substr(pos, size));
+
+        frames.insert(frames.end(), chunk_frames.begin(), chunk_frames.end());
+        pos += size;
+    }
+
+    EXPECT_EQ(frames, objects);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file test_modbus_comm.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Priority of command writes over status reads on the port
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <ctime>
+
+#include "fake_modbus.hpp"
+#include "modbus_comm.hpp"
+
+namespace {
+
+double threadCpuMs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+class ModbusCommTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fake_modbus::reset();
+        fake_modbus::addSlave(1);
+        ASSERT_TRUE(mbc_.modbusInit("/dev/fake", 1, 115200));
+    }
+
+    ModbusComm mbc_;
+};
+
+} // namespace
+
+TEST_F(ModbusCommTest, ReadWithoutWriters) {
+    array<uint16_t, 8> regs;
+
+    ASSERT_TRUE(mbc_.recvData(1, 10, regs));
+    EXPECT_EQ(regs[4], 5000);
+}
+
+TEST_F(ModbusCommTest, WaitingWritersGoBeforeReader) {
+    fake_modbus::setTransactionTime(chrono::microseconds(1000), chrono::milliseconds(40));
+
+    double reader_cpu_ms = 0;
+    bool read_ok = false;
+
+    // The first write holds the port, a second writer and the reader queue up behind it
+    std::thread writer_1([&] () {mbc_.sendData(1, 0, (uint16_t) 101);});
+    this_thread::sleep_for(chrono::milliseconds(10));
+
+    std::thread reader([&] () {
+        array<uint16_t, 8> regs;
+        const double start = threadCpuMs();
+        read_ok = mbc_.recvData(1, 10, regs);
+        reader_cpu_ms = threadCpuMs() - start;
+    });
+    this_thread::sleep_for(chrono::milliseconds(10));
+
+    std::thread writer_2([&] () {mbc_.sendData(1, 0, (uint16_t) 102);});
+
+    writer_1.join();
+    writer_2.join();
+    reader.join();
+
+    const auto operations = fake_modbus::operations();
+    ASSERT_EQ(operations.size(), 3u);
+    EXPECT_EQ(operations[0].kind, fake_modbus::OperationKind::WRITE);
+    EXPECT_EQ(operations[1].kind, fake_modbus::OperationKind::WRITE);
+    EXPECT_EQ(operations[1].values, vector<uint16_t>({102}));
+    EXPECT_EQ(operations[2].kind, fake_modbus::OperationKind::READ);
+    EXPECT_TRUE(read_ok);
+
+    // About 70 ms waiting for the writers, asleep rather than spinning
+    EXPECT_LT(reader_cpu_ms, 10.0);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file test_monitor_status.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Which statuses MonitorPublisher lets through to the GUI: states at once, measurements rate-limited
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "monitor_status.hpp"
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+MonitorStatus connectedStatus(uint16_t finger_pos = 5000) {
+    MonitorStatus status;
+    status.modbus_connected = true;
+    status.slave_addr = 1;
+    status.state      = DatcState::GRIPPER_OPEN;
+    status.finger_pos = finger_pos;
+    return status;
+}
+
+} // namespace
+
+TEST(MonitorPublisher, UnchangedStatusIsNotEmitted) {
+    MonitorPublisher publisher;
+    auto now = Clock::now();
+
+    EXPECT_FALSE(publisher.update(MonitorStatus(), now));
+
+    EXPECT_TRUE(publisher.update(connectedStatus(), now));
+    for (int i = 0; i < 10; i++) {
+        now += kMonitorMinInterval;
+        EXPECT_FALSE(publisher.update(connectedStatus(), now));
+    }
+}
+
+TEST(MonitorPublisher, StateChangesAreEmittedAtOnce) {
+    MonitorPublisher publisher;
+    const auto now = Clock::now();
+
+    ASSERT_TRUE(publisher.update(connectedStatus(), now));
+
+    MonitorStatus status = connectedStatus();
+    status.state = DatcState::GRIPPER_CLOSE;
+    EXPECT_TRUE(publisher.update(status, now));
+
+    status.health = SlaveHealth::SUSPECT;
+    EXPECT_TRUE(publisher.update(status, now));
+
+    status.socket_connected = true;
+    EXPECT_TRUE(publisher.update(status, now));
+
+    EXPECT_EQ(publisher.getLast(), status);
+}
+
+TEST(MonitorPublisher, MeasurementsAreRateLimited) {
+    MonitorPublisher publisher;
+    const auto start = Clock::now();
+
+    ASSERT_TRUE(publisher.update(connectedStatus(5000), start));
+
+    // Finger moving, one status per 10 ms poll
+    int emitted = 0;
+    for (int i = 1; i <= 100; i++) {
+        emitted += publisher.update(connectedStatus(5000 + i), start + chrono::milliseconds(10 * i));
+    }
+    EXPECT_EQ(emitted, 1000 / (int) kMonitorMinInterval.count());
+
+    // The last poll ended an interval, so the final position went out and is not sent again
+    EXPECT_EQ(publisher.getLast().finger_pos, 5100);
+    EXPECT_FALSE(publisher.update(connectedStatus(5100), start + chrono::milliseconds(2000)));
+}
+
+TEST(MonitorPublisher, HeldBackMeasurementGoesOutWithTheNextState) {
+    MonitorPublisher publisher;
+    const auto now = Clock::now();
+
+    ASSERT_TRUE(publisher.update(connectedStatus(5000), now));
+    EXPECT_FALSE(publisher.update(connectedStatus(5200), now + chrono::milliseconds(10)));
+
+    MonitorStatus status = connectedStatus(5300);
+    status.recv_err = true;
+    EXPECT_TRUE(publisher.update(status, now + chrono::milliseconds(20)));
+    EXPECT_EQ(publisher.getLast().finger_pos, 5300);
+}
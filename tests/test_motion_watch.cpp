@@ -0,0 +1,173 @@
+/**
+ * @file test_motion_watch.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Motion completion of MotionWatch from a sequence of polled statuses
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "async_command.hpp"
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const chrono::milliseconds kPollPeriod(20);
+
+/**
+ * @brief Feeds one status per poll period after the command was acked at seq 10.
+ */
+class MotionWatchTest : public ::testing::Test {
+protected:
+    void startWatch(MotionKind kind, uint16_t start_pos, uint16_t target_pos = 0) {
+        watch_.reset(new MotionWatch(1, kind, target_pos, [this] (MotionResult result) {results_.push_back(result);}));
+        watch_->start(seq_, now_, start_pos);
+        start_time_ = now_;
+    }
+
+    bool poll(uint16_t finger_pos, bool grp_open = false, bool grp_close = false, bool fault = false) {
+        MotionSample sample;
+        sample.seq        = ++seq_;
+        sample.finger_pos = finger_pos;
+        sample.grp_open   = grp_open;
+        sample.grp_close  = grp_close;
+        sample.fault      = fault;
+
+        now_ += kPollPeriod;
+        return watch_->update(sample, now_);
+    }
+
+    MotionResult result() {
+        EXPECT_EQ(results_.size(), 1u);
+        return watch_->getFuture().get();
+    }
+
+    unique_ptr<MotionWatch> watch_;
+    vector<MotionResult> results_;
+    uint32_t seq_ = 10;
+    Clock::time_point now_ = Clock::now();
+    Clock::time_point start_time_;
+};
+
+} // namespace
+
+TEST_F(MotionWatchTest, OpenIsDoneWhenTheBitIsSetAfterTheFingerMoved) {
+    startWatch(MotionKind::GRIPPER_OPEN, 8000);
+
+    for (uint16_t pos = 7000; pos > 0; pos -= 1000) {
+        EXPECT_FALSE(poll(pos));
+    }
+    EXPECT_FALSE(poll(0, true));
+    EXPECT_FALSE(poll(0, true));
+    EXPECT_FALSE(poll(0, true));
+    EXPECT_TRUE(poll(0, true));
+
+    EXPECT_EQ(result(), MotionResult::DONE);
+}
+
+TEST_F(MotionWatchTest, StaleOpenBitDoesNotCompleteBeforeTheMotionStarts) {
+    // Half closed by hand while the open bit of the last open is still set
+    startWatch(MotionKind::GRIPPER_OPEN, 4000);
+
+    // The DATC has not started moving yet
+    for (int i = 0; i < 5; i++) {
+        EXPECT_FALSE(poll(4000, true));
+    }
+
+    for (uint16_t pos = 3000; pos > 0; pos -= 1000) {
+        EXPECT_FALSE(poll(pos, true));
+    }
+    for (uint32_t i = 0; i < kMotionSettleCycles; i++) {
+        EXPECT_FALSE(poll(0, true)) << "before settling, poll " << i;
+    }
+    EXPECT_TRUE(poll(0, true));
+
+    EXPECT_EQ(result(), MotionResult::DONE);
+}
+
+TEST_F(MotionWatchTest, BitClearedAndSetAgainCountsAsStart) {
+    startWatch(MotionKind::GRIPPER_CLOSE, 10000);
+
+    EXPECT_FALSE(poll(10000, false, true));
+    EXPECT_FALSE(poll(10000, false, false));
+
+    // Standing since the first status
+    EXPECT_FALSE(poll(10002, false, true));
+    EXPECT_TRUE(poll(10002, false, true));
+
+    EXPECT_EQ(result(), MotionResult::DONE);
+}
+
+TEST_F(MotionWatchTest, AlreadyOpenIsDoneAfterTheStartWindow) {
+    startWatch(MotionKind::GRIPPER_OPEN, 0);
+
+    const int window_polls = (int) (kMotionStartWindow / kPollPeriod);
+
+    for (int i = 1; i < window_polls; i++) {
+        EXPECT_FALSE(poll(0, true)) << "poll " << i;
+    }
+    EXPECT_TRUE(poll(0, true));
+
+    EXPECT_EQ(result(), MotionResult::DONE);
+}
+
+TEST_F(MotionWatchTest, FingerPositionIsDoneAtTheTarget) {
+    startWatch(MotionKind::FINGER_POSITION, 5000, 6000);
+
+    EXPECT_FALSE(poll(5500));
+    EXPECT_FALSE(poll(5990));
+    EXPECT_FALSE(poll(5990));
+    EXPECT_FALSE(poll(5991));
+    EXPECT_TRUE(poll(5990));
+
+    EXPECT_EQ(result(), MotionResult::DONE);
+}
+
+TEST_F(MotionWatchTest, FingerAlreadyAtTheTargetNeedsNoStart) {
+    startWatch(MotionKind::FINGER_POSITION, 6000, 6000);
+
+    for (uint32_t i = 0; i < kMotionSettleCycles; i++) {
+        EXPECT_FALSE(poll(6000));
+    }
+    EXPECT_TRUE(poll(6000));
+
+    EXPECT_EQ(result(), MotionResult::DONE);
+}
+
+TEST_F(MotionWatchTest, StatusesUpToTheStartSequenceAreIgnored) {
+    startWatch(MotionKind::FINGER_POSITION, 5000, 5000);
+
+    MotionSample old;
+    old.seq        = seq_;
+    old.finger_pos = 5000;
+    old.fault      = true;
+
+    EXPECT_FALSE(watch_->update(old, now_));
+    EXPECT_TRUE(results_.empty());
+}
+
+TEST_F(MotionWatchTest, FaultResolvesAtOnce) {
+    startWatch(MotionKind::GRIPPER_CLOSE, 0);
+
+    EXPECT_FALSE(poll(1000));
+    EXPECT_TRUE(poll(2000, false, false, true));
+
+    EXPECT_EQ(result(), MotionResult::FAULT);
+}
+
+TEST_F(MotionWatchTest, BlockedFingerTimesOut) {
+    startWatch(MotionKind::GRIPPER_CLOSE, 0);
+
+    EXPECT_FALSE(poll(3000));
+
+    // Stopped on an object, the close bit never comes
+    while (!poll(3000)) {
+        ASSERT_LT(now_ - start_time_, kMotionTimeout + kPollPeriod);
+    }
+
+    EXPECT_EQ(result(), MotionResult::TIMEOUT);
+}
@@ -0,0 +1,159 @@
+/**
+ * @file test_ring_buffer.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief RingBuffer in both modes, single threaded and under concurrent producers and consumers
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <string>
+
+#include "ring_buffer.hpp"
+
+using namespace tcp_communication;
+
+namespace {
+
+/**
+ * @brief Every producer pushes its id in the upper bits and a counter in the lower bits. Checks
+ * that every value was popped exactly once and that each consumer saw every producer in order.
+ */
+template<QueueMode Mode>
+void stress(int producer_num, int consumer_num, uint64_t per_producer, size_t capacity) {
+    RingBuffer<uint64_t, Mode> ring(capacity);
+
+    const uint64_t total = per_producer * producer_num;
+    atomic<uint64_t> popped {0};
+
+    vector<vector<uint8_t>> seen(producer_num, vector<uint8_t>(per_producer, 0));
+    vector<std::thread> threads;
+    atomic<bool> ordered {true};
+    atomic<bool> duplicate {false};
+    mutex mutex_seen;
+
+    for (int c = 0; c < consumer_num; c++) {
+        threads.emplace_back([&] () {
+            vector<int64_t> last(producer_num, -1);
+            vector<uint64_t> values;
+            values.reserve(total);
+
+            uint64_t value;
+            while (popped.load(memory_order_relaxed) < total) {
+                if (!ring.tryPop(value)) {
+                    this_thread::yield();
+                    continue;
+                }
+                popped.fetch_add(1, memory_order_relaxed);
+
+                const int producer   = (int) (value >> 32);
+                const int64_t index  = (int64_t) (value & 0xFFFFFFFF);
+
+                if (index <= last[producer]) {
+                    ordered = false;
+                }
+                last[producer] = index;
+                values.push_back(value);
+            }
+
+            lock_guard<mutex> lg(mutex_seen);
+            for (uint64_t v : values) {
+                uint8_t &flag = seen[v >> 32][v & 0xFFFFFFFF];
+                if (flag) {
+                    duplicate = true;
+                }
+                flag = 1;
+            }
+        });
+    }
+
+    for (int p = 0; p < producer_num; p++) {
+        threads.emplace_back([&, p] () {
+            for (uint64_t i = 0; i < per_producer; i++) {
+                const uint64_t value = ((uint64_t) p << 32) | i;
+                while (!ring.tryPush(value)) {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_TRUE(ordered);
+    EXPECT_FALSE(duplicate);
+    EXPECT_TRUE(ring.empty());
+
+    for (auto &producer : seen) {
+        EXPECT_EQ(count(producer.begin(), producer.end(), 0), 0);
+    }
+}
+
+} // namespace
+
+TEST(RingBuffer, CapacityRoundsUpToPowerOfTwo) {
+    EXPECT_EQ(RingBuffer<int>(1).capacity(), 1u);
+    EXPECT_EQ(RingBuffer<int>(5).capacity(), 8u);
+    EXPECT_EQ(RingBuffer<int>(1024).capacity(), 1024u);
+}
+
+TEST(RingBuffer, FifoAcrossWrapAround) {
+    RingBuffer<int, QueueMode::MPMC> mpmc(4);
+    RingBuffer<int, QueueMode::SPSC> spsc(4);
+    int value;
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(mpmc.tryPush(round * 4 + i));
+            ASSERT_TRUE(spsc.tryPush(round * 4 + i));
+        }
+        EXPECT_FALSE(mpmc.tryPush(-1));
+        EXPECT_FALSE(spsc.tryPush(-1));
+        EXPECT_EQ(mpmc.size(), 4u);
+
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(mpmc.tryPop(value));
+            EXPECT_EQ(value, round * 4 + i);
+            ASSERT_TRUE(spsc.tryPop(value));
+            EXPECT_EQ(value, round * 4 + i);
+        }
+        EXPECT_FALSE(mpmc.tryPop(value));
+        EXPECT_FALSE(spsc.tryPop(value));
+    }
+}
+
+TEST(RingBuffer, MovesOwningTypes) {
+    RingBuffer<shared_ptr<const string>> ring(2);
+    auto message = make_shared<const string>("status");
+
+    ASSERT_TRUE(ring.tryPush(message));
+    EXPECT_EQ(message.use_count(), 2);
+
+    shared_ptr<const string> popped;
+    ASSERT_TRUE(ring.tryPop(popped));
+
+    // The slot gives up its reference when popped
+    EXPECT_EQ(popped.use_count(), 2);
+    EXPECT_EQ(*popped, "status");
+}
+
+TEST(RingBuffer, SpscStress) {
+    stress<QueueMode::SPSC>(1, 1, 1000000, 256);
+}
+
+TEST(RingBuffer, MpmcStress) {
+    stress<QueueMode::MPMC>(4, 4, 200000, 64);
+}
+
+TEST(RingBuffer, MpmcStressManyProducersSmallRing) {
+    stress<QueueMode::MPMC>(16, 2, 20000, 4);
+}
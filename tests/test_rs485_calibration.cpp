@@ -0,0 +1,127 @@
+/**
+ * @file test_rs485_calibration.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief RS485 timing calibration of DatcCtrl on the simulated bus
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <thread>
+
+#include "datc_ctrl.hpp"
+#include "fake_modbus.hpp"
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const char kPort[] = "/dev/fake_calibration";
+const size_t kSamples = 20;
+
+class Rs485CalibrationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        remove(kRs485TimingFile);
+
+        fake_modbus::reset();
+        fake_modbus::addSlave(1);
+        fake_modbus::addSlave(2);
+
+        ASSERT_TRUE(ctrl_.modbusInit(kPort, 1, 115200));
+        ctrl_.setPollSlaves({1, 2});
+    }
+
+    void TearDown() override {
+        remove(kRs485TimingFile);
+    }
+
+    vector<fake_modbus::Operation> readsOf(uint16_t slave) {
+        vector<fake_modbus::Operation> reads;
+        for (auto &operation : fake_modbus::operations()) {
+            if (operation.slave == slave && operation.kind == fake_modbus::OperationKind::READ) {
+                reads.push_back(operation);
+            }
+        }
+        return reads;
+    }
+
+    DatcCtrl ctrl_;
+};
+
+} // namespace
+
+TEST_F(Rs485CalibrationTest, MissingSlaveCostIsMeasured) {
+    const TimingCalibration calibration = ctrl_.calibrateTiming(kSamples);
+    ASSERT_TRUE(calibration.success);
+
+    // Read of the highest address, once with the libmodbus default and once with the calibrated timeout
+    const auto probes = readsOf(kMissingSlaveProbeAddr);
+    ASSERT_EQ(probes.size(), 2u);
+    EXPECT_FALSE(probes[0].answered);
+
+    const double before_ms = calibration.before.response_timeout_us / 1000.0;
+    const double after_ms  = calibration.after.response_timeout_us / 1000.0;
+
+    EXPECT_GE(calibration.missing_slave_before_ms, before_ms);
+    EXPECT_LT(calibration.missing_slave_before_ms, before_ms + 100);
+    EXPECT_GE(calibration.missing_slave_after_ms, after_ms);
+    EXPECT_LT(calibration.missing_slave_after_ms, after_ms + 100);
+    EXPECT_LT(calibration.after.response_timeout_us, calibration.before.response_timeout_us);
+}
+
+TEST_F(Rs485CalibrationTest, UnpolledSlaveThatAnswersIsSkipped) {
+    fake_modbus::addSlave(kMissingSlaveProbeAddr);
+
+    const TimingCalibration calibration = ctrl_.calibrateTiming(kSamples);
+    ASSERT_TRUE(calibration.success);
+
+    EXPECT_TRUE(readsOf(kMissingSlaveProbeAddr)[0].answered);
+    EXPECT_FALSE(readsOf(kMissingSlaveProbeAddr - 1)[0].answered);
+    EXPECT_GE(calibration.missing_slave_before_ms, calibration.before.response_timeout_us / 1000.0);
+}
+
+TEST_F(Rs485CalibrationTest, PollingPausesWhileCalibrating) {
+    atomic<bool> stop {false};
+    mutex mutex_cycles;
+    vector<Clock::time_point> cycles;
+
+    std::thread poll_thread([&] {
+        ctrl_.pollLoop(stop, [&] {
+            lock_guard<mutex> lg(mutex_cycles);
+            cycles.push_back(Clock::now());
+        });
+    });
+
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    const auto calibration_start = Clock::now();
+    const TimingCalibration calibration = ctrl_.calibrateTiming(kSamples);
+    const auto calibration_end = Clock::now();
+
+    this_thread::sleep_for(chrono::milliseconds(100));
+    stop = true;
+    poll_thread.join();
+
+    EXPECT_TRUE(calibration.success);
+
+    // A round already running when the calibration started may still finish
+    size_t before = 0, during = 0, after = 0;
+    for (auto &cycle : cycles) {
+        if (cycle < calibration_start + chrono::milliseconds(20)) {
+            before++;
+        } else if (cycle <= calibration_end) {
+            during++;
+        } else {
+            after++;
+        }
+    }
+
+    EXPECT_GT(before, 0u);
+    EXPECT_EQ(during, 0u);
+    EXPECT_GT(after, 0u);
+}
@@ -0,0 +1,209 @@
+/**
+ * @file test_slave_health.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Health transitions and probe backoff of SlaveHealthState, and of the slaves of DatcCtrl
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "datc_ctrl.hpp"
+#include "fake_modbus.hpp"
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Transition {
+    uint16_t slave;
+    SlaveHealth previous;
+    SlaveHealth health;
+};
+
+size_t countOperations(uint16_t slave, fake_modbus::OperationKind kind) {
+    size_t count = 0;
+    for (auto &operation : fake_modbus::operations()) {
+        count += (operation.slave == slave && operation.kind == kind);
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(SlaveHealthState, FailuresMakeTheSlaveSuspectThenDown) {
+    SlaveHealthState state;
+    const auto now = Clock::now();
+
+    EXPECT_FALSE(state.update(true, now));
+    EXPECT_EQ(state.get(), SlaveHealth::HEALTHY);
+
+    EXPECT_TRUE(state.update(false, now));
+    EXPECT_EQ(state.get(), SlaveHealth::SUSPECT);
+
+    for (uint32_t i = 2; i < kDownAfterFailures; i++) {
+        EXPECT_FALSE(state.update(false, now));
+        EXPECT_EQ(state.get(), SlaveHealth::SUSPECT);
+    }
+
+    EXPECT_TRUE(state.update(false, now));
+    EXPECT_EQ(state.get(), SlaveHealth::DOWN);
+    EXPECT_EQ(state.getFailures(), kDownAfterFailures);
+}
+
+TEST(SlaveHealthState, SuspectSlaveIsStillPolled) {
+    SlaveHealthState state;
+    const auto now = Clock::now();
+
+    state.update(false, now);
+    EXPECT_TRUE(state.isPollDue(now));
+
+    EXPECT_TRUE(state.update(true, now));
+    EXPECT_EQ(state.get(), SlaveHealth::HEALTHY);
+    EXPECT_EQ(state.getFailures(), 0u);
+}
+
+TEST(SlaveHealthState, DownSlaveIsProbedWithExponentialBackoff) {
+    SlaveHealthState state;
+    auto now = Clock::now();
+
+    for (uint32_t i = 0; i < kDownAfterFailures; i++) {
+        state.update(false, now);
+    }
+    ASSERT_EQ(state.get(), SlaveHealth::DOWN);
+
+    chrono::milliseconds backoff = kProbeBackoffMin;
+
+    for (int probe = 0; probe < 10; probe++) {
+        EXPECT_FALSE(state.isPollDue(now + backoff - chrono::milliseconds(1))) << "probe " << probe;
+        EXPECT_TRUE(state.isPollDue(now + backoff)) << "probe " << probe;
+
+        // Failed probe
+        now += backoff;
+        EXPECT_FALSE(state.update(false, now));
+        EXPECT_EQ(state.get(), SlaveHealth::DOWN);
+
+        backoff = min(backoff * 2, kProbeBackoffMax);
+    }
+
+    EXPECT_EQ(backoff, kProbeBackoffMax);
+}
+
+TEST(SlaveHealthState, SuccessfulProbeResetsTheBackoff) {
+    SlaveHealthState state;
+    auto now = Clock::now();
+
+    for (uint32_t i = 0; i < kDownAfterFailures + 4; i++) {
+        state.update(false, now);
+    }
+
+    EXPECT_TRUE(state.update(true, now));
+    EXPECT_EQ(state.get(), SlaveHealth::HEALTHY);
+
+    // Down again, the first probe comes after the shortest backoff
+    for (uint32_t i = 0; i < kDownAfterFailures; i++) {
+        state.update(false, now);
+    }
+    EXPECT_TRUE(state.isPollDue(now + kProbeBackoffMin));
+}
+
+TEST(SlaveHealthState, NamesMatchTheStates) {
+    EXPECT_EQ(slaveHealthName(SlaveHealth::HEALTHY), "healthy");
+    EXPECT_EQ(slaveHealthName(SlaveHealth::SUSPECT), "suspect");
+    EXPECT_EQ(slaveHealthName(SlaveHealth::DOWN), "down");
+}
+
+TEST(DatcCtrlSlaveHealth, UnpluggedSlaveGoesDownAndIsOnlyProbed) {
+    fake_modbus::reset();
+    fake_modbus::addSlave(1);
+    fake_modbus::addSlave(2);
+
+    DatcCtrl ctrl;
+    ASSERT_TRUE(ctrl.modbusInit("/dev/fake", 1, 115200));
+    ctrl.setPollSlaves({1, 2});
+
+    vector<Transition> transitions;
+    ctrl.setHealthCallback([&] (uint16_t slave, SlaveHealth previous, SlaveHealth health) {
+        transitions.push_back({slave, previous, health});
+    });
+
+    ASSERT_TRUE(ctrl.pollBus());
+
+    fake_modbus::removeSlave(2);
+
+    for (uint32_t i = 0; i < kDownAfterFailures; i++) {
+        EXPECT_FALSE(ctrl.pollBus());
+    }
+    EXPECT_EQ(ctrl.getSlaveHealth(1), SlaveHealth::HEALTHY);
+    EXPECT_EQ(ctrl.getSlaveHealth(2), SlaveHealth::DOWN);
+
+    ASSERT_EQ(transitions.size(), 2u);
+    EXPECT_EQ(transitions[0].slave, 2);
+    EXPECT_EQ(transitions[0].previous, SlaveHealth::HEALTHY);
+    EXPECT_EQ(transitions[0].health, SlaveHealth::SUSPECT);
+    EXPECT_EQ(transitions[1].previous, SlaveHealth::SUSPECT);
+    EXPECT_EQ(transitions[1].health, SlaveHealth::DOWN);
+
+    // Until the probe is due, a round costs no response timeout and reads the healthy slave only
+    fake_modbus::clearOperations();
+
+    const auto round_start = Clock::now();
+    EXPECT_TRUE(ctrl.pollBus());
+    EXPECT_LT(Clock::now() - round_start, chrono::milliseconds(50));
+
+    EXPECT_EQ(countOperations(1, fake_modbus::OperationKind::READ), 1u);
+    EXPECT_EQ(countOperations(2, fake_modbus::OperationKind::READ), 0u);
+
+    // Commands to the down slave fail without touching the bus
+    EXPECT_FALSE(ctrl.grpOpen(2));
+    EXPECT_EQ(countOperations(2, fake_modbus::OperationKind::WRITE), 0u);
+    EXPECT_TRUE(ctrl.grpOpen(1));
+
+    // Plugged in again, the next probe brings it back
+    fake_modbus::addSlave(2);
+    this_thread::sleep_for(kProbeBackoffMin);
+
+    EXPECT_TRUE(ctrl.pollBus());
+    EXPECT_EQ(ctrl.getSlaveHealth(2), SlaveHealth::HEALTHY);
+
+    ASSERT_EQ(transitions.size(), 3u);
+    EXPECT_EQ(transitions[2].previous, SlaveHealth::DOWN);
+    EXPECT_EQ(transitions[2].health, SlaveHealth::HEALTHY);
+}
+
+TEST(DatcCtrlSlaveHealth, SelectedSlaveKeepsItsStateWhenThePollListChanges) {
+    fake_modbus::reset();
+    fake_modbus::addSlave(1);
+    fake_modbus::addSlave(2);
+    fake_modbus::addSlave(3);
+
+    DatcCtrl ctrl;
+    ASSERT_TRUE(ctrl.modbusInit("/dev/fake", 1, 115200));
+    ctrl.setPollSlaves({1, 2, 3});
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(ctrl.pollBus());
+    }
+
+    fake_modbus::removeSlave(1);
+    EXPECT_FALSE(ctrl.pollBus());
+    ASSERT_EQ(ctrl.getSlaveHealth(1), SlaveHealth::SUSPECT);
+
+    const uint32_t seq = ctrl.getStatusSnapshot(1).seq;
+    ASSERT_GT(seq, 0u);
+
+    // Slave 1 is still polled as the selected one, slave 3 is not polled any more
+    ctrl.setPollSlaves({2});
+
+    EXPECT_EQ(ctrl.getSlaveHealth(1), SlaveHealth::SUSPECT);
+    EXPECT_EQ(ctrl.getStatusSnapshot(1).seq, seq);
+    EXPECT_EQ(ctrl.getStatusSnapshot(3).seq, 0u);
+
+    fake_modbus::addSlave(1);
+    EXPECT_TRUE(ctrl.pollBus());
+    EXPECT_EQ(ctrl.getStatusSnapshot(1).seq, seq + 1);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file test_status_encoder.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief StatusEncoder against Json::FastWriter byte for byte, and its allocations
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include "alloc_counter.hpp"
+#include "status_encoder.hpp"
+
+namespace {
+
+/**
+ * @brief The Json::Value sendStatus built before the encoder.
+ */
+string fastWriter(const DatcStatus &status, bool with_address, uint16_t bus_id, uint16_t slave_addr, uint32_t field_mask) {
+    Json::Value json;
+
+    if (field_mask & (1 << (int) StatusField::FINGER_POS)) json["finger_pos"] = status.finger_pos;
+    if (field_mask & (1 << (int) StatusField::MOTOR_CUR))  json["motor_cur"]  = status.motor_cur;
+    if (field_mask & (1 << (int) StatusField::MOTOR_POS))  json["motor_pos"]  = status.motor_pos;
+    if (field_mask & (1 << (int) StatusField::MOTOR_VEL))  json["motor_vel"]  = status.motor_vel;
+    if (field_mask & (1 << (int) StatusField::STATES))     json["states"]     = status.states;
+    if (field_mask & (1 << (int) StatusField::VOLTAGE))    json["voltage"]    = status.voltage;
+
+    if (with_address) {
+        json["bus"]   = bus_id;
+        json["slave"] = slave_addr;
+    }
+
+    Json::FastWriter writer;
+    return writer.write(json);
+}
+
+vector<DatcStatus> sampleStatuses() {
+    vector<DatcStatus> statuses(4);
+
+    statuses[1].motor_pos  = 1234;
+    statuses[1].motor_cur  = -56;
+    statuses[1].motor_vel  = 789;
+    statuses[1].finger_pos = 5000;
+    statuses[1].voltage    = 240;
+    statuses[1].states     = 0x0061;
+
+    statuses[2].motor_pos  = numeric_limits<int16_t>::min();
+    statuses[2].motor_cur  = numeric_limits<int16_t>::min();
+    statuses[2].motor_vel  = numeric_limits<int16_t>::min();
+    statuses[2].finger_pos = numeric_limits<uint16_t>::max();
+    statuses[2].voltage    = numeric_limits<uint16_t>::max();
+    statuses[2].states     = numeric_limits<uint16_t>::max();
+
+    statuses[3].motor_pos  = numeric_limits<int16_t>::max();
+    statuses[3].motor_cur  = numeric_limits<int16_t>::max();
+    statuses[3].motor_vel  = -1;
+    statuses[3].finger_pos = 10000;
+    statuses[3].voltage    = 1;
+    statuses[3].states     = 0x0200;
+
+    return statuses;
+}
+
+} // namespace
+
+TEST(StatusEncoder, JsonMatchesFastWriter) {
+    StatusEncoder encoder;
+
+    for (const auto &status : sampleStatuses()) {
+        EXPECT_EQ(*encoder.encodeJson(status), fastWriter(status, false, 0, 0, kAllStatusFields));
+        EXPECT_EQ(*encoder.encodeJson(status, true, 3, 247), fastWriter(status, true, 3, 247, kAllStatusFields));
+        EXPECT_EQ(*encoder.encodeJson(status, true, 65535, 1), fastWriter(status, true, 65535, 1, kAllStatusFields));
+    }
+}
+
+TEST(StatusEncoder, JsonMatchesFastWriterForEveryFieldMask) {
+    StatusEncoder encoder;
+    const DatcStatus status = sampleStatuses()[1];
+
+    for (uint32_t mask = 1; mask <= kAllStatusFields; mask++) {
+        EXPECT_EQ(*encoder.encodeJson(status, false, 0, 0, mask), fastWriter(status, false, 0, 0, mask)) << "mask " << mask;
+        EXPECT_EQ(*encoder.encodeJson(status, true, 2, 9, mask), fastWriter(status, true, 2, 9, mask)) << "mask " << mask;
+    }
+}
+
+TEST(StatusEncoder, HeldFramesAreNotReused) {
+    StatusEncoder encoder;
+    DatcStatus status;
+
+    status.finger_pos = 1;
+    OutboundMessage first = encoder.encodeJson(status);
+
+    status.finger_pos = 2;
+    OutboundMessage second = encoder.encodeJson(status);
+
+    EXPECT_NE(first.get(), second.get());
+    EXPECT_NE(first->find("\"finger_pos\":1,"), string::npos);
+
+    // Released, the buffer goes back to the pool
+    const string *released = first.get();
+    first.reset();
+    EXPECT_EQ(encoder.encodeJson(status).get(), released);
+}
+
+TEST(StatusEncoder, NoAllocationInSteadyState) {
+    StatusEncoder encoder;
+    const auto statuses = sampleStatuses();
+
+    // Clients hold the last few frames in their queues at any time
+    array<OutboundMessage, 8> queued;
+
+    auto tick = [&] (size_t i) {
+        const DatcStatus &status = statuses[i % statuses.size()];
+
+        queued[(2 * i) % queued.size()]     = encoder.encodeJson(status, true, 1, (uint16_t) (i % 16));
+        queued[(2 * i + 1) % queued.size()] = encoder.encodeBinary(status, 1, (uint16_t) (i % 16), (uint32_t) i, i);
+    };
+
+    for (size_t i = 0; i < 100; i++) {
+        tick(i);
+    }
+
+    const uint64_t before = threadAllocations();
+    for (size_t i = 0; i < 10000; i++) {
+        tick(i);
+    }
+
+    EXPECT_EQ(threadAllocations() - before, 0u);
+}
@@ -0,0 +1,165 @@
+/**
+ * @file test_status_subscription.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Subscription parsing, field projection and decimation, and the frames a subscription keeps across ticks
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "status_subscription.hpp"
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+Json::Value parse(const string &text) {
+    Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+
+    Json::Value json;
+    reader->parse(text.data(), text.data() + text.size(), &json, nullptr);
+    return json;
+}
+
+DatcStatusSnapshot snapshot(uint16_t finger_pos, int16_t motor_cur = 0, uint32_t seq = 1) {
+    DatcStatusSnapshot snapshot;
+
+    snapshot.status.finger_pos = finger_pos;
+    snapshot.status.motor_cur  = motor_cur;
+    snapshot.status.states     = 0x0021;
+    snapshot.seq               = seq;
+
+    return snapshot;
+}
+
+/**
+ * @brief Publishes one tick to every client and returns what each client received.
+ */
+map<uint32_t, OutboundMessage> publish(MessageHandler<Json::Value> &handler, const vector<uint32_t> &clients,
+                                       uint32_t device_key, const DatcStatusSnapshot &snapshot, int &shared_encodes) {
+    StatusEncoder encoder;
+
+    handler.publishToClientQueue(
+        [&] (Subscription *subscription) {
+            return !subscription || static_cast<StatusSubscription *>(subscription)->shouldPublish(device_key, snapshot.status, Clock::now());
+        },
+        [&] (WireFormat format, Subscription *subscription) {
+            if (subscription) {
+                return static_cast<StatusSubscription *>(subscription)->encode(device_key, format, snapshot, false);
+            }
+
+            shared_encodes++;
+            return encoder.encodeJson(snapshot.status);
+        });
+
+    map<uint32_t, OutboundMessage> received;
+    for (auto id : clients) {
+        OutboundMessage message;
+        if (handler.tryPopFromClientQueue(id, message)) {
+            received[id] = message;
+        }
+    }
+    return received;
+}
+
+} // namespace
+
+TEST(StatusSubscription, ParsesFieldsAndDecimation) {
+    const PublishPolicy policy = StatusSubscription::parsePolicy(
+        parse("{\"fields\":[\"states\",\"finger_pos\",\"bogus\"],\"decimation\":0,\"deadband\":{\"finger_pos\":-20,\"states\":5}}"));
+
+    EXPECT_EQ(policy.field_mask, (1u << (int) StatusField::STATES) | (1u << (int) StatusField::FINGER_POS));
+    EXPECT_EQ(policy.decimation, 1u);
+    EXPECT_EQ(policy.deadband[(size_t) StatusField::FINGER_POS], 20);
+    EXPECT_EQ(policy.deadband[(size_t) StatusField::STATES], 0);
+}
+
+TEST(StatusSubscription, DecimationCountsPerDevice) {
+    PublishPolicy policy;
+    policy.decimation = 3;
+    StatusSubscription subscription(policy);
+
+    const auto now = Clock::now();
+    string sent;
+
+    for (int i = 0; i < 6; i++) {
+        sent += subscription.shouldPublish(StatusSubscription::deviceKey(1, 1), snapshot(0).status, now) ? '1' : '0';
+        sent += subscription.shouldPublish(StatusSubscription::deviceKey(1, 2), snapshot(0).status, now) ? '1' : '0';
+    }
+    EXPECT_EQ(sent, "110000110000");
+}
+
+TEST(StatusSubscription, ProjectsTheRequestedFields) {
+    StatusSubscription subscription(StatusSubscription::parsePolicy(parse("{\"fields\":[\"states\",\"finger_pos\"]}")));
+
+    const auto message = subscription.encode(StatusSubscription::deviceKey(2, 7), WireFormat::JSON, snapshot(4000), true);
+    EXPECT_EQ(*message, "{\"bus\":2,\"finger_pos\":4000,\"slave\":7,\"states\":33}\n");
+}
+
+TEST(StatusSubscription, KeepsTheJsonFrameWhileTheStatusIsUnchanged) {
+    StatusSubscription subscription(StatusSubscription::parsePolicy(parse("{\"fields\":[\"finger_pos\"]}")));
+    const uint32_t device_key = StatusSubscription::deviceKey(1, 1);
+
+    const auto first = subscription.encode(device_key, WireFormat::JSON, snapshot(4000, 0, 1), false);
+
+    // A new read with the same status, and a change of a field the client did not ask for
+    EXPECT_EQ(subscription.encode(device_key, WireFormat::JSON, snapshot(4000, 0, 2), false), first);
+    EXPECT_EQ(subscription.encode(device_key, WireFormat::JSON, snapshot(4000, 50, 3), false), first);
+
+    const auto moved = subscription.encode(device_key, WireFormat::JSON, snapshot(4001, 50, 4), false);
+    EXPECT_NE(moved, first);
+    EXPECT_EQ(*moved, "{\"finger_pos\":4001}\n");
+
+    // Another device has its own frame
+    const auto other = subscription.encode(StatusSubscription::deviceKey(1, 2), WireFormat::JSON, snapshot(4001, 50, 4), false);
+    EXPECT_NE(other, moved);
+    EXPECT_EQ(*other, *moved);
+
+    // The frame kept by the subscription is not handed out again by its encoder
+    EXPECT_EQ(*first, "{\"finger_pos\":4000}\n");
+}
+
+TEST(StatusSubscription, BinaryFramesAreAlwaysNew) {
+    StatusSubscription subscription((PublishPolicy()));
+    const uint32_t device_key = StatusSubscription::deviceKey(1, 1);
+
+    const auto first  = subscription.encode(device_key, WireFormat::BINARY, snapshot(4000, 0, 1), false);
+    const auto second = subscription.encode(device_key, WireFormat::BINARY, snapshot(4000, 0, 2), false);
+
+    EXPECT_NE(first, second);
+    EXPECT_NE(*first, *second);
+}
+
+TEST(StatusSubscription, PublishSharesOnlyBetweenClientsWithoutSubscription) {
+    MessageHandler<Json::Value> handler;
+    const vector<uint32_t> clients = {1, 2, 3, 4};
+
+    for (auto id : clients) {
+        ASSERT_TRUE(handler.createClientQueue(id));
+    }
+
+    const PublishPolicy policy = StatusSubscription::parsePolicy(parse("{\"fields\":[\"finger_pos\"]}"));
+    ASSERT_TRUE(handler.setClientSubscription(3, make_shared<StatusSubscription>(policy)));
+    ASSERT_TRUE(handler.setClientSubscription(4, make_shared<StatusSubscription>(policy)));
+
+    const uint32_t device_key = StatusSubscription::deviceKey(0, 1);
+    int shared_encodes = 0;
+
+    auto first = publish(handler, clients, device_key, snapshot(4000, 0, 1), shared_encodes);
+    ASSERT_EQ(first.size(), 4u);
+    EXPECT_EQ(shared_encodes, 1);
+    EXPECT_EQ(first[1], first[2]);
+    EXPECT_NE(first[3], first[4]);
+    EXPECT_EQ(*first[3], "{\"finger_pos\":4000}\n");
+
+    // Next tick, same status: each subscription sends its kept frame again
+    auto second = publish(handler, clients, device_key, snapshot(4000, 0, 2), shared_encodes);
+    ASSERT_EQ(second.size(), 4u);
+    EXPECT_EQ(shared_encodes, 2);
+    EXPECT_EQ(second[3], first[3]);
+    EXPECT_EQ(second[4], first[4]);
+}
@@ -0,0 +1,230 @@
+/**
+ * @file test_tcp_server.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Loopback clients of one TcpServer: publishing to hundreds of them, a protocol switch and a full worker queue
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "tcp_manager.hpp"
+
+namespace {
+
+const int kTestPort = 18422;
+
+int threadCount() {
+    ifstream status("/proc/self/status");
+    string line;
+
+    while (getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            return stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+template<typename Predicate>
+bool waitFor(Predicate predicate, chrono::milliseconds timeout) {
+    const auto deadline = chrono::steady_clock::now() + timeout;
+
+    while (!predicate()) {
+        if (chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(TcpServer, PublishesToHundredsOfClientsWithoutThreadPerClient) {
+    const size_t kClients  = 300;
+    const int kMessages    = 50;
+
+    auto &manager = MessageManager<Json::Value>::getInstance();
+    TcpServer server(kTestPort, 2);
+
+    const int threads_before = threadCount();
+
+    boost::asio::io_service io_service;
+    vector<unique_ptr<boost::asio::ip::tcp::socket>> clients;
+    const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), kTestPort);
+
+    for (size_t i = 0; i < kClients; i++) {
+        clients.push_back(make_unique<boost::asio::ip::tcp::socket>(io_service));
+        clients.back()->connect(endpoint);
+    }
+
+    ASSERT_TRUE(waitFor([&] {return manager.getAllClientId().size() == kClients;}, chrono::seconds(10)));
+
+    // Writes are async_write chains on the io threads, a client adds no thread
+    EXPECT_EQ(threadCount(), threads_before);
+
+    string expected;
+    for (int i = 0; i < kMessages; i++) {
+        const string message = "{\"seq\":" + to_string(i) + "}\n";
+        expected += message;
+        manager.pushToAllClientQueue(make_shared<const string>(message));
+    }
+
+    for (auto &client : clients) {
+        client->non_blocking(true);
+    }
+
+    // Every client gets every message once and in order
+    vector<string> received(kClients);
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    size_t complete = 0;
+    char buffer[4096];
+
+    while (complete < kClients && chrono::steady_clock::now() < deadline) {
+        complete = 0;
+
+        for (size_t i = 0; i < kClients; i++) {
+            boost::system::error_code ec;
+            const size_t size = clients[i]->read_some(boost::asio::buffer(buffer), ec);
+
+            if (!ec) {
+                received[i].append(buffer, size);
+            }
+            if (received[i].size() >= expected.size()) {
+                complete++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < kClients; i++) {
+        EXPECT_EQ(received[i], expected) << "Client " << i;
+    }
+
+    for (auto &client : clients) {
+        client->close();
+    }
+
+    EXPECT_TRUE(waitFor([&] {return manager.getAllClientId().empty();}, chrono::seconds(10)));
+}
+
+TEST(TcpServer, ProtocolAckIsTheLastFrameInTheOldFormat) {
+    const int kPort = kTestPort + 1;
+    const string padding(64 * 1024, 'x');
+
+    auto &manager = MessageManager<Json::Value>::getInstance();
+    TcpServer server(kPort, 1);
+
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::socket client(io_service);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), kPort));
+
+    ASSERT_TRUE(waitFor([&] {return manager.getAllClientId().size() == 1;}, chrono::seconds(10)));
+
+    int seq = 0;
+    auto publish = [&] {
+        manager.publishToAllClientQueue([&] (WireFormat format) {
+            return make_shared<const string>(format == WireFormat::JSON ?
+                "{\"seq\":" + to_string(seq) + ",\"pad\":\"" + padding + "\"}\n" : "BINARY " + to_string(seq) + "\n");
+        });
+        seq++;
+    };
+
+    // More than the socket buffers take while the client does not read, the rest stays queued
+    for (int i = 0; i < 200; i++) {
+        publish();
+    }
+
+    boost::asio::write(client, boost::asio::buffer(string("{\"protocol\":\"binary\"}\n")));
+    this_thread::sleep_for(chrono::milliseconds(200));
+
+    for (int i = 0; i < 10; i++) {
+        publish();
+    }
+
+    // Reads until the last binary frame
+    const string last = "BINARY " + to_string(seq - 1) + "\n";
+    string received;
+    char buffer[65536];
+
+    client.non_blocking(true);
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+
+    while (chrono::steady_clock::now() < deadline &&
+           (received.size() < last.size() || received.compare(received.size() - last.size(), last.size(), last) != 0)) {
+        boost::system::error_code ec;
+        const size_t size = client.read_some(boost::asio::buffer(buffer), ec);
+
+        if (!ec) {
+            received.append(buffer, size);
+        }
+    }
+
+    const size_t ack = received.find("{\"protocol\":\"binary\"}\n");
+    ASSERT_NE(ack, string::npos);
+
+    EXPECT_EQ(received.find("{\"seq\"", ack), string::npos) << "Json status after the ack";
+    EXPECT_EQ(received.find("BINARY"), received.find("\n", ack) + 1);
+    EXPECT_LT(received.find("BINARY"), string::npos);
+
+    client.close();
+    EXPECT_TRUE(waitFor([&] {return manager.getAllClientId().empty();}, chrono::seconds(10)));
+}
+
+TEST(TcpServer, CommandRefusedByAFullWorkerQueueIsAnswered) {
+    const int kPort = kTestPort + 2;
+    const int kCommands = (int) kWorkerQueueCapacity + 10;
+
+    auto &manager = MessageManager<Json::Value>::getInstance();
+    TcpServer server(kPort, 1);
+
+    Json::Value json;
+    while (manager.tryPopFromWokerQueue(json)) {}
+    const uint64_t dropped_before = manager.getWorkerQueueDropped();
+
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::socket client(io_service);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), kPort));
+
+    // Nothing takes from the worker queue
+    string commands;
+    for (int id = 0; id < kCommands; id++) {
+        commands += "{\"command\":102,\"id\":" + to_string(id) + "}\n";
+    }
+    boost::asio::write(client, boost::asio::buffer(commands));
+
+    ASSERT_TRUE(waitFor([&] {return manager.getWorkerQueueDropped() - dropped_before == 10;}, chrono::seconds(10)));
+
+    string received;
+    char buffer[4096];
+    client.non_blocking(true);
+
+    ASSERT_TRUE(waitFor([&] {
+        boost::system::error_code ec;
+        const size_t size = client.read_some(boost::asio::buffer(buffer), ec);
+        if (!ec) {
+            received.append(buffer, size);
+        }
+        return count(received.begin(), received.end(), '\n') == 10;
+    }, chrono::seconds(10)));
+
+    // The commands past the capacity, each with its id
+    for (int id = (int) kWorkerQueueCapacity; id < kCommands; id++) {
+        EXPECT_NE(received.find("\"id\":" + to_string(id) + ","), string::npos) << "id " << id;
+    }
+    EXPECT_EQ(received.find("\"id\":" + to_string(kWorkerQueueCapacity - 1) + ","), string::npos);
+    EXPECT_NE(received.find("\"reason\":\"busy\""), string::npos);
+
+    int queued = 0;
+    while (manager.tryPopFromWokerQueue(json)) {
+        queued++;
+    }
+    EXPECT_EQ(queued, (int) kWorkerQueueCapacity);
+
+    client.close();
+    EXPECT_TRUE(waitFor([&] {return manager.getAllClientId().empty();}, chrono::seconds(10)));
+}
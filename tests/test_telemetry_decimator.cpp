@@ -0,0 +1,146 @@
+/**
+ * @file test_telemetry_decimator.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Min/max decimation of TelemetryDecimator against the samples of each column's time slice
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "telemetry_decimator.hpp"
+
+namespace {
+
+const uint64_t kSampleUs = 2000; // 500 Hz
+
+TelemetrySample sample(uint64_t timestamp_us, int32_t value) {
+    TelemetrySample sample;
+    sample.timestamp_us = timestamp_us;
+    sample.values.fill(value);
+    sample.values[(size_t) TelemetryChannel::VOLTAGE] = -value;
+    return sample;
+}
+
+} // namespace
+
+TEST(TelemetryDecimator, ColumnKeepsMinMaxFirstAndLast) {
+    TelemetryDecimator decimator;
+    decimator.reset(10, 10000);
+    ASSERT_EQ(decimator.getSliceUs(), 1000u);
+    EXPECT_TRUE(decimator.isEmpty());
+
+    for (int32_t value : {5, -3, 9, 2}) {
+        decimator.addSample(sample(50100, value));
+    }
+
+    const auto *column = decimator.column(decimator.getWidth() - 1);
+    ASSERT_NE(column, nullptr);
+
+    const size_t motor_pos = (size_t) TelemetryChannel::MOTOR_POS;
+    EXPECT_EQ(column->min[motor_pos], -3);
+    EXPECT_EQ(column->max[motor_pos], 9);
+    EXPECT_EQ(column->first[motor_pos], 5);
+    EXPECT_EQ(column->last[motor_pos], 2);
+
+    // Channels are decimated independently
+    const size_t voltage = (size_t) TelemetryChannel::VOLTAGE;
+    EXPECT_EQ(column->min[voltage], -9);
+    EXPECT_EQ(column->max[voltage], 3);
+}
+
+TEST(TelemetryDecimator, ColumnsScrollWithTime) {
+    TelemetryDecimator decimator;
+    decimator.reset(4, 4000);
+
+    decimator.addSample(sample(10000, 1));
+    decimator.addSample(sample(12000, 2));
+
+    // Slices 10 and 12 are the last column and two before it, slice 11 had no sample
+    ASSERT_NE(decimator.column(1), nullptr);
+    EXPECT_EQ(decimator.column(1)->last[0], 1);
+    EXPECT_EQ(decimator.column(2), nullptr);
+    EXPECT_EQ(decimator.column(3)->last[0], 2);
+    EXPECT_EQ(decimator.column(0), nullptr);
+
+    // Late sample inside the window still lands in its own column
+    decimator.addSample(sample(11500, 7));
+    EXPECT_EQ(decimator.column(2)->last[0], 7);
+
+    // Older than the window
+    decimator.addSample(sample(8000, 100));
+    EXPECT_EQ(decimator.column(0), nullptr);
+
+    // A gap longer than the window leaves only the new sample
+    decimator.addSample(sample(30000, 3));
+    for (int x = 0; x < 3; x++) {
+        EXPECT_EQ(decimator.column(x), nullptr) << "x " << x;
+    }
+    EXPECT_EQ(decimator.column(3)->last[0], 3);
+}
+
+TEST(TelemetryDecimator, MinutesOfSamplesMatchTheRawWindow) {
+    const int width            = 800;
+    const uint64_t window_us   = 10000000;
+    const uint64_t duration_us = 180000000; // 3 minutes at 500 Hz
+
+    TelemetryDecimator decimator;
+    decimator.reset(width, window_us);
+
+    mt19937 random(1);
+    uniform_int_distribution<int32_t> noise(-1000, 1000);
+    vector<TelemetrySample> samples;
+
+    for (uint64_t t = 0; t < duration_us; t += kSampleUs) {
+        samples.push_back(sample(t, noise(random)));
+        decimator.addSample(samples.back());
+    }
+
+    // Brute force min/max of the samples falling into each slice of the window
+    const uint64_t slice_us     = decimator.getSliceUs();
+    const int64_t latest_slice  = (int64_t) (samples.back().timestamp_us / slice_us);
+    const int64_t oldest_slice  = latest_slice - width + 1;
+
+    vector<int32_t> low(width, INT32_MAX), high(width, INT32_MIN);
+    vector<int> count(width, 0);
+
+    for (auto &raw : samples) {
+        const int64_t slice = (int64_t) (raw.timestamp_us / slice_us);
+
+        if (slice >= oldest_slice) {
+            const int x = (int) (slice - oldest_slice);
+            low[x]  = min(low[x], raw.values[0]);
+            high[x] = max(high[x], raw.values[0]);
+            count[x]++;
+        }
+    }
+
+    for (int x = 0; x < width; x++) {
+        const auto *column = decimator.column(x);
+
+        if (count[x] == 0) {
+            EXPECT_EQ(column, nullptr) << "x " << x;
+            continue;
+        }
+
+        ASSERT_NE(column, nullptr) << "x " << x;
+        EXPECT_EQ(column->min[0], low[x]) << "x " << x;
+        EXPECT_EQ(column->max[0], high[x]) << "x " << x;
+    }
+}
+
+TEST(TelemetryDecimator, ResetDropsTheColumns) {
+    TelemetryDecimator decimator;
+    decimator.reset(100, 1000000);
+    decimator.addSample(sample(5000000, 1));
+    ASSERT_FALSE(decimator.isEmpty());
+
+    decimator.reset(0, 1000000);
+    EXPECT_TRUE(decimator.isEmpty());
+    EXPECT_EQ(decimator.getWidth(), 1);
+    EXPECT_EQ(decimator.column(0), nullptr);
+}
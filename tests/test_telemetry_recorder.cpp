@@ -0,0 +1,289 @@
+/**
+ * @file test_telemetry_recorder.cpp
+ * @author Inhwan Yoon (inhwan94@korea.ac.kr)
+ * @brief Segment files of TelemetryRecorder read back: header, records, rotation by size and by age
+ * @version 1.0
+ * @date 2023-11-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+#include "datc_ctrl.hpp"
+#include "fake_modbus.hpp"
+#include "telemetry_recorder.hpp"
+
+namespace {
+
+struct SegmentFile {
+    string name;
+    RecorderFileHeader header = {};
+    vector<array<uint8_t, kRecordSize>> records;
+};
+
+StatusRecord statusRecord(uint16_t slave, uint32_t seq) {
+    StatusRecord record = {};
+
+    record.timestamp_us = 1000000 + seq * 2000;
+    record.type         = RecordType::STATUS;
+    record.slave_addr   = slave;
+    record.seq          = seq;
+    record.states       = 0x0021;
+    record.motor_pos    = (int16_t) seq;
+    record.motor_vel    = -7;
+    record.motor_cur    = -(int16_t) (seq % 300);
+    record.finger_pos   = (uint16_t) (seq % 10000);
+    record.voltage      = 240;
+
+    return record;
+}
+
+template<typename Record>
+Record recordAt(const SegmentFile &segment, size_t index) {
+    Record record;
+    memcpy(&record, segment.records[index].data(), kRecordSize);
+    return record;
+}
+
+class TelemetryRecorderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const auto *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        directory_ = (filesystem::temp_directory_path() / (string("datc_recorder_") + info->name())).string();
+        filesystem::remove_all(directory_);
+
+        config_.directory      = directory_;
+        config_.bus_id         = 3;
+        config_.port_name      = "/dev/ttyUSB0";
+        config_.baudrate       = 115200;
+        config_.selected_slave = 2;
+        config_.poll_slaves    = {1, 2, 5};
+        config_.segment_size   = kRecorderSegmentMinSize;
+    }
+
+    void TearDown() override {
+        filesystem::remove_all(directory_);
+    }
+
+    /**
+     * @brief Every segment of the directory in recording order, records up to the first unwritten one.
+     */
+    vector<SegmentFile> readSegments() {
+        vector<SegmentFile> segments;
+
+        for (auto &entry : filesystem::directory_iterator(directory_)) {
+            SegmentFile segment;
+            segment.name = entry.path().filename().string();
+
+            ifstream file(entry.path(), ios::binary);
+            file.read((char *) &segment.header, sizeof(RecorderFileHeader));
+
+            array<uint8_t, kRecordSize> record;
+            while (file.read((char *) record.data(), kRecordSize) && record[8] != (uint8_t) RecordType::NONE) {
+                segment.records.push_back(record);
+            }
+
+            segments.push_back(move(segment));
+        }
+
+        sort(segments.begin(), segments.end(), [] (const SegmentFile &a, const SegmentFile &b) {return a.name < b.name;});
+        return segments;
+    }
+
+    /**
+     * @brief Appends, retrying while the next segment is being prepared.
+     * @return Failed attempts
+     */
+    uint64_t appendRetrying(TelemetryRecorder &recorder, const StatusRecord &record) {
+        uint64_t failed = 0;
+
+        while (!recorder.append(record)) {
+            failed++;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        return failed;
+    }
+
+    string directory_;
+    RecorderConfig config_;
+};
+
+} // namespace
+
+TEST_F(TelemetryRecorderTest, RecordsReadBackWithTheHeader) {
+    TelemetryRecorder recorder;
+    ASSERT_TRUE(recorder.start(config_));
+
+    for (uint32_t seq = 1; seq <= 100; seq++) {
+        ASSERT_TRUE(recorder.append(statusRecord(1 + seq % 2, seq)));
+    }
+
+    CommandRecord command = {};
+    command.timestamp_us = 5000000;
+    command.type         = RecordType::COMMAND;
+    command.result       = 1;
+    command.slave_addr   = 2;
+    command.reg_num      = 2;
+    command.regs[0]      = 104;
+    command.regs[1]      = 6000;
+    ASSERT_TRUE(recorder.append(command));
+
+    const RecorderStats stats = recorder.getStats();
+    EXPECT_EQ(stats.records, 101u);
+    EXPECT_EQ(stats.segments, 1u);
+    EXPECT_EQ(stats.dropped, 0u);
+
+    recorder.stop();
+
+    // The segment prepared ahead was never written and is removed
+    const auto segments = readSegments();
+    ASSERT_EQ(segments.size(), 1u);
+    EXPECT_EQ(segments[0].name, stats.file_name);
+
+    const RecorderFileHeader &header = segments[0].header;
+    EXPECT_EQ(memcmp(header.magic, kRecorderMagic, sizeof(kRecorderMagic)), 0);
+    EXPECT_EQ(header.version, kRecorderVersion);
+    EXPECT_EQ(header.header_size, sizeof(RecorderFileHeader));
+    EXPECT_EQ(header.record_size, kRecordSize);
+    EXPECT_EQ(header.bus_id, 3);
+    EXPECT_EQ(header.baudrate, 115200u);
+    EXPECT_EQ(header.segment_index, 0u);
+    EXPECT_EQ(header.record_count, 101u);
+    EXPECT_EQ(header.selected_slave, 2);
+    EXPECT_STREQ(header.port_name, "/dev/ttyUSB0");
+    ASSERT_EQ(header.poll_slave_num, 3);
+    EXPECT_EQ(header.poll_slaves[2], 5);
+    EXPECT_GT(header.unix_time_us, 0u);
+
+    // Truncated to the records on close
+    EXPECT_EQ(filesystem::file_size(filesystem::path(directory_) / segments[0].name),
+              sizeof(RecorderFileHeader) + 101 * kRecordSize);
+
+    ASSERT_EQ(segments[0].records.size(), 101u);
+
+    for (uint32_t seq = 1; seq <= 100; seq++) {
+        const StatusRecord expected = statusRecord(1 + seq % 2, seq);
+        const StatusRecord read     = recordAt<StatusRecord>(segments[0], seq - 1);
+        EXPECT_EQ(memcmp(&read, &expected, kRecordSize), 0) << "seq " << seq;
+    }
+
+    const CommandRecord read = recordAt<CommandRecord>(segments[0], 100);
+    EXPECT_EQ(read.type, RecordType::COMMAND);
+    EXPECT_EQ(read.result, 1);
+    EXPECT_EQ(read.regs[0], 104);
+    EXPECT_EQ(read.regs[1], 6000);
+}
+
+TEST_F(TelemetryRecorderTest, FullSegmentRotatesWithoutLosingOrder) {
+    const uint64_t capacity = (kRecorderSegmentMinSize - sizeof(RecorderFileHeader)) / kRecordSize;
+    const uint32_t total    = (uint32_t) (capacity * 5 / 2);
+
+    TelemetryRecorder recorder;
+    ASSERT_TRUE(recorder.start(config_));
+
+    uint64_t failed = 0;
+    for (uint32_t seq = 1; seq <= total; seq++) {
+        failed += appendRetrying(recorder, statusRecord(1, seq));
+    }
+
+    const RecorderStats stats = recorder.getStats();
+    recorder.stop();
+
+    EXPECT_EQ(stats.records, total);
+    EXPECT_EQ(stats.segments, 3u);
+    EXPECT_EQ(stats.dropped, failed);
+
+    const auto segments = readSegments();
+    ASSERT_EQ(segments.size(), 3u);
+
+    uint32_t expected_seq = 1;
+
+    for (uint32_t index = 0; index < segments.size(); index++) {
+        EXPECT_EQ(segments[index].header.segment_index, index);
+        EXPECT_EQ(segments[index].header.record_count, segments[index].records.size());
+        EXPECT_EQ(segments[index].records.size(), (index < 2) ? capacity : total - 2 * capacity);
+
+        for (size_t i = 0; i < segments[index].records.size(); i++) {
+            ASSERT_EQ(recordAt<StatusRecord>(segments[index], i).seq, expected_seq++);
+        }
+    }
+
+    EXPECT_EQ(expected_seq, total + 1);
+}
+
+TEST_F(TelemetryRecorderTest, OldSegmentRotates) {
+    config_.segment_duration = chrono::seconds(1);
+
+    TelemetryRecorder recorder;
+    ASSERT_TRUE(recorder.start(config_));
+    ASSERT_TRUE(recorder.append(statusRecord(1, 1)));
+
+    // Rotated by the background thread at its first wake-up after the segment expired
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (recorder.getStats().segments < 2 && chrono::steady_clock::now() < deadline) {
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    ASSERT_EQ(recorder.getStats().segments, 2u);
+
+    ASSERT_TRUE(recorder.append(statusRecord(1, 2)));
+    recorder.stop();
+
+    const auto segments = readSegments();
+    ASSERT_EQ(segments.size(), 2u);
+    ASSERT_EQ(segments[0].records.size(), 1u);
+    ASSERT_EQ(segments[1].records.size(), 1u);
+    EXPECT_EQ(recordAt<StatusRecord>(segments[1], 0).seq, 2u);
+}
+
+TEST_F(TelemetryRecorderTest, AppendAfterStopIsDropped) {
+    TelemetryRecorder recorder;
+    EXPECT_FALSE(recorder.append(statusRecord(1, 1)));
+
+    ASSERT_TRUE(recorder.start(config_));
+    recorder.stop();
+
+    EXPECT_FALSE(recorder.append(statusRecord(1, 1)));
+}
+
+TEST_F(TelemetryRecorderTest, DatcCtrlRecordsPollsAndCommands) {
+    fake_modbus::reset();
+    fake_modbus::addSlave(1, 5000);
+
+    DatcCtrl ctrl;
+    ASSERT_TRUE(ctrl.modbusInit("/dev/fake", 1, 115200));
+    ASSERT_TRUE(ctrl.startRecording(4, directory_));
+
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(ctrl.pollBus());
+    }
+    ASSERT_TRUE(ctrl.setFingerPos(7000, 1));
+
+    ctrl.stopRecording();
+
+    const auto segments = readSegments();
+    ASSERT_EQ(segments.size(), 1u);
+    EXPECT_EQ(segments[0].header.bus_id, 4);
+    EXPECT_STREQ(segments[0].header.port_name, "/dev/fake");
+    ASSERT_EQ(segments[0].records.size(), 6u);
+
+    for (size_t i = 0; i < 5; i++) {
+        const StatusRecord status = recordAt<StatusRecord>(segments[0], i);
+        EXPECT_EQ(status.type, RecordType::STATUS);
+        EXPECT_EQ(status.slave_addr, 1);
+        EXPECT_EQ(status.finger_pos, 5000);
+        EXPECT_EQ(status.seq, recordAt<StatusRecord>(segments[0], 0).seq + i);
+    }
+
+    const CommandRecord command = recordAt<CommandRecord>(segments[0], 5);
+    EXPECT_EQ(command.type, RecordType::COMMAND);
+    EXPECT_EQ(command.result, 1);
+    EXPECT_EQ(command.regs[0], (uint16_t) DATC_COMMAND::SET_FINGER_POSITION);
+    EXPECT_EQ(command.regs[1], 7000);
+}